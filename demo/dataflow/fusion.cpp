@@ -0,0 +1,157 @@
+/*
+ * fusion.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/**
+ * Runs a pipeline of cheap stages a first time to measure the service
+ * time of the stages, fuses the stages whose total service time is lower
+ * than a threshold and runs the fused graph.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <nornir/nornir.hpp>
+
+using namespace nornir::dataflow;
+
+class DemoInputStream: public nornir::dataflow::InputStream{
+private:
+    size_t _currentElem;
+    size_t _streamSize;
+    bool _eos;
+public:
+    explicit inline DemoInputStream(size_t streamSize):
+            _currentElem(0), _streamSize(streamSize), _eos(false){
+        ;
+    }
+
+    inline void* next(){
+        if(_currentElem < _streamSize){
+            ++_currentElem;
+            return (void*) new int(_currentElem);
+        }else{
+            _eos = true;
+            return NULL;
+        }
+    }
+
+    inline bool hasNext(){
+        return !_eos;
+    }
+};
+
+class DemoOutputStream: public nornir::dataflow::OutputStream{
+public:
+    size_t received;
+
+    DemoOutputStream():received(0){;}
+
+    void put(void* a){
+        ++received;
+        delete (int*) a;
+    }
+};
+
+class Increment: public Computable{
+private:
+    size_t _iterations;
+public:
+    explicit Increment(size_t iterations):_iterations(iterations){;}
+
+    void compute(Data* d){
+        int* x = (int*) d->getInput();
+        for(size_t i = 0; i < _iterations; i++){
+            *((volatile int*) x) = *x + 1;
+        }
+        d->setOutput((void*) x);
+    }
+};
+
+int main(int argc, char** argv){
+    if(argc < 4){
+        std::cerr << "Usage: " << argv[0] << " streamSize numStages "
+                  << "maxServiceTime(us)" << std::endl;
+        return -1;
+    }
+    size_t streamSize = atoi(argv[1]);
+    size_t numStages = atoi(argv[2]);
+    double maxServiceTime = atof(argv[3]);
+    if(numStages < 2){
+        std::cerr << "numStages must be at least 2." << std::endl;
+        return -1;
+    }
+
+    /* The last stage is more expensive than the others. */
+    std::vector<Computable*> stages;
+    std::vector<Pipeline*> pipes;
+    for(size_t i = 0; i < numStages; i++){
+        stages.push_back(new Increment(i == numStages - 1 ? 100000 : 10));
+    }
+    Computable* pipe = stages[0];
+    for(size_t i = 1; i < numStages; i++){
+        pipes.push_back(new Pipeline(pipe, stages[i]));
+        pipe = pipes.back();
+    }
+    Mdfg* graph = compile(pipe);
+
+    /* Measures the service times. */
+    std::map<Computable*, double> serviceTimes;
+    {
+        DemoInputStream inp(streamSize);
+        DemoOutputStream out;
+        nornir::Parameters p("parameters.xml");
+        p.dataflow.profileServiceTimes = true;
+        nornir::dataflow::Interpreter m(&p, graph, &inp, &out);
+        m.start();
+        m.wait();
+        m.stats();
+        serviceTimes = m.getServiceTimes();
+    }
+
+    std::cout << "Removed instructions: "
+              << graph->fuse(serviceTimes, maxServiceTime) << std::endl;
+
+    /* Runs the fused graph. */
+    {
+        DemoInputStream inp(streamSize);
+        DemoOutputStream out;
+        nornir::Parameters p("parameters.xml");
+        nornir::dataflow::Interpreter m(&p, graph, &inp, &out);
+        m.start();
+        m.wait();
+        m.stats();
+        std::cout << "Results: " << out.received << std::endl;
+    }
+
+    delete graph;
+    for(size_t i = 0; i < pipes.size(); i++){
+        delete pipes[i];
+    }
+    for(size_t i = 0; i < stages.size(); i++){
+        delete stages[i];
+    }
+    return 0;
+}
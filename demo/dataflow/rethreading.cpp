@@ -0,0 +1,192 @@
+/*
+ * rethreading.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/**
+ * Changes the number of workers of the dataflow interpreter while
+ * instructions are batched (batchSize > 1) and processed in order.
+ * The number of workers is switched between the minimum and the maximum
+ * through the selector-manual control file. Each stage checks that it
+ * receives the stream elements in order, and the demo terminates only if
+ * no instructions are lost on the removed workers.
+ */
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <nornir/nornir.hpp>
+#include <nornir/selectors.hpp>
+
+using namespace nornir::dataflow;
+
+class SeqInputStream: public nornir::dataflow::InputStream{
+private:
+    size_t _currentElem;
+    size_t _streamSize;
+    bool _eos;
+public:
+    explicit inline SeqInputStream(size_t streamSize):
+            _currentElem(0), _streamSize(streamSize), _eos(false){
+        ;
+    }
+
+    inline void* next(){
+        if(_currentElem < _streamSize){
+            size_t* x = new size_t(_currentElem++);
+            return (void*) x;
+        }else{
+            _eos = true;
+            return NULL;
+        }
+    }
+
+    inline bool hasNext(){
+        return !_eos;
+    }
+};
+
+class SeqOutputStream: public nornir::dataflow::OutputStream{
+private:
+    std::atomic<size_t> _received;
+    size_t _outOfOrder;
+public:
+    SeqOutputStream():_received(0), _outOfOrder(0){;}
+
+    void put(void* a){
+        size_t* x = (size_t*) a;
+        if(*x != _received.load()){
+            ++_outOfOrder;
+        }
+        _received.store(_received.load() + 1);
+        delete x;
+    }
+
+    size_t getReceived() const{
+        return _received.load();
+    }
+
+    size_t getOutOfOrder() const{
+        return _outOfOrder;
+    }
+};
+
+/**
+ * With orderedProcessing each instruction is executed by one worker at a
+ * time, so the stage doesn't need to be thread safe.
+ */
+class CheckOrder: public Computable{
+private:
+    size_t _next;
+    size_t _outOfOrder;
+public:
+    CheckOrder():_next(0), _outOfOrder(0){;}
+
+    void compute(Data* d){
+        size_t* x = (size_t*) d->getInput();
+        if(*x != _next){
+            ++_outOfOrder;
+        }
+        _next = *x + 1;
+        d->setOutput((void*) x);
+    }
+
+    size_t getOutOfOrder() const{
+        return _outOfOrder;
+    }
+};
+
+static void setNumWorkers(double relative){
+    nornir::KnobsValues kv(nornir::KNOB_VALUE_RELATIVE);
+    for(size_t i = 0; i < nornir::KNOB_NUM; i++){
+        kv[(nornir::KnobType) i] = 100;
+    }
+    kv[nornir::KNOB_VIRTUAL_CORES] = relative;
+    std::ofstream control(nornir::getSelectorManualCliControlFile().c_str());
+    control << kv;
+    control.close();
+}
+
+int main(int argc, char** argv){
+    if(argc < 4){
+        std::cerr << "Usage: " << argv[0] << " streamSize numStages "
+                  << "switchInterval(ms)" << std::endl;
+        return -1;
+    }
+    size_t streamSize = atoi(argv[1]);
+    size_t numStages = atoi(argv[2]);
+    uint switchInterval = atoi(argv[3]);
+    if(numStages < 2){
+        std::cerr << "numStages must be at least 2." << std::endl;
+        return -1;
+    }
+
+    SeqInputStream inp(streamSize);
+    SeqOutputStream out;
+
+    std::vector<CheckOrder*> stages;
+    for(size_t i = 0; i < numStages; i++){
+        stages.push_back(new CheckOrder());
+    }
+    std::vector<Pipeline*> pipes;
+    pipes.push_back(new Pipeline(stages[0], stages[1]));
+    for(size_t i = 2; i < numStages; i++){
+        pipes.push_back(new Pipeline(pipes.back(), stages[i]));
+    }
+
+    nornir::Parameters p("parameters.xml");
+    p.strategySelection = nornir::STRATEGY_SELECTION_MANUAL_CLI;
+    p.dataflow.orderedProcessing = true;
+    p.dataflow.placement = nornir::DATAFLOW_PLACEMENT_LEAST_LOADED;
+    p.dataflow.batchSize = 8;
+    setNumWorkers(100);
+
+    nornir::dataflow::Interpreter m(&p, pipes.back(), &inp, &out);
+    m.start();
+    double relative = 0;
+    while(out.getReceived() < streamSize){
+        usleep(switchInterval * 1000);
+        setNumWorkers(relative);
+        relative = 100 - relative;
+    }
+    m.wait();
+
+    size_t outOfOrder = out.getOutOfOrder();
+    for(size_t i = 0; i < numStages; i++){
+        outOfOrder += stages[i]->getOutOfOrder();
+    }
+    std::cout << "Stream elements: " << out.getReceived() << std::endl;
+    std::cout << "Out of order: " << outOfOrder << std::endl;
+    remove(nornir::getSelectorManualCliControlFile().c_str());
+    for(size_t i = 0; i < pipes.size(); i++){
+        delete pipes[i];
+    }
+    for(size_t i = 0; i < numStages; i++){
+        delete stages[i];
+    }
+    return outOfOrder ? -1 : 0;
+}
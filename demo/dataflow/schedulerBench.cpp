@@ -0,0 +1,136 @@
+/*
+ * schedulerBench.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/**
+ * Measures the number of instructions per second managed by the dataflow
+ * scheduler. The stages do not perform any computation, so the throughput
+ * is bound by the scheduler. Each instruction requires the scheduler to
+ * dispatch it and to process its result.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+#include <nornir/nornir.hpp>
+
+using namespace nornir::dataflow;
+
+class BenchInputStream: public nornir::dataflow::InputStream{
+private:
+    size_t _currentElem;
+    size_t _streamSize;
+    bool _eos;
+    int _elem;
+public:
+    explicit inline BenchInputStream(size_t streamSize):
+            _currentElem(0), _streamSize(streamSize), _eos(false), _elem(0){
+        ;
+    }
+
+    inline void* next(){
+        if(_currentElem < _streamSize){
+            ++_currentElem;
+            return (void*) &_elem;
+        }else{
+            _eos = true;
+            return NULL;
+        }
+    }
+
+    inline bool hasNext(){
+        return !_eos;
+    }
+};
+
+class BenchOutputStream: public nornir::dataflow::OutputStream{
+private:
+    size_t _received;
+public:
+    BenchOutputStream():_received(0){;}
+
+    void put(void* a){
+        ++_received;
+    }
+
+    size_t getReceived() const{
+        return _received;
+    }
+};
+
+class Forward: public Computable{
+public:
+    void compute(Data* d){
+        d->setOutput(d->getInput());
+    }
+};
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cerr << "Usage: " << argv[0] << " streamSize numStages" << std::endl;
+        return -1;
+    }
+    size_t streamSize = atoi(argv[1]);
+    size_t numStages = atoi(argv[2]);
+    if(numStages < 2){
+        std::cerr << "numStages must be at least 2." << std::endl;
+        return -1;
+    }
+
+    /* Create streams. */
+    BenchInputStream inp(streamSize);
+    BenchOutputStream out;
+
+    std::vector<Computable*> stages;
+    for(size_t i = 0; i < numStages; i++){
+        stages.push_back(new Forward());
+    }
+    std::vector<Pipeline*> pipes;
+    pipes.push_back(new Pipeline(stages[0], stages[1]));
+    for(size_t i = 2; i < numStages; i++){
+        pipes.push_back(new Pipeline(pipes.back(), stages[i]));
+    }
+    Pipeline* pipe = pipes.back();
+
+    nornir::Parameters p("parameters.xml");
+    nornir::dataflow::Interpreter m(&p, pipe, &inp, &out);
+    double start = mammut::utils::getMillisecondsTime();
+    m.start();
+    m.wait();
+    double seconds = (mammut::utils::getMillisecondsTime() - start) / 1000.0;
+
+    std::cout << "Stream elements: " << out.getReceived() << std::endl;
+    std::cout << "Elapsed time (s): " << seconds << std::endl;
+    std::cout << "Graphs/sec: " << out.getReceived() / seconds << std::endl;
+    std::cout << "Scheduler ops/sec: "
+              << (out.getReceived() * numStages) / seconds << std::endl;
+    for(size_t i = 0; i < pipes.size(); i++){
+        delete pipes[i];
+    }
+    for(size_t i = 0; i < numStages; i++){
+        delete stages[i];
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * staticPipeline.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/**
+ * Executes the same 3-stage pipeline with the Interpreter and with the
+ * StaticInterpreter, where the stages are called directly by the workers
+ * of the farm.
+ */
+#include <iostream>
+#include <stdlib.h>
+#include <nornir/nornir.hpp>
+
+using namespace nornir::dataflow;
+
+class DemoInputStream: public nornir::dataflow::InputStream{
+private:
+    size_t _currentElem;
+    size_t _streamSize;
+public:
+    explicit inline DemoInputStream(size_t streamSize):
+            _currentElem(0), _streamSize(streamSize){;}
+
+    inline void* next(){
+        if(_currentElem < _streamSize){
+            return (void*) new int(_currentElem++ % 1000);
+        }
+        return NULL;
+    }
+
+    inline bool hasNext(){
+        return _currentElem < _streamSize;
+    }
+};
+
+class DemoOutputStream: public nornir::dataflow::OutputStream{
+private:
+    double _sum;
+public:
+    DemoOutputStream():_sum(0){;}
+
+    void put(void* a){
+        double* x = (double*) a;
+        _sum += *x;
+        delete x;
+    }
+
+    double getSum() const{
+        return _sum;
+    }
+};
+
+class Add: public StaticStage<int, int>{
+public:
+    int* compute(int* x){
+        *x = *x + 3;
+        return x;
+    }
+};
+
+class Multiply: public StaticStage<int, int>{
+public:
+    int* compute(int* x){
+        *x = *x * 4;
+        return x;
+    }
+};
+
+class Half: public StaticStage<int, double>{
+public:
+    double* compute(int* x){
+        double* r = new double(*x / 2.0);
+        delete x;
+        return r;
+    }
+};
+
+typedef StaticPipeline<Add, Multiply, Half> DemoPipeline;
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        std::cerr << "Usage: " << argv[0] << " streamSize" << std::endl;
+        return -1;
+    }
+    size_t streamSize = atoi(argv[1]);
+    nornir::Parameters p("parameters.xml");
+    DemoPipeline pipeline;
+
+    DemoInputStream inp(streamSize);
+    DemoOutputStream out;
+    Computable* pipe = pipeline.toComputable();
+    double start = mammut::utils::getMillisecondsTime();
+    Interpreter m(&p, pipe, &inp, &out);
+    m.start();
+    m.wait();
+    std::cout << "Interpreter: " << mammut::utils::getMillisecondsTime() - start
+              << " ms (result: " << out.getSum() << ")" << std::endl;
+    delete pipe;
+
+    DemoInputStream inpStatic(streamSize);
+    DemoOutputStream outStatic;
+    start = mammut::utils::getMillisecondsTime();
+    StaticInterpreter<DemoPipeline> s(&p, pipeline, &inpStatic, &outStatic);
+    s.start();
+    s.wait();
+    std::cout << "StaticInterpreter: " << mammut::utils::getMillisecondsTime() - start
+              << " ms (result: " << outStatic.getSum() << ")" << std::endl;
+    return 0;
+}
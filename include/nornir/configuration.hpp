@@ -44,8 +44,119 @@ namespace nornir{
 
 class ManagerTest;
 
+/**
+ * Lazy view on all the combinations (i.e. the cartesian product) of real
+ * knobs values. Combinations are never materialized, they are enumerated
+ * with a mixed-radix counter where the last knob is the fastest changing
+ * one.
+ */
+class KnobsCombinations{
+private:
+    std::array<std::vector<double>, KNOB_NUM> _values;
+    std::array<size_t, KNOB_NUM> _strides;
+    size_t _size;
+public:
+    class const_iterator{
+    private:
+        const KnobsCombinations* _combinations;
+        size_t _index;
+        std::array<size_t, KNOB_NUM> _ids;
+        KnobsValues _current;
+    public:
+        const_iterator(const KnobsCombinations* combinations, size_t index);
+
+        const KnobsValues& operator*() const{return _current;}
+
+        const KnobsValues* operator->() const{return &_current;}
+
+        const_iterator& operator++();
+
+        bool operator!=(const const_iterator& other) const{
+            return _index != other._index;
+        }
+
+        bool operator==(const const_iterator& other) const{
+            return _index == other._index;
+        }
+    };
+
+    /**
+     * Builds the combinations.
+     * @param values The allowed values of each knob.
+     */
+    explicit KnobsCombinations(const std::array<std::vector<double>, KNOB_NUM>& values);
+
+    /**
+     * Returns the number of combinations.
+     * @return The number of combinations.
+     */
+    size_t size() const{return _size;}
+
+    /**
+     * Returns the number of allowed values of a knob.
+     * @param t The type of the knob.
+     * @return The number of allowed values of the knob.
+     */
+    size_t getNumValues(KnobType t) const{return _values[t].size();}
+
+    /**
+     * Returns the distance between two combinations that only differ
+     * by one position in the allowed values of a knob.
+     * @param t The type of the knob.
+     * @return The distance between the two combinations.
+     */
+    size_t getStride(KnobType t) const{return _strides[t];}
+
+    /**
+     * Returns the position, in the allowed values of a knob, of the value
+     * used by a combination.
+     * @param index The index of the combination.
+     * @param t The type of the knob.
+     * @return The position of the value of the knob.
+     */
+    size_t getValueId(size_t index, KnobType t) const{
+        return (index / _strides[t]) % _values[t].size();
+    }
+
+    /**
+     * Returns a combination.
+     * @param index The index of the combination, in [0, size()).
+     * @param values The combination.
+     */
+    void at(size_t index, KnobsValues& values) const;
+
+    /**
+     * Returns a combination.
+     * @param index The index of the combination, in [0, size()).
+     * @return The combination.
+     */
+    KnobsValues at(size_t index) const;
+
+    /**
+     * Returns the index of a combination.
+     * @param values The combination.
+     * @param index The index of the combination, in [0, size()).
+     * @return False if the combination is not one of these combinations,
+     *         true otherwise.
+     */
+    bool getIndex(const KnobsValues& values, size_t& index) const;
+
+    bool operator==(const KnobsCombinations& other) const{
+        return _values == other._values;
+    }
+
+    bool operator!=(const KnobsCombinations& other) const{
+        return !operator==(other);
+    }
+
+    const_iterator begin() const{return const_iterator(this, 0);}
+
+    const_iterator end() const{return const_iterator(this, _size);}
+};
+
 class Configuration: public mammut::utils::NonCopyable {
     friend class ManagerTest;
+    friend class ReconfigurationCostTest;
 protected:
     std::vector<std::array<Knob*, KNOB_NUM>> _knobs;
     Trigger* _triggers[TRIGGER_TYPE_NUM];
@@ -57,9 +168,6 @@ private:
     std::vector<KnobsValues> _combinations;
     ReconfigurationStats _reconfigurationStats;
 
-    void combinations(std::vector<std::vector<double> > array, size_t i,
-                      std::vector<double> accum);
-
     bool virtualCoresWillChange(const KnobsValues& values) const;
 
     ticks startReconfigurationStatsKnob() const;
@@ -69,6 +177,8 @@ private:
     ticks startReconfigurationStatsTotal() const;
 
     void stopReconfigurationStatsTotal(ticks start);
+
+    void stopReconfigurationStatsStall();
 public:
     // If numCpus > 1, different knobs for each cpu (useful for HMP)
     explicit Configuration(const Parameters& p, uint numHMPs);
@@ -102,6 +212,14 @@ public:
      */
     bool knobsChangeNeeded() const;
 
+    /**
+     * Returns a lazy view on all the possible combinations of real knobs
+     * values.
+     * @return A lazy view on all the possible combinations of real knobs
+     *         values.
+     */
+    KnobsCombinations getRealCombinations() const;
+
     /**
      * Creates all the possible knobs combinations.
      */
@@ -37,6 +37,7 @@
 #include "skeleton/farm.hpp"
 #include "skeleton/pipeline.hpp"
 #include "skeleton/ewc.hpp"
+#include "skeleton/staticpipeline.hpp"
 #include "../external/fastflow/ff/ubuffer.hpp"
 #include "../external/fastflow/ff/squeue.hpp"
 
@@ -45,10 +46,23 @@
 #include <typeinfo>
 #include <errno.h>
 
-#ifndef MAXPOOLSIZE
-#define MAXPOOLSIZE 500000
+/**
+ * By default, the scheduler stores the graphs in flight and the results to be
+ * reordered in ring buffers indexed by graph id. The ids of the graphs in
+ * flight must lie in a window of DATAFLOW_GRAPHS_WINDOW_FACTOR * maxGraphs
+ * (rounded up to a power of 2), starting from the oldest graph not yet
+ * completed. If DATAFLOW_MAP_TABLES is defined, std::map are used instead.
+ */
+#ifndef DATAFLOW_GRAPHS_WINDOW_FACTOR
+#define DATAFLOW_GRAPHS_WINDOW_FACTOR 4
 #endif
 
+#define DATAFLOW_NO_INSTANCE std::numeric_limits<size_t>::max()
+
+// The queue depth imbalance is sampled every DATAFLOW_IMBALANCE_SAMPLING
+// instructions sent to the interpreters.
+#define DATAFLOW_IMBALANCE_SAMPLING 64
+
 typedef struct MSQueue QUEUE;
 
 namespace nornir{
@@ -57,6 +71,82 @@ namespace dataflow{
 // TODO: ArrayWrapper<T> -> std::vector<T>
 // TODO: Use arma::vec and arma::mat for Map and Reduce computations
 
+/**
+ * Chase-Lev work stealing deque of fireable instructions, used when
+ * DataflowParameters::decentralisedFiring is true. The owner worker
+ * pushes and pops instructions at the bottom while thieves steal from
+ * the top. Push fails if the buffer is full.
+ */
+class MdfiDeque: public mammut::utils::NonCopyable{
+private:
+    static const long long int _size = 1024; // Must be a power of 2.
+    std::atomic<long long int> _top;
+    char _padTop[NORNIR_CACHE_LINE_SIZE - sizeof(std::atomic<long long int>)];
+    std::atomic<long long int> _bottom;
+    char _padBottom[NORNIR_CACHE_LINE_SIZE - sizeof(std::atomic<long long int>)];
+    std::atomic<Mdfi*> _instructions[_size];
+public:
+    MdfiDeque():_top(0), _bottom(0){;}
+
+    /**
+     * Pushes an instruction. Can only be called by the owner.
+     * @return false if the deque is full, true otherwise.
+     */
+    bool push(Mdfi* ins){
+        long long int b = _bottom.load(std::memory_order_relaxed);
+        long long int t = _top.load(std::memory_order_acquire);
+        if(b - t >= _size){
+            return false;
+        }
+        _instructions[b & (_size - 1)].store(ins, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Pops the last pushed instruction. Can only be called by the owner.
+     * @return false if the deque is empty, true otherwise.
+     */
+    bool pop(Mdfi*& ins){
+        long long int b = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long int t = _top.load(std::memory_order_relaxed);
+        if(t > b){
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        ins = _instructions[b & (_size - 1)].load(std::memory_order_relaxed);
+        if(t == b){
+            // Last element, we may be racing with a thief.
+            bool won = _top.compare_exchange_strong(t, t + 1,
+                                                    std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * Steals the oldest instruction. Can be called by any thread.
+     * @return false if the deque was empty or if the steal failed, true otherwise.
+     */
+    bool steal(Mdfi*& ins){
+        long long int t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long int b = _bottom.load(std::memory_order_acquire);
+        if(t >= b){
+            return false;
+        }
+        ins = _instructions[t & (_size - 1)].load(std::memory_order_relaxed);
+        return _top.compare_exchange_strong(t, t + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+};
+
 /**
  * This is the worker of the fastflow's farm.
  */
@@ -65,9 +155,58 @@ private:
     QUEUE* _q;
     bool _init;
     size_t _qId;
-    size_t _processedTasks;
+    // Only written by the worker, read by the scheduler.
+    std::atomic<size_t> _processedTasks;
+    std::atomic<int> _virtualCore;
+    // Deques of all the workers. NULL if instructions are not fired
+    // by the workers.
+    std::vector<MdfiDeque*>* _deques;
+    // Fireable instructions which did not fit in the deque.
+    std::vector<Mdfi*> _overflow;
+    bool _profileServiceTimes;
+    // Time spent computing each instruction of the graph and number
+    // of computed instances. Only written by the worker.
+    std::vector<std::atomic<ticks>> _serviceTicks;
+    std::vector<std::atomic<size_t>> _serviceCount;
+
+    /**
+     * Computes an instruction, measuring its service time if
+     * DataflowParameters::profileServiceTimes is true.
+     * \param t The instruction.
+     */
+    void computeMdfi(Mdfi* t);
+
+    /**
+     * Sets the results of a computed instruction as inputs of its
+     * successors. The last instruction of the graph is sent back
+     * to the scheduler.
+     * \param t The computed instruction.
+     * \return One of the successors which became fireable, or NULL.
+     *         The other ones are pushed in the deque of the worker.
+     */
+    Mdfi* fire(Mdfi* t);
+
+    /**
+     * Gets a fireable instruction, from this worker or from the
+     * other workers.
+     * \return A fireable instruction or NULL if no instructions
+     *         have been found.
+     */
+    Mdfi* getFireable();
 public:
-    explicit WorkerMdf(QUEUE* q);
+    /**
+     * Constructor of the worker.
+     * \param q The queue used to send the results to the scheduler.
+     * \param numMdfi The number of instructions of the graph.
+     * \param deques If not NULL, the deques of all the workers. In this
+     *        case the worker fires the successors of the instructions it
+     *        computes and only sends the results of the graphs to the
+     *        scheduler.
+     * \param profileServiceTimes If true, the worker measures the service
+     *        time of the instructions.
+     */
+    WorkerMdf(QUEUE* q, size_t numMdfi, std::vector<MdfiDeque*>* deques = NULL,
+              bool profileServiceTimes = false);
 
     /**
      * Computes a macro data flow instruction.
@@ -77,8 +216,33 @@ public:
     void compute(Mdfi* t);
 
     size_t getProcessedTasks() const;
+
+    /**
+     * Returns the virtual core where the worker computed its last
+     * instruction.
+     * \return The id of the virtual core, -1 if not known.
+     */
+    int getVirtualCore() const;
+
+    /**
+     * Returns the time spent by this worker computing an instruction.
+     * If called while the interpreter is running, the time and the count
+     * may not refer to the same instances.
+     * \param id The id of the instruction.
+     * \param count The number of instances of the instruction computed
+     *        by this worker.
+     * \return The time spent computing the instruction (ticks).
+     */
+    ticks getServiceTicks(uint id, size_t& count) const;
 };
 
+/**
+ * Compiles a skeleton into a macro data flow graph.
+ * \param c The skeleton to compile.
+ * \return The macro data flow graph. Must be deleted by the caller.
+ */
+Mdfg* compile(Computable* c);
+
 /**
  * This is the interpreter of the macro data flow instructions.
  */
@@ -89,8 +253,10 @@ private:
     std::vector<WorkerMdf*> _workers;
     nornir::Farm<Mdfi>* _farm;
     nornir::Parameters* _p;
+    Mdfg* _graph;
     Mdfg* _compiledGraph;
     size_t _maxWorkers;
+    std::vector<MdfiDeque*> _deques;
 public:
     /**
      * Constructor of the interpreter.
@@ -123,9 +289,173 @@ public:
      */
     inline void stats(std::ostream& out = std::cout){
         _farm->stats(out);
+        out << "Queue depth imbalance: " << getQueueImbalance() << std::endl;
+        std::map<Computable*, double> serviceTimes = getServiceTimes();
+        _graph->printStats(out, &serviceTimes);
+    }
+
+    /**
+     * Returns the average service time of the computables of the graph,
+     * measured while the interpreter was running. Can be passed to
+     * Mdfg::fuse() to optimise the graph for the next executions.
+     * Only available if DataflowParameters::profileServiceTimes is true.
+     * If called while the interpreter is running, the times are
+     * approximated.
+     * \return The average service time of each computable (microseconds).
+     *         Computables never computed are not present.
+     */
+    std::map<Computable*, double> getServiceTimes() const;
+
+    /**
+     * Returns the average ratio between the maximum and the average
+     * number of instructions waiting in the queues of the interpreters
+     * (1 if the load is perfectly balanced). Only available when the
+     * placement of the instructions is decided by the scheduler (i.e.
+     * with orderedProcessing or with a placement different from
+     * DATAFLOW_PLACEMENT_STATIC).
+     * \return The queue depth imbalance, 0 if not available.
+     */
+    double getQueueImbalance() const;
+
+    /**
+     * Starts the interpreter. If knobDataflowBatchEnabled is true, the
+     * number of instructions exchanged in a single message between the
+     * scheduler and the interpreters is then set by nornir. If
+     * knobDataflowWindowEnabled is true, the maximum number of stream
+     * elements in flight is then set by nornir.
+     */
+    void start();
+
+    inline void wait(){
+        _farm->wait();
     }
+};
 
-    inline void start(){
+/**
+ * Scheduler of a StaticInterpreter. Sends the elements of the input
+ * stream to the workers.
+ */
+template <typename I> class StaticScheduler: public nornir::Scheduler<I>{
+private:
+    InputStream* _in;
+public:
+    explicit StaticScheduler(InputStream* in):_in(in){;}
+
+    I* schedule(){
+        while(_in->hasNext()){
+            void* next = _in->next();
+            if(next){
+                return static_cast<I*>(next);
+            }
+        }
+        return nornir::Scheduler<I>::lastElement();
+    }
+};
+
+/**
+ * Worker of a StaticInterpreter. Computes all the stages of its copy
+ * of the pipeline.
+ */
+template <typename P> class StaticWorker:
+        public nornir::Worker<typename P::InputType, typename P::OutputType>{
+private:
+    P _pipeline;
+public:
+    explicit StaticWorker(const P& pipeline):_pipeline(pipeline){;}
+
+    typename P::OutputType* compute(typename P::InputType* x){
+        return _pipeline.compute(x);
+    }
+};
+
+/**
+ * Gatherer of a StaticInterpreter. Sends the results to the output stream.
+ */
+template <typename O> class StaticGatherer: public nornir::Gatherer<O>{
+private:
+    OutputStream* _out;
+public:
+    explicit StaticGatherer(OutputStream* out):_out(out){;}
+
+    void gather(O* x){
+        if(_out){
+            _out->put(x);
+        }
+    }
+};
+
+/**
+ * \class StaticInterpreter
+ * Executes a StaticPipeline without interpretation: each worker of a
+ * nornir::Farm computes all the stages of a stream element, calling them
+ * directly. The farm is managed by nornir like the one used by the
+ * Interpreter. Ordering is preserved if dataflow.orderedProcessing or
+ * dataflow.orderedOutput are true.
+ *
+ * \tparam P The type of the StaticPipeline.
+ */
+template <typename P> class StaticInterpreter: mammut::utils::NonCopyable{
+private:
+    typedef typename P::InputType I;
+    typedef typename P::OutputType O;
+    nornir::Farm<I, O>* _farm;
+    StaticScheduler<I>* _s;
+    std::vector<StaticWorker<P>*> _workers;
+    StaticGatherer<O>* _g;
+public:
+    /**
+     * Constructor of the interpreter.
+     * \param p The nornir parameters. The number of workers is
+     *        dataflow.maxInterpreters (if 0, the number of physical cores
+     *        in the system - 2).
+     * \param pipeline The pipeline to be executed. It is copied on
+     *        each worker.
+     * \param i The input stream.
+     * \param o The output stream. If NULL, results are not sent on the
+     *        output stream.
+     */
+    StaticInterpreter(Parameters* p, const P& pipeline, InputStream* i,
+                      OutputStream* o = NULL){
+        size_t maxWorkers = p->dataflow.maxInterpreters;
+        if(!maxWorkers){
+            size_t numPhysicalCores = p->mammut.getInstanceTopology()->getPhysicalCores().size();
+            if(numPhysicalCores < 3){
+                throw std::runtime_error("Not enough cores available (you need at least "
+                                         "3 physical cores).");
+            }
+            /** -2: One for the scheduler and one for nornir manager. **/
+            maxWorkers = numPhysicalCores - 2;
+        }
+        _farm = new nornir::Farm<I, O>(p);
+        _s = new StaticScheduler<I>(i);
+        _farm->addScheduler(_s);
+        for(size_t j = 0; j < maxWorkers; j++){
+            _workers.push_back(new StaticWorker<P>(pipeline));
+            _farm->addWorker(_workers.back());
+        }
+        _g = new StaticGatherer<O>(o);
+        _farm->addGatherer(_g);
+        if(p->dataflow.orderedProcessing || p->dataflow.orderedOutput){
+            _farm->preserveOrdering();
+        }
+    }
+
+    /**
+     * Destructor of the interpreter.
+     */
+    ~StaticInterpreter(){
+        delete _farm;
+        delete _s;
+        for(size_t j = 0; j < _workers.size(); j++){
+            delete _workers.at(j);
+        }
+        delete _g;
+    }
+
+    /**
+     * Starts the interpreter.
+     */
+    void start(){
         _farm->start();
     }
 
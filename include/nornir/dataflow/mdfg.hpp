@@ -30,9 +30,42 @@
 
 #include "mdfi.hpp"
 
+#include <map>
+#include <memory>
+
 namespace nornir{
 namespace dataflow{
 
+/**
+ * Computes a chain of computables in sequence. Each computable has
+ * exactly one input and one output, except for the input of the first
+ * one and the output of the last one.
+ * Created by Mdfg::fuse().
+ */
+class FusedComputable: public Computable{
+private:
+    std::vector<Computable*> _stages;
+public:
+    /**
+     * Creates a fused computable.
+     * \param first The first computable. If it is a fused computable, its
+     *        stages are copied.
+     * \param second The computable receiving the output of \e first. If it
+     *        is a fused computable, its stages are copied.
+     */
+    FusedComputable(Computable* first, Computable* second);
+
+    void compute(Data* d);
+
+    /**
+     * Returns the computables executed by this computable.
+     * \return The computables executed by this computable, in order.
+     */
+    inline const std::vector<Computable*>& getStages() const{
+        return _stages;
+    }
+};
+
 /**
  * Macro data flow graph.
  * Accessory methods are provided to interact with and use the graph..
@@ -74,8 +107,11 @@ private:
     ulong _firstId;
     ulong _lastId;
     bool _init;
+    /**Computables created when fusing instructions.**/
+    std::vector<std::shared_ptr<FusedComputable> > _fused;
 
     friend Mdfg* compile(Computable* c);
+    friend class MdfgInstances;
 
     inline void clearInputInstruction(){
         _instructions.at(_firstId).clearInput();
@@ -279,6 +315,22 @@ public:
                 throw std::runtime_error("Impossible to find the last instruction "
                                          "of the graph (Must have only 1 output).");
             }
+
+            /**
+             * Resolves, for each output token, the input token of the
+             * destination instruction, so that no lookup is needed
+             * when the graph is executed.
+             **/
+            for(size_t i = 0; i < _instructions.size(); i++){
+                Mdfi& ins = _instructions.at(i);
+                for(uint j = 0; j < ins.getOutputSize(); j++){
+                    TokenId dest = ins.getOutToken(j)->getDest();
+                    if(!dest.isOutStream()){
+                        Mdfi& destIns = _instructions.at(dest.getMdfId());
+                        ins.setDestinationPort(j, destIns.getSourcePort(ins.getComputable()));
+                    }
+                }
+            }
         }
     }
 
@@ -310,6 +362,82 @@ public:
         clearOutputInstruction();
     }
 
+    /**
+     * Fuses the chains of instructions with a single output linked to
+     * instructions with a single input, saving one scheduling round
+     * trip for each fused instruction. Instructions are fused only while
+     * the service time of the fused instruction doesn't exceed
+     * \e maxServiceTime, so that the parallelism among different stream
+     * elements is preserved for the expensive ones. The ids of the
+     * instructions change. MUST be called after init() and before
+     * creating an interpreter on the graph.
+     * \param serviceTimes The service times of the computables (e.g. as
+     *        returned by Interpreter::getServiceTimes()). Instructions
+     *        whose computable is not present are never fused.
+     * \param maxServiceTime The maximum service time of a fused
+     *        instruction (same unit of \e serviceTimes).
+     * \return The number of removed instructions.
+     */
+    uint fuse(const std::map<Computable*, double>& serviceTimes,
+              double maxServiceTime);
+
+    /**
+     * Prints the instructions of the graph.
+     * \param out The stream where the instructions are printed.
+     * \param serviceTimes If not NULL, the service times of the computables.
+     */
+    void printStats(std::ostream& out,
+                    const std::map<Computable*, double>* serviceTimes = NULL);
+
+};
+
+/**
+ * Instances of a compiled macro data flow graph.
+ * The instructions of all the instances are stored in a single contiguous
+ * buffer, allocated once. An instance is acquired when a new stream element
+ * enters the system and released when its result is produced, so that
+ * instantiating a graph doesn't require any allocation.
+ */
+class MdfgInstances{
+private:
+    /**Number of instructions of the graph.**/
+    size_t _numMdfi;
+    /**Instructions of all the instances, one instance after the other.**/
+    std::vector<Mdfi> _instructions;
+    /**Indexes of the instances not in use.**/
+    std::vector<size_t> _freeSlots;
+public:
+    /**
+     * Creates the instances.
+     * \param g The graph. init() must have been already called on it.
+     * \param numSlots The maximum number of instances in use at the same time.
+     */
+    MdfgInstances(const Mdfg& g, size_t numSlots);
+
+    /**
+     * Acquires a free instance.
+     * \param graphId The id of the graph.
+     * \return The index of the instance.
+     */
+    size_t acquire(ulong graphId);
+
+    /**
+     * Releases an instance.
+     * \param slot The index of the instance.
+     */
+    inline void release(size_t slot){
+        _freeSlots.push_back(slot);
+    }
+
+    /**
+     * Returns an instruction of an instance.
+     * \param slot The index of the instance.
+     * \param id The id of the instruction.
+     * \return The instruction.
+     */
+    inline Mdfi* getMdfi(size_t slot, uint id){
+        return &(_instructions[slot * _numMdfi + id]);
+    }
 };
 }
 }
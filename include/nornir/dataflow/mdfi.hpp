@@ -31,6 +31,7 @@
 #include <nornir/dataflow/skeleton/computable.hpp>
 #include <nornir/dataflow/tokens.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -39,14 +40,11 @@
 namespace nornir{
 namespace dataflow{
 
-
-#define MAX_INSTRUCTION_INPUTS 8
-
 /**Macro data flow instruction.**/
 class Mdfi{
 private:
-    std::map<Computable*, uint> sourcesMap; // Map between computable and its position in the sources vector
-    std::map<Computable*, uint> destinationsMap;
+    Computable* sources[MAX_INSTRUCTION_INPUTS]; ///<Source of each input token (NULL = input stream).
+    Computable* destinations[MAX_INSTRUCTION_INPUTS]; ///<Destination of each output token (NULL = output stream).
     InputToken tInput[MAX_INSTRUCTION_INPUTS]; ///<Input tokens. Are numbered from 0 to \e dInput -1.
     OutputToken tOutput[MAX_INSTRUCTION_INPUTS];
     Computable* comp; ///<\e Computable to compute.
@@ -54,6 +52,10 @@ private:
         dOutput, ///<Output size.
         id; ///<Instruction's identifier.
     ulong graphId; ///<Id of the graph to which the instruction belongs.
+    Mdfi* instance; ///<First instruction of the graph instance (if any).
+    std::atomic<uint> missing; ///<Number of inputs not yet set (concurrent updates).
+    int worker; ///<Id of the interpreter which computed the instruction (-1 if none).
+    Mdfi* batchNext; ///<Next instruction of the batch (NULL if last).
 public:
     /**
      * Constructor of the instruction.
@@ -61,7 +63,8 @@ public:
      * \param i Instruction's identifier.
      */
     inline Mdfi(Computable* c, uint i):
-        comp(c), dInput(0), dOutput(0), id(i), graphId(0){
+        comp(c), dInput(0), dOutput(0), id(i), graphId(0), instance(NULL),
+        missing(0), worker(-1), batchNext(NULL){
         ;
     }
 
@@ -70,10 +73,14 @@ public:
      * \param ins Reference to instruction to copy.
      */
     inline Mdfi(const Mdfi& ins):
-            sourcesMap(ins.sourcesMap), destinationsMap(ins.destinationsMap),
             comp(ins.comp), dInput(ins.dInput),
-            dOutput(ins.dOutput), id(ins.id), graphId(ins.graphId){
+            dOutput(ins.dOutput), id(ins.id), graphId(ins.graphId),
+            instance(NULL), missing(ins.dInput), worker(-1), batchNext(NULL){
+        for(uint i = 0; i < dInput; i++){
+            sources[i] = ins.sources[i];
+        }
         for(uint i = 0; i < dOutput; i++){
+            destinations[i] = ins.destinations[i];
             tOutput[i] = ins.tOutput[i];
         }
         assert(dInput <= MAX_INSTRUCTION_INPUTS);
@@ -118,47 +125,123 @@ public:
      * \param t The task to set.
      */
     inline void setInput(void* t, Computable* c){
-        if(sourcesMap.find(c) == sourcesMap.end()){
-            throw std::runtime_error("Computable non existing.");
+        tInput[getSourcePort(c)].setTask(t);
+    }
+
+    /**
+     * Sets an input task.
+     * \param t The task to set.
+     * \param port The index of the input token, as returned by
+     *        getSourcePort().
+     */
+    inline void setInputPort(void* t, uint port){
+        assert(port < dInput);
+        tInput[port].setTask(t);
+    }
+
+    /**
+     * Sets an input task. Can be called concurrently by different
+     * threads on the same instruction, for different ports.
+     * \param t The task to set.
+     * \param port The index of the input token.
+     * \return \e true if this was the last missing input. In this case
+     *         the caller is the only one which can fire the instruction.
+     */
+    inline bool setInputPortConcurrent(void* t, uint port){
+        assert(port < dInput);
+        tInput[port].setTask(t);
+        return missing.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    /**
+     * Returns the instruction which receives an output token. Only
+     * valid for instructions belonging to a graph instance.
+     * \param i The index of the output token.
+     * \return The destination instruction.
+     */
+    inline Mdfi* getDestination(uint i){
+        assert(instance && i < dOutput && !tOutput[i].dest.isOutStream());
+        return instance + tOutput[i].dest.mdfiId;
+    }
+
+    /**
+     * Sets the first instruction of the graph instance this
+     * instruction belongs to.
+     * \param first The first instruction of the graph instance.
+     */
+    inline void setInstance(Mdfi* first){
+        instance = first;
+    }
+
+    /**
+     * Returns the computable which produces an input token.
+     * \param i The index of the input token.
+     * \return The computable (NULL = input stream).
+     */
+    inline Computable* getSource(uint i) const{
+        assert(i < dInput);
+        return sources[i];
+    }
+
+    /**
+     * Returns the index of the input token which receives the data
+     * produced by a computable.
+     * \param c The computable (NULL = input stream).
+     * \return The index of the input token.
+     */
+    inline uint getSourcePort(Computable* c) const{
+        for(uint i = 0; i < dInput; i++){
+            if(sources[i] == c){
+                return i;
+            }
         }
-        tInput[sourcesMap[c]].setTask(t);
+        throw std::runtime_error("Computable non existing.");
     }
 
     inline void setSourceInStream(){
-        sourcesMap.emplace((Computable*) NULL, dInput);
+        assert(dInput < MAX_INSTRUCTION_INPUTS);
+        sources[dInput] = NULL;
         ++dInput;
-        assert(dInput <= MAX_INSTRUCTION_INPUTS);
     }
 
     inline void setSource(Computable* c = NULL){
-        if(c){
-            sourcesMap.emplace(c, dInput);
-        }else{
+        if(!c){
             throw std::runtime_error("Impossible to set NULL source.");
         }
+        assert(dInput < MAX_INSTRUCTION_INPUTS);
+        sources[dInput] = c;
         ++dInput;
-        assert(dInput <= MAX_INSTRUCTION_INPUTS);
     }
 
     inline void setDestination(uint id, Computable* c = NULL){
-        TokenId ti(graphId, id);
-        tOutput[dOutput] = OutputToken(NULL, ti);
-        if(c){
-            destinationsMap.emplace(c, dOutput);
-        }else{
+        if(!c){
             throw std::runtime_error("Impossible to set NULL destination.");
         }
+        assert(dOutput < MAX_INSTRUCTION_INPUTS);
+        TokenId ti(graphId, id);
+        tOutput[dOutput] = OutputToken(NULL, ti);
+        destinations[dOutput] = c;
         ++dOutput;
-        assert(dOutput <= MAX_INSTRUCTION_INPUTS);
     }
 
     inline void setDestinationOutStream(){
+        assert(dOutput < MAX_INSTRUCTION_INPUTS);
         TokenId ti;
         ti.setOutputStream();
         tOutput[dOutput] = OutputToken(NULL, ti);
-        destinationsMap.emplace((Computable*) NULL, dOutput);
+        destinations[dOutput] = NULL;
         ++dOutput;
-        assert(dOutput <= MAX_INSTRUCTION_INPUTS);
+    }
+
+    /**
+     * Sets the index of the input token of the destination instruction
+     * which receives an output token.
+     * \param i The index of the output token.
+     * \param port The index of the input token in the destination.
+     */
+    inline void setDestinationPort(uint i, uint port){
+        assert(i < dOutput);
+        tOutput[i].dest.setPortId(port);
     }
 
     inline void addOffset(size_t offset){
@@ -207,6 +290,41 @@ public:
         return graphId;
     }
 
+    /**
+     * Returns the id of the interpreter which computed the instruction.
+     * \return The id of the interpreter which computed the instruction,
+     *         -1 if the instruction has not been computed.
+     */
+    inline int getWorker() const{
+        return worker;
+    }
+
+    /**
+     * Sets the id of the interpreter which computed the instruction.
+     * \param w The id of the interpreter.
+     */
+    inline void setWorker(int w){
+        worker = w;
+    }
+
+    /**
+     * Returns the next instruction of the batch this instruction
+     * belongs to.
+     * \return The next instruction of the batch, NULL if this is the last one.
+     */
+    inline Mdfi* getBatchNext() const{
+        return batchNext;
+    }
+
+    /**
+     * Sets the next instruction of the batch this instruction belongs to.
+     * \param next The next instruction of the batch (NULL if this is the
+     *        last one).
+     */
+    inline void setBatchNext(Mdfi* next){
+        batchNext = next;
+    }
+
     /**
      * Sets the id of the graph.
      * \param newd The new id of the graph.
@@ -225,6 +343,21 @@ public:
         return comp;
     }
 
+    /**
+     * Fuses the instruction with its only successor. The instruction
+     * will compute \e c and will have the outputs of the successor.
+     * \param next The successor of the instruction.
+     * \param c The computable executing the two instructions in sequence.
+     */
+    inline void fuse(const Mdfi& next, Computable* c){
+        comp = c;
+        dOutput = next.dOutput;
+        for(uint i = 0; i < dOutput; i++){
+            destinations[i] = next.destinations[i];
+            tOutput[i] = next.tOutput[i];
+        }
+    }
+
     /**
      * Updates the destinations of the instructions.
      * \param v \e v[i] is the new identifier of the instruction that
@@ -240,12 +373,10 @@ public:
 
     void clearInput(){
         dInput = 0;
-        sourcesMap.clear();
     }
 
     void clearOutput(){
         dOutput = 0;
-        destinationsMap.clear();
     }
 };
 
@@ -29,7 +29,9 @@
 #define NORNIR_DF_COMPUTABLE_HPP_
 
 #include "../stream.hpp"
-#include <map>
+#include <cassert>
+#include <stdexcept>
+#include <tuple>
 
 namespace nornir{
 namespace dataflow{
@@ -68,37 +70,90 @@ namespace dataflow{
  * \endcode
  */
 
+/**
+ * Maximum number of inputs (and outputs) of an instruction.
+ */
+#define MAX_INSTRUCTION_INPUTS 8
+
 class Mdfi;
 class Farm;
 class Pipeline;
 class EmitterWorkerCollector;
+class FusedComputable;
 class Computable;
 
+/**
+ * Data received and produced by a computable. Inputs and outputs are
+ * stored in fixed slots (ports), numbered in the order in which the
+ * links of the instruction have been created. They can be accessed
+ * either by port or by the computable at the other end of the link.
+ */
 class Data{
 private:
     friend class Mdfi;
     friend class Farm;
     friend class Pipeline;
     friend class EmitterWorkerCollector;
-    std::map<Computable*, void*> _sources;
-    std::map<Computable*, void**> _destinations;
+    friend class FusedComputable;
+    Computable* _sourceKeys[MAX_INSTRUCTION_INPUTS];
+    void* _inputs[MAX_INSTRUCTION_INPUTS];
+    uint _numInputs;
+    Computable* _destinationKeys[MAX_INSTRUCTION_INPUTS];
+    void** _outputs[MAX_INSTRUCTION_INPUTS];
+    uint _numOutputs;
+
+    /**
+     * Adds an input port. The computable must not be already present.
+     * NULL = Input stream.
+     */
+    inline void addSource(void* s, Computable* c){
+        assert(_numInputs < MAX_INSTRUCTION_INPUTS);
+        _sourceKeys[_numInputs] = c;
+        _inputs[_numInputs] = s;
+        ++_numInputs;
+    }
+
+    /**
+     * Adds an output port. The computable must not be already present.
+     * NULL = Output stream.
+     */
+    inline void addDestination(void** d, Computable* c){
+        assert(_numOutputs < MAX_INSTRUCTION_INPUTS);
+        _destinationKeys[_numOutputs] = c;
+        _outputs[_numOutputs] = d;
+        ++_numOutputs;
+    }
 
     /**
      * NULL = Input stream.
      */
     void setSource(void* s, Computable* c = NULL){
+        for(uint i = 0; i < _numInputs; i++){
+            if(_sourceKeys[i] == c){
+                _inputs[i] = s;
+                return;
+            }
+        }
         //cppcheck-suppress nullPointerDefaultArg
-        _sources[c] = s;
+        addSource(s, c);
     }
 
     /**
      * NULL = Output stream.
      */
     void setDestination(void** d, Computable* c = NULL){
+        for(uint i = 0; i < _numOutputs; i++){
+            if(_destinationKeys[i] == c){
+                _outputs[i] = d;
+                return;
+            }
+        }
         //cppcheck-suppress nullPointerDefaultArg
-        _destinations[c] = d;
+        addDestination(d, c);
     }
 public:
+    Data():_numInputs(0), _numOutputs(0){;}
+
     /**
      * Retreive the data received from a specific computable.
      * @param c The computable from which the data should be received.
@@ -108,18 +163,20 @@ public:
      */
     void* getInput(Computable* c = NULL){
         if(!c){
-            if(_sources.size() != 1){
+            if(_numInputs != 1){
                 throw std::runtime_error("You can avoid to specify the instruction from" \
                                          "which you want to receive the data only if this" \
                                          "instruction has only 1 input.");
             }else{
-                return _sources.begin()->second;
+                return _inputs[0];
             }
         }else{
-            if(_sources.find(c) == _sources.end()){
-                throw std::runtime_error("Impossible to receive from computable.");
+            for(uint i = 0; i < _numInputs; i++){
+                if(_sourceKeys[i] == c){
+                    return _inputs[i];
+                }
             }
-            return _sources[c];
+            throw std::runtime_error("Impossible to receive from computable.");
         }
     }
 
@@ -131,21 +188,71 @@ public:
      */
     void setOutput(void* x, Computable* c = NULL){
         if(!c){
-            if(_destinations.size() != 1){
+            if(_numOutputs != 1){
                 throw std::runtime_error("You can avoid to specify the instruction to" \
                                          "which you want to send the data only if this" \
                                          "instruction has only 1 output.");
             }else{
-                *(_destinations.begin()->second) = x;
+                *(_outputs[0]) = x;
             }
         }else{
-            if(_destinations.find(c) == _destinations.end()){
-                throw std::runtime_error("Impossible to send to computable.");
+            for(uint i = 0; i < _numOutputs; i++){
+                if(_destinationKeys[i] == c){
+                    *(_outputs[i]) = x;
+                    return;
+                }
             }
-            *(_destinations[c]) = x;
+            throw std::runtime_error("Impossible to send to computable.");
+        }
+    }
+
+    /**
+     * Returns the number of input ports.
+     * @return The number of input ports.
+     */
+    inline uint getNumInputs() const{
+        return _numInputs;
+    }
+
+    /**
+     * Returns the number of output ports.
+     * @return The number of output ports.
+     */
+    inline uint getNumOutputs() const{
+        return _numOutputs;
+    }
+
+    /**
+     * Retrieves the data received on an input port.
+     * @param port The index of the port.
+     */
+    inline void* getInputAt(uint port) const{
+        if(port >= _numInputs){
+            throw std::runtime_error("Input port not existing.");
         }
+        return _inputs[port];
+    }
+
+    /**
+     * Returns all the inputs, one for each input port.
+     * @return An array with getNumInputs() inputs. It is valid
+     *         until the computation ends.
+     */
+    inline void* const* getInputs() const{
+        return _inputs;
     }
 
+    /**
+     * Sends a result on an output port.
+     * @param port The index of the port.
+     * @param x The result.
+     */
+    inline void setOutputAt(uint port, void* x){
+        if(port >= _numOutputs){
+            throw std::runtime_error("Output port not existing.");
+        }
+        *(_outputs[port]) = x;
+    }
 };
 
 class Computable{
@@ -162,6 +269,82 @@ public:
     virtual void compute(Data* d) = 0;
 };
 
+/**
+ * Types of the inputs of a TypedComputable.
+ */
+template <typename... T> struct Inputs{};
+
+/**
+ * Types of the outputs of a TypedComputable.
+ */
+template <typename... T> struct Outputs{};
+
+/**
+ * Moves the first N elements of a tuple from/to the ports of a Data.
+ */
+template <size_t N, typename Tuple> struct DataPorts{
+    static inline void get(Data* d, Tuple& t){
+        DataPorts<N - 1, Tuple>::get(d, t);
+        std::get<N - 1>(t) = static_cast<typename std::tuple_element<N - 1, Tuple>::type>(d->getInputAt(N - 1));
+    }
+
+    static inline void set(Data* d, const Tuple& t){
+        DataPorts<N - 1, Tuple>::set(d, t);
+        d->setOutputAt(N - 1, (void*) std::get<N - 1>(t));
+    }
+};
+
+template <typename Tuple> struct DataPorts<0, Tuple>{
+    static inline void get(Data* d, Tuple& t){;}
+    static inline void set(Data* d, const Tuple& t){;}
+};
+
+template <typename I, typename O> class TypedComputable;
+
+/**
+ * \class TypedComputable
+ * A computation with typed inputs and outputs. The i-th input is received
+ * on the i-th input port of the instruction, i.e. from the i-th computable
+ * linked to this one. The i-th output is sent on the i-th output port,
+ * i.e. to the i-th computable this one has been linked to. Ports are
+ * accessed by index, without any lookup.
+ *
+ * \code
+ * class Sum: public TypedComputable<Inputs<int, int>, Outputs<int> >{
+ * public:
+ *     void compute(const InputPorts& in, OutputPorts& out){
+ *         std::get<0>(out) = new int(*std::get<0>(in) + *std::get<1>(in));
+ *     }
+ * };
+ * \endcode
+ */
+template <typename... I, typename... O>
+class TypedComputable<Inputs<I...>, Outputs<O...> >: public Computable{
+public:
+    typedef std::tuple<I*...> InputPorts;
+    typedef std::tuple<O*...> OutputPorts;
+
+    /**
+     * This method computes the result.
+     * \param in The inputs.
+     * \param out The outputs, to be set by the method.
+     */
+    virtual void compute(const InputPorts& in, OutputPorts& out) = 0;
+
+    void compute(Data* d){
+        if(d->getNumInputs() != sizeof...(I) ||
+           d->getNumOutputs() != sizeof...(O)){
+            throw std::runtime_error("The number of links doesn't match the "
+                                     "number of ports of the computable.");
+        }
+        InputPorts in;
+        OutputPorts out;
+        DataPorts<sizeof...(I), InputPorts>::get(d, in);
+        compute(in, out);
+        DataPorts<sizeof...(O), OutputPorts>::set(d, out);
+    }
+};
+
 }
 }
 
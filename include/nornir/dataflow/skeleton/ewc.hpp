@@ -36,42 +36,110 @@ namespace dataflow{
 
 class EmitterWorkerCollector;
 
+/**
+ * Splits the input among the workers. The i-th partition is sent on the
+ * i-th output port, i.e. to the i-th worker.
+ */
 class Scatterer: public Computable{
-    friend Mdfg* compile(Computable* c);
-private:
-    std::vector<Computable*> _workers;
 protected:
     size_t _numPartitions;
 public:
-    explicit Scatterer(size_t numPartitions):_numPartitions(numPartitions){;}
+    explicit Scatterer(size_t numPartitions):_numPartitions(numPartitions){
+        if(_numPartitions > MAX_INSTRUCTION_INPUTS){
+            throw std::runtime_error("Too many partitions.");
+        }
+    }
 
-    virtual std::vector<void*> compute(void* in) = 0;
+    /**
+     * Splits the input.
+     * \param in The input.
+     * \param out Preallocated array of _numPartitions slots. The i-th
+     *        partition must be stored in out[i].
+     */
+    virtual void scatter(void* in, void** out) = 0;
 
     void compute(Data* d){
-        std::vector<void*> r = compute(d->getInput());
+        void* out[MAX_INSTRUCTION_INPUTS];
+        scatter(d->getInputAt(0), out);
         for(size_t i = 0; i < _numPartitions; i++){
-            d->setOutput(r.at(i), _workers.at(i));
+            d->setOutputAt(i, out[i]);
         }
     }
 };
 
+/**
+ * Merges the results of the workers. The result of the i-th worker
+ * is received on the i-th input port.
+ */
 class Gatherer: public Computable{
-    friend Mdfg* compile(Computable* c);
-private:
-    std::vector<Computable*> _workers;
 protected:
     size_t _numPartitions;
 public:
-    explicit Gatherer(size_t numPartitions):_numPartitions(numPartitions){;}
+    explicit Gatherer(size_t numPartitions):_numPartitions(numPartitions){
+        if(_numPartitions > MAX_INSTRUCTION_INPUTS){
+            throw std::runtime_error("Too many partitions.");
+        }
+    }
 
-    virtual void* compute(std::vector<void*> in) = 0;
+    /**
+     * Merges the partitions.
+     * \param in Array of _numPartitions slots, in[i] is the result of
+     *        the i-th worker.
+     * \return The result.
+     */
+    virtual void* gather(void* const* in) = 0;
 
     void compute(Data* d){
-        std::vector<void*> inputs;
+        d->setOutput(gather(d->getInputs()));
+    }
+};
+
+/**
+ * Scatterer returning the partitions in a vector, as in the previous
+ * interface. Kept for compatibility, Scatterer should be preferred since
+ * it doesn't allocate a vector for each input.
+ */
+class VectorScatterer: public Scatterer{
+public:
+    explicit VectorScatterer(size_t numPartitions):Scatterer(numPartitions){;}
+
+    using Scatterer::compute;
+
+    /**
+     * Splits the input.
+     * \param in The input.
+     * \return The partitions. The i-th partition is sent to the i-th worker.
+     */
+    virtual std::vector<void*> compute(void* in) = 0;
+
+    void scatter(void* in, void** out){
+        std::vector<void*> r = compute(in);
         for(size_t i = 0; i < _numPartitions; i++){
-            inputs.push_back(d->getInput(_workers.at(i)));
+            out[i] = r.at(i);
         }
-        d->setOutput(compute(inputs));
+    }
+};
+
+/**
+ * Gatherer receiving the partitions in a vector, as in the previous
+ * interface. Kept for compatibility, Gatherer should be preferred since
+ * it doesn't allocate a vector for each result.
+ */
+class VectorGatherer: public Gatherer{
+public:
+    explicit VectorGatherer(size_t numPartitions):Gatherer(numPartitions){;}
+
+    using Gatherer::compute;
+
+    /**
+     * Merges the partitions.
+     * \param in The partitions, in[i] is the result of the i-th worker.
+     * \return The result.
+     */
+    virtual void* compute(std::vector<void*> in) = 0;
+
+    void* gather(void* const* in){
+        return compute(std::vector<void*>(in, in + _numPartitions));
     }
 };
 
@@ -91,7 +159,7 @@ public:
      */
     ReduceScatterer(size_t numPartitions, bool autoDelete=true);
 
-    std::vector<void*> compute(void* in);
+    void scatter(void* in, void** out);
 };
 
 /**
@@ -121,7 +189,7 @@ public:
      */
     explicit ReduceGatherer(size_t numPartitions);
 
-    void* compute(std::vector<void*> in);
+    void* gather(void* const* in);
 };
 
 /**
@@ -140,7 +208,7 @@ public:
      */
     MapScatterer(size_t numPartitions, bool autoDelete = true);
 
-    std::vector<void*> compute(void* in);
+    void scatter(void* in, void** out);
 };
 
 /**
@@ -167,7 +235,7 @@ template <typename V> class MapGatherer: public Gatherer{
 public:
     explicit MapGatherer(size_t numPartitions);
 
-    void* compute(std::vector<void*> in);
+    void* gather(void* const* in);
 };
 
 
@@ -226,20 +294,19 @@ public:
      * This method computes the result sequentially.
      */
     inline void compute(Data* d){
-        void *fromWorker;
+        void* eRes[MAX_INSTRUCTION_INPUTS];
+        void* cInput[MAX_INSTRUCTION_INPUTS];
 
-        std::vector<void*> eRes = _scatterer->compute(d->getInput());
-        std::vector<void*> cInput;
+        _scatterer->scatter(d->getInput(), eRes);
 
-        Data dw;
         for(uint i = 0; i < _nWorkers; i++){
-            dw.setSource(eRes.at(i));
-            dw.setDestination(&fromWorker);
+            Data dw;
+            dw.setSource(eRes[i]);
+            dw.setDestination(&(cInput[i]));
             _workers.at(i)->compute(&dw);
-            cInput.push_back(fromWorker);
         }
 
-        d->setOutput(_gatherer->compute(cInput));
+        d->setOutput(_gatherer->gather(cInput));
     }
 
     /**
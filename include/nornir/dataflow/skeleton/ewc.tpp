@@ -33,9 +33,8 @@ ReduceScatterer<T>::ReduceScatterer(size_t numPartitions, bool autoDelete):
     Scatterer(numPartitions), _autoDelete(autoDelete){;}
 
 template <typename T>
-std::vector<void*> ReduceScatterer<T>::compute(void* in){
+void ReduceScatterer<T>::scatter(void* in, void** out){
     ArrayWrapper<T*>* task = (ArrayWrapper<T*>*) in;
-    std::vector<void*> r;
     int dim = task->size();
     int mod = dim%_numPartitions;
     int size = dim/_numPartitions;
@@ -62,11 +61,10 @@ std::vector<void*> ReduceScatterer<T>::compute(void* in){
             toAdd->set(j,task->get(k));
             k++;
         }
-        r.push_back(toAdd);
+        out[i] = toAdd;
     }
     if(_autoDelete) delete task;
 #endif
-    return r;
 }
 
 
@@ -114,8 +112,8 @@ ReduceGatherer<T, fun>::ReduceGatherer(size_t numPartitions):
     Gatherer(numPartitions){;}
 
 template<typename T, T*(*fun)(T*,T*)>
-void* ReduceGatherer<T, fun>::compute(std::vector<void*> in){
-    assert(in.size() > 1);
+void* ReduceGatherer<T, fun>::gather(void* const* in){
+    assert(_numPartitions > 1);
     T *p, *q;
 #ifdef NOCOPY
     ArrayIndexes<T*>* ai;
@@ -126,8 +124,8 @@ void* ReduceGatherer<T, fun>::compute(std::vector<void*> in){
     q = ai->getArray()->get(ai->geti());
     delete ai;
 #else
-    p = static_cast<T*>(in.at(0));
-    q = static_cast<T*>(in.at(1));
+    p = static_cast<T*>(in[0]);
+    q = static_cast<T*>(in[1]);
 #endif
     T* x = fun(p,q);
     for(int i = 2; i < _numPartitions; i++){
@@ -140,7 +138,7 @@ void* ReduceGatherer<T, fun>::compute(std::vector<void*> in){
         }
         delete ai;
 #else
-        T* a = static_cast<T*>(in.at(i));
+        T* a = static_cast<T*>(in[i]);
 #endif
         x = fun(x, a);
     }
@@ -152,9 +150,8 @@ MapScatterer<T>::MapScatterer(size_t numPartitions, bool autoDelete):
     Scatterer(numPartitions), _autoDelete(autoDelete){;}
 
 template <typename T>
-std::vector<void*> MapScatterer<T>::compute(void* in){
+void MapScatterer<T>::scatter(void* in, void** out){
     ArrayWrapper<T*>* task = (ArrayWrapper<T*>*) in;
-    std::vector<void*> r;
     uint dim = task->size();
     uint mod = dim % _numPartitions;
     uint size = dim / _numPartitions;
@@ -181,13 +178,12 @@ std::vector<void*> MapScatterer<T>::compute(void* in){
             toAdd->set(j,task->get(k));
             k++;
         }
-        r.push_back(toAdd);
+        out[i] = toAdd;
     }
     if(_autoDelete){
         delete task;
     }
 #endif
-    return r;
 }
 
 template <typename T, typename V, V*(*fun)(T*) >
@@ -217,7 +213,7 @@ template <typename V>
 MapGatherer<V>::MapGatherer(size_t numPartitions):Gatherer(numPartitions){;}
 
 template <typename V>
-void* MapGatherer<V>::compute(std::vector<void*> in){
+void* MapGatherer<V>::gather(void* const* in){
 #ifdef NOCOPY
     ArrayIndexes<void*>* ai;
     for(uint i=0; i<_numPartitions-1; i++){
@@ -230,14 +226,14 @@ void* MapGatherer<V>::compute(std::vector<void*> in){
 #else
     uint size = 0;
     for(uint i = 0; i < _numPartitions; i++){
-        size += ((ArrayWrapper<void*>*) in.at(i))->size();
+        size += ((ArrayWrapper<void*>*) in[i])->size();
     }
 
 
     ArrayWrapper<V*> *aw = new ArrayWrapper<V*>(size), *tempAw;
     uint tempSize, k = 0;
     for(uint i = 0; i < _numPartitions; i++){
-        tempAw = ((ArrayWrapper<V*>*) in.at(i));
+        tempAw = ((ArrayWrapper<V*>*) in[i]);
         tempSize = tempAw->size();
         for(uint j = 0; j < tempSize; j++){
             aw->set(k,tempAw->get(j));
@@ -0,0 +1,180 @@
+/*
+ * staticpipeline.hpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+#ifndef NORNIR_DF_STATICPIPELINE_HPP_
+#define NORNIR_DF_STATICPIPELINE_HPP_
+
+#include "computable.hpp"
+#include "pipeline.hpp"
+
+#include <type_traits>
+
+namespace nornir{
+namespace dataflow{
+
+/**
+ * \class StaticStage
+ * Base class for the stages of a StaticPipeline. A stage must define a
+ * non virtual function
+ *
+ * \code
+ * Out* compute(In* x);
+ * \endcode
+ *
+ * which is called directly by the pipeline (and can thus be inlined).
+ *
+ * \tparam In The type of the input elements of the stage.
+ * \tparam Out The type of the output elements of the stage.
+ */
+template <typename In, typename Out> class StaticStage{
+public:
+    typedef In InputType;
+    typedef Out OutputType;
+};
+
+/**
+ * \class StaticStageComputable
+ * Wraps a stage of a StaticPipeline into a Computable, so that it can be
+ * executed by the Interpreter.
+ */
+template <typename S> class StaticStageComputable:
+        public TypedComputable<Inputs<typename S::InputType>,
+                               Outputs<typename S::OutputType> >{
+private:
+    S _stage;
+public:
+    typedef TypedComputable<Inputs<typename S::InputType>,
+                            Outputs<typename S::OutputType> > Base;
+    using Base::compute;
+
+    explicit StaticStageComputable(const S& stage):_stage(stage){;}
+
+    void compute(const typename Base::InputPorts& in,
+                 typename Base::OutputPorts& out){
+        std::get<0>(out) = _stage.compute(std::get<0>(in));
+    }
+};
+
+template <typename... S> class StaticPipeline;
+
+/**
+ * \class StaticPipeline
+ * A pipeline whose stages are known at compile time. The stages are
+ * called directly, without virtual dispatch and without interpretation,
+ * and the type of the output of each stage must match the type of the
+ * input of the next one.
+ *
+ * \code
+ * class Square: public StaticStage<int, int>{
+ * public:
+ *     int* compute(int* x){
+ *         *x = *x * *x;
+ *         return x;
+ *     }
+ * };
+ *
+ * StaticPipeline<Square, Square, Print> pipe;
+ * \endcode
+ *
+ * The pipeline can be executed by a StaticInterpreter (which replicates
+ * it on the workers of a nornir::Farm) or, through toComputable(), by
+ * the Interpreter, with one instruction for each stage.
+ *
+ * \tparam S The types of the stages, derived from StaticStage.
+ */
+template <typename S> class StaticPipeline<S>{
+private:
+    S _stage;
+public:
+    typedef typename S::InputType InputType;
+    typedef typename S::OutputType OutputType;
+
+    StaticPipeline(){;}
+
+    explicit StaticPipeline(const S& stage):_stage(stage){;}
+
+    /**
+     * Computes all the stages of the pipeline.
+     * \param x The input element.
+     * \return The output of the last stage.
+     */
+    inline OutputType* compute(InputType* x){
+        return _stage.compute(x);
+    }
+
+    /**
+     * Builds the equivalent runtime skeleton.
+     * \return A skeleton with the same structure of this pipeline. It
+     *         must be deleted by the caller.
+     */
+    Computable* toComputable() const{
+        return new StaticStageComputable<S>(_stage);
+    }
+};
+
+template <typename S, typename... R> class StaticPipeline<S, R...>{
+private:
+    S _stage;
+    StaticPipeline<R...> _next;
+public:
+    typedef typename S::InputType InputType;
+    typedef typename StaticPipeline<R...>::OutputType OutputType;
+
+    static_assert(std::is_same<typename S::OutputType,
+                               typename StaticPipeline<R...>::InputType>::value,
+                  "The output type of a stage must be the input type of "
+                  "the next stage.");
+
+    StaticPipeline(){;}
+
+    explicit StaticPipeline(const S& stage, const R&... next):
+            _stage(stage), _next(next...){;}
+
+    /**
+     * Computes all the stages of the pipeline.
+     * \param x The input element.
+     * \return The output of the last stage.
+     */
+    inline OutputType* compute(InputType* x){
+        return _next.compute(_stage.compute(x));
+    }
+
+    /**
+     * Builds the equivalent runtime skeleton.
+     * \return A skeleton with the same structure of this pipeline. It
+     *         must be deleted by the caller.
+     */
+    Computable* toComputable() const{
+        return new Pipeline(new StaticStageComputable<S>(_stage),
+                            _next.toComputable(), true);
+    }
+};
+
+}
+}
+
+#endif /* NORNIR_DF_STATICPIPELINE_HPP_ */
@@ -34,6 +34,9 @@
 #include <cstdlib>
 
 namespace nornir{
+
+class TraceReplayer;
+
 namespace dataflow{
 
 /**
@@ -123,6 +126,16 @@ public:
      * \return \e False if the EndOfStream is arrived, \e true otherwise.
      */
     virtual bool hasNext() = 0;
+
+    /**
+     * Called by the interpreter when the number of elements it can
+     * accept (credits) changes. A source which can be slowed down (e.g.
+     * by not reading from a socket) should not produce more elements
+     * than the available credits, since the interpreter does not call
+     * next() when it has no credits. By default it is ignored.
+     * \param credits The number of elements the interpreter can accept.
+     */
+    virtual void setCredits(size_t credits){;}
 };
 
 typedef struct{
@@ -186,6 +199,30 @@ public:
     void init();
 };
 
+/**
+ * An input stream which replays a trace (see nornir::TraceReplayer).
+ * Each element is produced when its arrival time is reached.
+ */
+class InputStreamTrace: public InputStream{
+private:
+    TraceReplayer& _replayer;
+protected:
+    /**
+     * This function must be implemented in order to create the
+     * object corresponding to an item of the trace.
+     * @param id The index of the item in the trace.
+     * @return The object to be produced in the stream.
+     **/
+    virtual void* createObject(size_t id) = 0;
+
+public:
+    explicit InputStreamTrace(TraceReplayer& replayer);
+
+    void* next();
+
+    bool hasNext();
+};
+
 /**
  * A generic output stream.
  */
@@ -47,12 +47,13 @@ class TokenId{
 private:
     ulong graphId;///<The id of the graph.
     uint mdfiId;///<The id of the instruction.
+    uint portId;///<The index of the input token in the instruction.
     bool isOutputStream;///<True if the destination is the output stream.
 public:
     /**
      * Constructor of the identifier.
      */
-    inline TokenId():graphId(MAXUNSLONGINT), mdfiId(MAXUNSINT),
+    inline TokenId():graphId(MAXUNSLONGINT), mdfiId(MAXUNSINT), portId(0),
     isOutputStream(false){;}
 
     /**
@@ -61,14 +62,15 @@ public:
      * \param instrid Identifier of the instruction.
      */
     inline TokenId(ulong gid, uint instrid):
-            graphId(gid), mdfiId(instrid), isOutputStream(false){;}
+            graphId(gid), mdfiId(instrid), portId(0), isOutputStream(false){;}
 
     /**
      * Constructor of the identifier.
      * \param instrid Identifier of the instruction.
      */
     explicit inline TokenId(uint instrid):
-            graphId(MAXUNSLONGINT), mdfiId(instrid), isOutputStream(false){;}
+            graphId(MAXUNSLONGINT), mdfiId(instrid), portId(0),
+            isOutputStream(false){;}
 
     /**Sets the destination to the output stream.**/
     inline void setOutputStream(){
@@ -127,6 +129,22 @@ public:
     inline void setMdfiId(unsigned int id){
         mdfiId=id;
     }
+
+    /**
+     * Returns the index of the input token in the destination instruction.
+     * \return The index of the input token in the destination instruction.
+     */
+    inline unsigned int getPortId(){
+        return portId;
+    }
+
+    /**
+     * Sets the index of the input token in the destination instruction.
+     * \param id The index of the input token in the destination instruction.
+     */
+    inline void setPortId(unsigned int id){
+        portId=id;
+    }
 };
 
 /**
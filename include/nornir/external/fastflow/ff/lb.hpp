@@ -601,6 +601,19 @@ public:
      */
     inline size_t getNWorkers() const { return workers.size();}
 
+    /**
+     * \brief Sets the number of running workers
+     *
+     * It changes the number of workers the tasks are sent to, without
+     * freezing or thawing any worker. It must only be called by the
+     * load balancer thread.
+     *
+     * \param nw The new number of running workers
+     */
+    inline void setnworkers(size_t nw) {
+        running = (nw > workers.size()) ? workers.size() : nw;
+    }
+
     const svector<ff_node*>& getWorkers() const { return workers; }
 
     /**
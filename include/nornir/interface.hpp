@@ -32,8 +32,9 @@
 #include <nornir/knob.hpp>
 #include <nornir/configuration.hpp>
 
+#include <atomic>
 #include <cstddef>
-#include <queue>
+#include <thread>
 
 namespace nornir{
 
@@ -41,11 +42,19 @@ namespace nornir{
 
 template <typename I, typename O> class FarmBase;
 
+namespace dataflow{
+    class Interpreter;
+}
+
 // For internal use
 class OrderedTask{
 private:
     std::pair<unsigned long long, void*> _pair;
 public:
+    OrderedTask():_pair(0, NULL){
+        ;
+    }
+
     OrderedTask(unsigned long long id, void* task):_pair(id, task){
         ;
     }
@@ -54,6 +63,10 @@ public:
         return _pair.first;
     }
 
+    void setId(unsigned long long id){
+        _pair.first = id;
+    }
+
     void* getTask() const{
         return _pair.second;
     }
@@ -63,10 +76,80 @@ public:
     }
 };
 
-class CompareOTasks{
+#define NORNIR_ORDERING_WINDOW_DEFAULT 4096
+
+// For internal use
+/**
+ * Reorder window used when the farm preserves the ordering. At most
+ * 'size' tasks can be in the farm at the same time, so the task with
+ * identifier id is wrapped in the slot id % size of a preallocated slab
+ * and stored by the gatherer in the position id % size of its window.
+ * When the window is full, the scheduler waits until the gatherer emits
+ * the oldest task.
+ */
+class OrderingWindow: public mammut::utils::NonCopyable{
+private:
+    std::vector<OrderedTask> _slab;
+    unsigned long long _mask;
+    char _padding[NORNIR_CACHE_LINE_SIZE];
+    // Identifier of the next task the gatherer will emit. Tasks with
+    // smaller identifiers are not in the farm anymore.
+    std::atomic<unsigned long long> _released;
 public:
-    bool operator()(const OrderedTask& a, const OrderedTask& b){
-        return a.getId() > b.getId();
+    /**
+     * @param size The size of the window. Will be rounded up to
+     *        a power of 2.
+     */
+    explicit OrderingWindow(size_t size):_mask(0), _released(0){
+        size_t realSize = 1;
+        while(realSize < size){
+            realSize *= 2;
+        }
+        _slab.resize(realSize);
+        _mask = realSize - 1;
+    }
+
+    size_t getSize() const{
+        return _slab.size();
+    }
+
+    /**
+     * Wraps a task. Can only be called by the scheduler.
+     * @param id The identifier of the task.
+     * @param task The task.
+     * @param blocking If true and the window is full, waits until a slot is
+     *        available. Otherwise, returns NULL if the window is full.
+     * @return The wrapped task.
+     */
+    OrderedTask* wrap(unsigned long long id, void* task, bool blocking){
+        while(id - _released.load(std::memory_order_acquire) >= _slab.size()){
+            if(!blocking){
+                return NULL;
+            }
+            std::this_thread::yield();
+        }
+        OrderedTask* ot = &(_slab[id & _mask]);
+        ot->setId(id);
+        ot->setTask(task);
+        return ot;
+    }
+
+    /**
+     * Returns the position in the window of a task.
+     * @param id The identifier of the task.
+     * @return The position in the window of a task.
+     */
+    size_t getPosition(unsigned long long id) const{
+        return id & _mask;
+    }
+
+    /**
+     * Releases all the tasks with identifier lower than id. Can only be
+     * called by the gatherer.
+     * @param id The identifier of the next task to be emitted.
+     */
+    void release(unsigned long long id){
+        _released.store(id, std::memory_order_release);
     }
 };
 
@@ -81,6 +164,7 @@ private:
     bool _ondemand;
     bool _preserveOrdering;
     unsigned long long _nextTaskId;
+    OrderingWindow* _window;
 
     void setLb(ff::ff_loadbalancer* lb){
         _lb = lb;
@@ -90,29 +174,42 @@ private:
         _ondemand = true;
     }
 
-    void preserveOrdering(){
+    void preserveOrdering(OrderingWindow* window){
         _preserveOrdering = true;
+        _window = window;
     }
 protected:
-    void* transformTaskForOrdering(O* task){
-        if(!task){
-            return NULL;
+    /**
+     * Wraps the task if ordering must be preserved. The identifier is
+     * only consumed by commitTaskForOrdering, i.e. once the task has
+     * been sent.
+     * @param blocking If false and the ordering window is full,
+     *        NULL is returned.
+     */
+    void* transformTaskForOrdering(O* task, bool blocking = true){
+        if(!task || (void*) task == GO_ON){
+            return (void*) task;
         }
         if(_preserveOrdering){
-            OrderedTask* ot = new OrderedTask(_nextTaskId, (void*) task);
-            ++_nextTaskId;
-            return (void*) ot;
+            return (void*) _window->wrap(_nextTaskId, (void*) task, blocking);
         }else{
             return (void*) task;
         }
     }
 
+    void commitTaskForOrdering(void* realTask){
+        if(_preserveOrdering && realTask && realTask != GO_ON){
+            ++_nextTaskId;
+        }
+    }
+
     size_t getCurrentNumWorkers() const{
         return _lb->getnworkers();
     }
 
 public:
-    SchedulerBase():_lb(NULL), _ondemand(false), _preserveOrdering(false), _nextTaskId(0){;}
+    SchedulerBase():_lb(NULL), _ondemand(false), _preserveOrdering(false),
+                    _nextTaskId(0), _window(NULL){;}
 
     /**
      * Sends a task to one of the workers.
@@ -121,6 +218,7 @@ public:
     void send(O* task) CX11_KEYWORD(final){
         void* realTask = transformTaskForOrdering(task);
         while(!ff_send_out(realTask)){;}
+        commitTaskForOrdering(realTask);
     }
 
     /**
@@ -129,8 +227,16 @@ public:
      * @return true if the task has been sent, false otherwise.
      */
     bool sendNonBlocking(O* task) CX11_KEYWORD(final){
-        void* realTask = transformTaskForOrdering(task);
-        return ff_send_out(realTask);
+        void* realTask = transformTaskForOrdering(task, false);
+        if(task && !realTask){
+            // Ordering window full.
+            return false;
+        }
+        bool sent = ff_send_out(realTask);
+        if(sent){
+            commitTaskForOrdering(realTask);
+        }
+        return sent;
     }
 
     /**
@@ -146,6 +252,7 @@ public:
         }
         void* realTask = transformTaskForOrdering(task);
         while(!_lb->ff_send_out_to(realTask, id)){;}
+        commitTaskForOrdering(realTask);
     }
 
     /**
@@ -160,8 +267,16 @@ public:
                                          "Please ensure that your application is "
                                          "notified when a rethreading occur.");
         }
-        void* realTask = transformTaskForOrdering(task);
-        return _lb->ff_send_out_to(realTask, id);
+        void* realTask = transformTaskForOrdering(task, false);
+        if(task && !realTask){
+            // Ordering window full.
+            return false;
+        }
+        bool sent = _lb->ff_send_out_to(realTask, id);
+        if(sent){
+            commitTaskForOrdering(realTask);
+        }
+        return sent;
     }
 
     /**
@@ -210,10 +325,12 @@ template <typename I, typename O = std::nullptr_t> class Scheduler: public Sched
 private:
     // We force it to be private to avoid misuse by the user.
     using SchedulerBase<O>::transformTaskForOrdering;
+    using SchedulerBase<O>::commitTaskForOrdering;
 
     void* svc(void* task) CX11_KEYWORD(final){
         O* r = schedule((I*)(task));
         void* outTask = transformTaskForOrdering(r);
+        commitTaskForOrdering(outTask);
         if(outTask){
            return outTask;
         }else{
@@ -249,10 +366,12 @@ class Scheduler<O, std::nullptr_t>: public SchedulerBase<O>{
 private:
     // We force it to be private to avoid misuse by the user.
     using SchedulerBase<O>::transformTaskForOrdering;
+    using SchedulerBase<O>::commitTaskForOrdering;
 
     void* svc(void* task) CX11_KEYWORD(final){
         O* r = schedule();
         void* outTask = transformTaskForOrdering(r);
+        commitTaskForOrdering(outTask);
         if(outTask){
            return outTask;
         }else{
@@ -373,6 +492,13 @@ private:
     void* svc(void* t) CX11_KEYWORD(final){
         I* computeInput = getComputeInput(t);
         compute(computeInput);
+        if(this->_ordering){
+            // Nothing to emit, but the gatherer still needs to know that
+            // this task is done to move the ordering window forward.
+            OrderedTask* ot = reinterpret_cast<OrderedTask*>(t);
+            ot->setTask(GO_ON);
+            return (void*) ot;
+        }
         return (void*) GO_ON;
     }
 public:
@@ -400,10 +526,15 @@ class GathererBase: public AdaptiveNode{
 private:
     bool _ordering;
     unsigned long long _nextTaskId;
-    std::priority_queue<OrderedTask, std::vector<OrderedTask>, CompareOTasks> _priorityQueue;
+    OrderingWindow* _window;
+    // Tasks arrived before their predecessors, indexed by position
+    // in the ordering window.
+    std::vector<OrderedTask*> _arrived;
 
-    void preserveOrdering(){
+    void preserveOrdering(OrderingWindow* window){
         _ordering = true;
+        _window = window;
+        _arrived.assign(window->getSize(), NULL);
     }
 
     using AdaptiveNode::enableRethreading; // Can only be used on schedueler
@@ -415,26 +546,23 @@ protected:
     void getGatherInputs(void* t, std::vector<I*>& toReturn){
         if(_ordering){
             OrderedTask* ot = reinterpret_cast<OrderedTask*>(t);
-            if(ot->getId() == _nextTaskId){
-                // Lucky. This is the correct task.
-                toReturn.push_back(reinterpret_cast<I*>(ot->getTask()));
-                ++_nextTaskId;
-            }else{
-                // Put in queue
-                _priorityQueue.push(*ot);
-            }
-            while(!_priorityQueue.empty() && _priorityQueue.top().getId() == _nextTaskId){
-                toReturn.push_back(reinterpret_cast<I*>(_priorityQueue.top().getTask()));
-                _priorityQueue.pop();
+            _arrived[_window->getPosition(ot->getId())] = ot;
+            size_t position;
+            while((ot = _arrived[position = _window->getPosition(_nextTaskId)])){
+                if(ot->getTask() != GO_ON){
+                    toReturn.push_back(reinterpret_cast<I*>(ot->getTask()));
+                }
+                _arrived[position] = NULL;
                 ++_nextTaskId;
             }
-            delete ot;
+            // The wrappers can now be reused by the scheduler.
+            _window->release(_nextTaskId);
         }else{
             toReturn.push_back(reinterpret_cast<I*>(t));
         }
     }
 public:
-    GathererBase():_ordering(false), _nextTaskId(0){;}
+    GathererBase():_ordering(false), _nextTaskId(0), _window(NULL){;}
 
     //TODO: Receivefrom?
 };
@@ -523,6 +651,7 @@ public:
  */
 template <typename I, typename O> class FarmBase: public mammut::utils::NonCopyable{
   friend class ParallelFor;
+  friend class dataflow::Interpreter;
 protected:
     ff::ff_farm<>* _farm;
     std::vector<ff::ff_node*> _rawWorkers;
@@ -535,6 +664,7 @@ private:
     SchedulerBase<I>* _scheduler;
     GathererBase<O>* _gatherer;
     bool _feedback;
+    OrderingWindow* _orderingWindow;
 protected:
     std::vector<WorkerBase<I, O>* > _workers;
 
@@ -614,6 +744,7 @@ public:
         _paramsCreated = false;
         _feedback = false;
         _schedulerHasInput = false;
+        _orderingWindow = NULL;
     }
 
     /**
@@ -629,6 +760,7 @@ public:
         _paramsCreated = true;
         _feedback = false;
         _schedulerHasInput = false;
+        _orderingWindow = NULL;
     }
 
     /**
@@ -642,6 +774,10 @@ public:
         if(_farm){
             delete _farm;
         }
+
+        if(_orderingWindow){
+            delete _orderingWindow;
+        }
     }
 
     /**
@@ -770,16 +906,20 @@ public:
      * the farm to preserve the order of the elements.
      * This function must be called after the scheduler
      * and the gatherer have been set.
+     * @param windowSize The maximum number of tasks which can be in the
+     *        farm at the same time. When reached, the scheduler waits
+     *        for the gatherer to emit the oldest task.
      **/
-    void preserveOrdering(){
+    void preserveOrdering(size_t windowSize = NORNIR_ORDERING_WINDOW_DEFAULT){
         if(!_gatherer){
             setGatherer(new GathererDummy<O>());
         }
-        _scheduler->preserveOrdering();
+        _orderingWindow = new OrderingWindow(windowSize);
+        _scheduler->preserveOrdering(_orderingWindow);
         for(auto w : _workers){
             w->preserveOrdering();
         }
-        _gatherer->preserveOrdering();
+        _gatherer->preserveOrdering(_orderingWindow);
     }
 
     /**
@@ -1179,8 +1319,216 @@ typedef struct ParallelForRange{
 
 extern ParallelForRange terminationRange; // Just a dummy value to signal termination
 
+/**
+ * Returns the number of iterations in the range [start, end) with the
+ * given step.
+ */
+inline long long int parallelForIterations(long long int start,
+                                           long long int end,
+                                           long long int step){
+    if(end <= start){
+        return 0;
+    }
+    return (end - start + step - 1) / step;
+}
+
+/**
+ * Chase-Lev work stealing deque of iteration ranges. The owner worker
+ * pushes and pops ranges at the bottom while thieves steal from the top.
+ * Since ranges are always split in halves, a worker never holds more than
+ * log2(iterations) ranges at the same time, so we use a fixed size buffer
+ * (push fails if the buffer is full and the range is just not split).
+ */
+class ParallelForDeque: public mammut::utils::NonCopyable{
+private:
+    static const long long int _size = 128; // Must be a power of 2.
+    std::atomic<long long int> _top;
+    char _padTop[NORNIR_CACHE_LINE_SIZE - sizeof(std::atomic<long long int>)];
+    std::atomic<long long int> _bottom;
+    char _padBottom[NORNIR_CACHE_LINE_SIZE - sizeof(std::atomic<long long int>)];
+    std::atomic<long long int> _starts[_size];
+    std::atomic<long long int> _ends[_size];
+public:
+    ParallelForDeque():_top(0), _bottom(0){;}
+
+    /**
+     * Pushes a range. Can only be called by the owner.
+     * @return false if the deque is full, true otherwise.
+     */
+    bool push(long long int start, long long int end){
+        long long int b = _bottom.load(std::memory_order_relaxed);
+        long long int t = _top.load(std::memory_order_acquire);
+        if(b - t >= _size){
+            return false;
+        }
+        _starts[b & (_size - 1)].store(start, std::memory_order_relaxed);
+        _ends[b & (_size - 1)].store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Pops the last pushed range. Can only be called by the owner.
+     * @return false if the deque is empty, true otherwise.
+     */
+    bool pop(long long int& start, long long int& end){
+        long long int b = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long int t = _top.load(std::memory_order_relaxed);
+        if(t > b){
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        start = _starts[b & (_size - 1)].load(std::memory_order_relaxed);
+        end = _ends[b & (_size - 1)].load(std::memory_order_relaxed);
+        if(t == b){
+            // Last element, we may be racing with a thief.
+            bool won = _top.compare_exchange_strong(t, t + 1,
+                                                    std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * Steals the oldest (and thus largest) range. Can be called by any thread.
+     * @return false if the deque was empty or if the steal failed, true otherwise.
+     */
+    bool steal(long long int& start, long long int& end){
+        long long int t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long int b = _bottom.load(std::memory_order_acquire);
+        if(t >= b){
+            return false;
+        }
+        start = _starts[t & (_size - 1)].load(std::memory_order_relaxed);
+        end = _ends[t & (_size - 1)].load(std::memory_order_relaxed);
+        return _top.compare_exchange_strong(t, t + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Barrier used by the thread calling parallel_for to wait for the end of a
+ * loop. Each loop is a new generation: workers count down the iterations
+ * they executed and the one executing the last iteration marks the
+ * generation as completed. The waiting thread spins for a bounded time
+ * and then sleeps on a futex. Between two loops, idle workers do the same
+ * and sleep until the next generation is opened.
+ */
+class ParallelForBarrier: public mammut::utils::NonCopyable{
+private:
+    std::atomic<long long int> _pending;
+    char _padPending[NORNIR_CACHE_LINE_SIZE - sizeof(std::atomic<long long int>)];
+    // Futex word for the workers, last opened generation.
+    std::atomic<uint32_t> _generation;
+    // Futex word for the waiting thread, last completed generation.
+    std::atomic<uint32_t> _completed;
+    std::atomic<bool> _sleeping;
+    // Number of workers sleeping on _generation.
+    std::atomic<uint32_t> _parked;
+    ticks _spinTicks;
+public:
+    /**
+     * Builds the barrier.
+     * @param spinTicks Number of ticks to spin before sleeping.
+     */
+    explicit ParallelForBarrier(ticks spinTicks);
+
+    /**
+     * Starts a new generation. Must be called before giving any work
+     * to the workers.
+     * @param iterations The number of iterations of the loop.
+     */
+    void open(long long int iterations);
+
+    /**
+     * Called by the workers after executing some iterations.
+     * @param iterations The number of executed iterations.
+     */
+    void arrive(long long int iterations);
+
+    /**
+     * Waits until all the iterations of the current generation have
+     * been executed.
+     */
+    void wait();
+
+    /**
+     * Called by an idle worker which already spun for getSpinTicks()
+     * ticks. If no loop is running, sleeps until a new generation is
+     * opened (or the barrier is closed).
+     * @param queue The input queue of the worker. The worker doesn't
+     *        sleep if it is not empty.
+     */
+    void park(ff::FFBUFFER* queue);
+
+    /**
+     * Wakes up the parked workers and prevents them from parking again.
+     * Must be called before terminating the workers.
+     */
+    void close();
+
+    /**
+     * Returns the number of ticks to spin before sleeping.
+     * @return The number of ticks to spin before sleeping.
+     */
+    ticks getSpinTicks() const;
+};
+
+/**
+ * State shared by scheduler and workers when work stealing is used.
+ */
+typedef struct ParallelForStealing{
+    // One deque for each worker (also for the ones not currently active).
+    std::vector<ParallelForDeque*> deques;
+    // The initial block of each worker.
+    std::vector<ParallelForRange> blocks;
+    // Number of workers participating to the current loop.
+    std::atomic<size_t> numActive;
+    // Number of iterations of the current loop not yet executed.
+    std::atomic<long long int> pending;
+    // Ranges with at most this number of iterations are not split.
+    long long int grain;
+}ParallelForStealing;
+
+/**
+ * Per-worker accumulator used by parallel_reduce and parallel_scan. The
+ * padding keeps the values of different workers on different cache lines.
+ */
+template <typename T> struct ParallelForAccumulator{
+    T value;
+    char padding[NORNIR_CACHE_LINE_SIZE];
+};
+
+/**
+ * Combines the accumulators pairwise, in log2(accumulators.size()) steps.
+ * @return The combination of all the accumulators.
+ */
+template <typename T, typename Combine>
+inline T parallelForTreeCombine(std::vector<ParallelForAccumulator<T>>& accumulators,
+                                const Combine& combine){
+    for(size_t stride = 1; stride < accumulators.size(); stride *= 2){
+        for(size_t i = 0; i + stride < accumulators.size(); i += 2 * stride){
+            accumulators[i].value = combine(accumulators[i].value,
+                                            accumulators[i + stride].value);
+        }
+    }
+    return accumulators[0].value;
+}
+
 class ParallelForScheduler: public nornir::Scheduler<ParallelForRange, ParallelForRange>{
+private:
+    ParallelForStealing* _stealing;
 public:
+    explicit ParallelForScheduler(ParallelForStealing* stealing = NULL):
+        _stealing(stealing){;}
+
     ParallelForRange* schedule(ParallelForRange* r){
         if(r == &terminationRange){
             disableRethreading();
@@ -1190,6 +1538,24 @@ public:
             broadcast(&terminationRange);
             enableRethreading();
             return nothing();
+        }else if(_stealing){
+            // r is the whole iteration space. We give a contiguous block
+            // to each active worker. Rethreading is disabled so that the
+            // number of workers does not change while partitioning.
+            disableRethreading();
+            size_t numWorkers = getCurrentNumWorkers();
+            long long int iterations = parallelForIterations(r->start, r->end, r->step);
+            _stealing->numActive.store(numWorkers);
+            _stealing->pending.store(iterations);
+            for(size_t i = 0; i < numWorkers; i++){
+                ParallelForRange& block = _stealing->blocks[i];
+                block.start = r->start + ((iterations * i) / numWorkers) * r->step;
+                block.end = r->start + ((iterations * (i + 1)) / numWorkers) * r->step;
+                block.step = r->step;
+                sendTo(&block, i);
+            }
+            enableRethreading();
+            return nothing();
         }else{
             return r;
         }
@@ -1199,18 +1565,94 @@ public:
 class ParallelForWorker: public nornir::Worker<ParallelForRange, ParallelForRange>{
 private:
     std::function<void(unsigned long long, unsigned long long)> _function;
+    ParallelForStealing* _stealing;
+    ParallelForBarrier* _team;
+    // When the input queue has been found empty, 0 if not idle.
+    ticks _idleStart;
+
+    ParallelForRange* computeStealing(ParallelForRange* range){
+        ParallelForDeque* own = _stealing->deques[getId()];
+        long long int start = range->start, end = range->end, step = range->step;
+        long long int executed = 0, n;
+        size_t victim = getId();
+        while(true){
+            // Keep the lower half and expose the upper half to thieves.
+            while((n = parallelForIterations(start, end, step)) > _stealing->grain){
+                long long int middle = start + (n / 2) * step;
+                if(!own->push(middle, end)){
+                    break;
+                }
+                end = middle;
+            }
+            for(long long int i = start; i < end; i += step){
+                _function(i, getId());
+            }
+            executed += n;
+            _stealing->pending.fetch_sub(n);
+
+            if(own->pop(start, end)){
+                continue;
+            }
+
+            bool stolen = false;
+            size_t numActive = _stealing->numActive.load();
+            while(!stolen && _stealing->pending.load() > 0){
+                for(size_t i = 0; i < numActive && !stolen; i++){
+                    victim = (victim + 1) % numActive;
+                    if(victim != getId()){
+                        stolen = _stealing->deques[victim]->steal(start, end);
+                    }
+                }
+                if(!stolen){
+                    std::this_thread::yield();
+                }
+            }
+            if(!stolen){
+                break;
+            }
+        }
+        // We need to call setAdditionalTasks so that throughput is computed
+        // as iterations/second rather than blocks/second.
+        if(executed){
+            setAdditionalTasks(executed - 1);
+            if(_team){
+                _team->arrive(executed);
+            }
+        }
+        return nothing();
+    }
 public:
-    explicit ParallelForWorker(){;}
+    explicit ParallelForWorker(ParallelForStealing* stealing = NULL,
+                               ParallelForBarrier* team = NULL):
+        _stealing(stealing), _team(team), _idleStart(0){;}
+
+    bool waitTask(){
+        if(!_team){
+            return false;
+        }
+        ticks now = getticks();
+        if(!_idleStart){
+            _idleStart = now;
+        }else if(now - _idleStart > _team->getSpinTicks()){
+            _team->park(get_in_buffer());
+            _idleStart = 0;
+            return true;
+        }
+        return false;
+    }
 
     void setFunction(const std::function<void(unsigned long long, unsigned long long)>& function){
         _function = function;
     }
 
     ParallelForRange* compute(ParallelForRange* range) {
+        _idleStart = 0;
         if(range == &terminationRange){
             // We only forward the termination range so the gatherer can sleep
             // while the workers are working.
             return range;
+        }else if(_stealing){
+            return computeStealing(range);
         }else{
             // We need to call setTaskMultiplier so that throughput is computed
             // as iterations/second rather than chunks/second
@@ -1218,6 +1660,9 @@ public:
             for(long long int i = range->start; i < range->end; i += range->step){
                 _function(i, getId());
             }
+            if(_team){
+                _team->arrive(parallelForIterations(range->start, range->end, range->step));
+            }
             return nothing();
         }
     }
@@ -1245,8 +1690,20 @@ private:
     long long int _lastStart;
     long long int _lastEnd;
     long long int _lastStep;
+    ParallelForStealing* _stealing;
+    ParallelForBarrier* _team;
+    // When work stealing is used and no chunk size is specified, each block
+    // can be split in (at most) this number of stolen ranges.
+    static const long int _stealingSplits = 16;
+    // Number of blocks (for each thread) in which the iteration space
+    // is divided by parallel_scan.
+    static const long int _scanBlocksPerThread = 4;
 
     void pause(){
+        if(_team){
+            _team->wait();
+            return;
+        }
         long long int receivedTerminations = 0;
         _acc->offload(&terminationRange);
         ParallelForRange* r;
@@ -1257,11 +1714,13 @@ private:
             }
             ++receivedTerminations;
         }while(receivedTerminations < r->start); // r->start is the number of expected ranges
-        // TODO Find a way to freeze the threads of the farm without destroying
-        // everything (it should be enough to call the freeze and run methods of knobworkersfastflow)
     }
 
-    void resume(){;}
+    void resume(long long int iterations){
+        if(_team){
+            _team->open(iterations);
+        }
+    }
 
 public:
     // TODO: Dire quand'è che possiamo prendere un sample: piu sample per ogni tipo di loop, un sample per ogni tipo di loop, un sample per il blocco di loop
@@ -1272,14 +1731,29 @@ public:
         _lastStart = 0;
         _lastEnd = 0;
         _lastStep = 0;
+        _stealing = NULL;
+        _team = NULL;
+        if(_p->pforPersistentTeam){
+            _team = new ParallelForBarrier(_p->pforTeamSpinTime * 1000 * _p->archData.ticksPerNs);
+        }
         if(_p->knobPforChunkEnabled){
           _acc->setInputQueueSize(2*numThreads);
         }
+        if(_p->pforWorkStealing){
+            _stealing = new ParallelForStealing();
+            for(unsigned long int i = 0; i < numThreads; i++){
+                _stealing->deques.push_back(new ParallelForDeque());
+            }
+            _stealing->blocks.resize(numThreads);
+            _stealing->numActive.store(0);
+            _stealing->pending.store(0);
+            _stealing->grain = 1;
+        }
         for(unsigned long int i = 0; i < numThreads; i++){
-            _workers.push_back(new ParallelForWorker());
+            _workers.push_back(new ParallelForWorker(_stealing, _team));
             _acc->addWorker(_workers.back());
         }
-        _acc->addScheduler(new ParallelForScheduler());
+        _acc->addScheduler(new ParallelForScheduler(_stealing));
         _acc->addGatherer(new ParallelForGatherer());
         _acc->setOndemandScheduling();
         _numThreads = numThreads;
@@ -1293,12 +1767,25 @@ public:
     }
 
     ~ParallelFor(){
+        if(_team){
+            // Otherwise parked workers would never see the end of stream.
+            _team->close();
+        }
         _acc->shutdown();
         _acc->wait();
         delete _acc;
         for(auto w : _workers){
             delete w;
         }
+        if(_stealing){
+            for(auto d : _stealing->deques){
+                delete d;
+            }
+            delete _stealing;
+        }
+        if(_team){
+            delete _team;
+        }
     }
 
     inline void parallel_for(long long int start, long long int end, long long int step,
@@ -1313,8 +1800,15 @@ public:
             w->setFunction(function);
         }
 
+        long long int iterations = parallelForIterations(start, end, step);
         if(!chunkSize){
-            chunkSize = std::ceil(std::ceil((end - start)/(double) step) / (double) _numThreads);
+            if(_stealing){
+                // Blocks are statically assigned, so the chunk only bounds
+                // how finely a block can be split when stolen.
+                chunkSize = std::ceil(iterations / (double) (_numThreads * _stealingSplits));
+            }else{
+                chunkSize = std::ceil(iterations / (double) _numThreads);
+            }
         }
 
         if(_p->knobPforChunkEnabled){
@@ -1327,7 +1821,22 @@ public:
           chunkSize = _autoChunk;
         }
 
-        resume();
+        if(_stealing){
+            // The whole iteration space is sent to the scheduler, which
+            // splits it among the workers. The chunk size is used as
+            // the minimum size of a stolen range.
+            ParallelForRange whole;
+            whole.start = start;
+            whole.end = end;
+            whole.step = step;
+            _stealing->grain = chunkSize;
+            resume(iterations);
+            _acc->offload(&whole);
+            pause();
+            return;
+        }
+
+        resume(iterations);
 
         ParallelForRange pfr;
         bool setStart = true;
@@ -1362,12 +1871,95 @@ public:
         }
         pause();
     }
+
+    /**
+     * Executes a reduction over the iteration space. Each worker accumulates
+     * on its own accumulator and at the end of the loop the accumulators
+     * are combined. Since there is one accumulator for each thread (also for
+     * those not currently active), the number of active workers can change
+     * between loops.
+     * @param identity The identity value for combine.
+     * @param function Called as function(idx, accumulator) for each iteration.
+     * @param combine Called as combine(a, b) to combine two accumulators.
+     *        Must be associative and commutative.
+     * @return The result of the reduction.
+     */
+    template <typename T, typename Function, typename Combine>
+    inline T parallel_reduce(long long int start, long long int end, long long int step,
+                             long int chunkSize, const T& identity,
+                             const Function& function, const Combine& combine){
+        ParallelForAccumulator<T> init = {identity, {0}};
+        std::vector<ParallelForAccumulator<T>> accumulators(_numThreads, init);
+        parallel_for(start, end, step, chunkSize,
+        [&](unsigned long long idx, unsigned long long id){
+            function(idx, accumulators[id].value);
+        });
+        return parallelForTreeCombine(accumulators, combine);
+    }
+
+    /**
+     * Executes an inclusive scan over the iteration space. The iteration
+     * space is divided in blocks, which are first reduced in parallel. Then,
+     * each block is scanned in parallel, starting from the combination
+     * of the previous blocks.
+     * @param identity The identity value for combine.
+     * @param element Called as element(idx), returns the value of an
+     *        iteration. Is called twice for each iteration.
+     * @param combine Called as combine(a, b) to combine two values.
+     *        Must be associative.
+     * @param output Called as output(idx, prefix), where prefix is the
+     *        combination of the values of all the iterations up to idx
+     *        (included).
+     */
+    template <typename T, typename Element, typename Combine, typename Output>
+    inline void parallel_scan(long long int start, long long int end, long long int step,
+                              const T& identity, const Element& element,
+                              const Combine& combine, const Output& output){
+        long long int iterations = parallelForIterations(start, end, step);
+        long long int numBlocks = std::min(iterations, (long long int) (_numThreads * _scanBlocksPerThread));
+        if(numBlocks <= 0){
+            return;
+        }
+        ParallelForAccumulator<T> init = {identity, {0}};
+        std::vector<ParallelForAccumulator<T>> sums(numBlocks, init);
+        auto blockStart = [&](long long int block){
+            return start + ((iterations * block) / numBlocks) * step;
+        };
+
+        parallel_for(0, numBlocks, 1, 1,
+        [&](unsigned long long block, unsigned long long){
+            T accumulator = identity;
+            for(long long int i = blockStart(block); i < blockStart(block + 1); i += step){
+                accumulator = combine(accumulator, element(i));
+            }
+            sums[block].value = accumulator;
+        });
+
+        // Exclusive scan of the sums of the blocks.
+        T prefix = identity;
+        for(long long int b = 0; b < numBlocks; b++){
+            T sum = sums[b].value;
+            sums[b].value = prefix;
+            prefix = combine(prefix, sum);
+        }
+
+        parallel_for(0, numBlocks, 1, 1,
+        [&](unsigned long long block, unsigned long long){
+            T accumulator = sums[block].value;
+            for(long long int i = blockStart(block); i < blockStart(block + 1); i += step){
+                accumulator = combine(accumulator, element(i));
+                output(i, accumulator);
+            }
+        });
+    }
 };
 
 
 /**
  * @param chunkSize If 0, iteration space is statically divided among threads,
- * i.e. each thread gets numIterations/numThreads iterations
+ * i.e. each thread gets numIterations/numThreads iterations. If work
+ * stealing is enabled (Parameters::pforWorkStealing), it is the minimum
+ * number of iterations of a stolen range.
  **/
 template <typename Function>
 inline void parallel_for(long long int start, long long int end, long long int step,
@@ -1388,6 +1980,55 @@ inline void parallel_for(long long int start, long long int end, long long int s
     pf.parallel_for(start, end, step, chunkSize, function);
 }
 
+
+/**
+ * @param chunkSize The same as in parallel_for.
+ * @return The result of the reduction (see ParallelFor::parallel_reduce).
+ **/
+template <typename T, typename Function, typename Combine>
+inline T parallel_reduce(long long int start, long long int end, long long int step,
+                         long int chunkSize, unsigned long int numThreads,
+                         nornir::Parameters* parameters, const T& identity,
+                         const Function& function, const Combine& combine){
+    ParallelFor pf(numThreads, parameters);
+    return pf.parallel_reduce(start, end, step, chunkSize, identity, function, combine);
+}
+
+
+template <typename T, typename Function, typename Combine>
+inline T parallel_reduce(long long int start, long long int end, long long int step,
+                         long int chunkSize, unsigned long int numThreads,
+                         std::string parametersFile, const T& identity,
+                         const Function& function, const Combine& combine){
+    Parameters p(parametersFile);
+    ParallelFor pf(numThreads, &p);
+    return pf.parallel_reduce(start, end, step, chunkSize, identity, function, combine);
+}
+
+
+/**
+ * Inclusive scan (see ParallelFor::parallel_scan).
+ **/
+template <typename T, typename Element, typename Combine, typename Output>
+inline void parallel_scan(long long int start, long long int end, long long int step,
+                          unsigned long int numThreads, nornir::Parameters* parameters,
+                          const T& identity, const Element& element,
+                          const Combine& combine, const Output& output){
+    ParallelFor pf(numThreads, parameters);
+    pf.parallel_scan(start, end, step, identity, element, combine, output);
+}
+
+
+template <typename T, typename Element, typename Combine, typename Output>
+inline void parallel_scan(long long int start, long long int end, long long int step,
+                          unsigned long int numThreads, std::string parametersFile,
+                          const T& identity, const Element& element,
+                          const Combine& combine, const Output& output){
+    Parameters p(parametersFile);
+    ParallelFor pf(numThreads, &p);
+    pf.parallel_scan(start, end, step, identity, element, combine, output);
+}
+
 }
 
 #endif /* NORNIR_INTERFACE_HPP_ */
@@ -37,6 +37,10 @@ namespace ff{
 
 namespace nornir{
 
+namespace dataflow{
+    class Interpreter;
+}
+
 class Knob: public NonCopyable{
 public:
     Knob():_realValue(-1), _locked(false){;}
@@ -148,6 +152,13 @@ public:
      * @param v The new maximum allowed value.
      */
     void changeMax(double v);
+
+    /**
+     * Returns the time (in milliseconds) during which the application
+     * did not process tasks because of the last change of this knob.
+     * @return The stall time of the last change, 0 if it did not stall.
+     */
+    virtual double getLastStallTime() const{return 0;}
 };
 
 class KnobVirtualCoresFarm: public KnobVirtualCores{
@@ -163,7 +174,26 @@ public:
     void changeValue(double v);
     std::vector<double> getAllowedValues() const;
     std::vector<AdaptiveNode*> getActiveWorkers() const;
+    double getLastStallTime() const;
+
+    /**
+     * Checks how the number of workers is changed.
+     * @return True if it is changed without freezing the farm
+     *         (Parameters::drainFreeThrottling, only possible if the farm
+     *         has an emitter). In this case only the removed workers store
+     *         a sample when stopping. False if the farm is frozen and all
+     *         the active workers store a sample.
+     */
+    bool isThrottling() const;
 private:
+    /**
+     * Changes the number of workers without freezing the farm
+     * (Parameters::drainFreeThrottling). The removed workers process
+     * the tasks already in their queue and then sleep.
+     * @param numWorkers The new number of workers.
+     */
+    void throttle(uint numWorkers);
+
     /**
      * Prepares the nodes to freeze.
      */
@@ -198,6 +228,11 @@ private:
     const std::vector<AdaptiveNode*> _allWorkers;
     std::vector<AdaptiveNode*> _activeWorkers;
     const volatile bool* _terminated;
+    // Number of workers the emitter is sending tasks to. Only used
+    // when _throttling is true.
+    std::atomic<uint32_t> _throttlingWord;
+    bool _throttling;
+    double _lastStallTime;
 };
 
 class KnobVirtualCoresPipe: public KnobVirtualCores{
@@ -210,6 +245,7 @@ public:
 
     void changeValue(double v);
     std::vector<AdaptiveNode*> getActiveWorkers() const;
+    double getLastStallTime() const;
 private:
     std::vector<KnobVirtualCoresFarm*> _farms;
     std::vector<std::vector<double>> _allowedValues;
@@ -348,6 +384,26 @@ public:
     void changeValue(double v);
 };
 
+class KnobDataflowBatch: public Knob{
+  friend class dataflow::Interpreter;
+private:
+    long int* _batchPointer;
+    void setBatchPointer(long int* batchPointer);
+public:
+    explicit KnobDataflowBatch(Parameters p);
+    void changeValue(double v);
+};
+
+class KnobDataflowWindow: public Knob{
+  friend class dataflow::Interpreter;
+private:
+    long int* _windowPointer;
+    void setWindowPointer(long int* windowPointer);
+public:
+    explicit KnobDataflowWindow(Parameters p);
+    void changeValue(double v);
+};
+
 class KnobDummy: public Knob{
     friend class ParallelFor;
 public:
@@ -51,6 +51,61 @@ PredictionResults compute(uint appId, const std::string& dataFile,
                           bool perColumnNormalization,
                           bool computeError = false);
 
+#ifndef typedef_emParam_t
+#define typedef_emParam_t
+typedef struct {
+  arma::vec mu;
+  arma::mat C;
+  arma::mat T;
+  double sigma;
+} emParam_t;
+#endif // typedef_emParam_t
+
+/**
+ * Same as compute(), but the data profiles are loaded and normalised
+ * only once, and the parameters estimated by the EM algorithm are kept
+ * between successive computations, so that each computation starts
+ * from the previous estimate (and needs less iterations).
+ **/
+class Model{
+private:
+    uint _appId;
+    bool _perColumnNormalization;
+    // The data profiles, with the column of the application at position 0.
+    arma::mat _data;
+    // The normalised data profiles (column 0 is recomputed by compute()).
+    arma::mat _normData;
+    // The normalised data profiles of the application.
+    arma::vec _trueData;
+    emParam_t _em;
+    bool _warm;
+public:
+    /**
+     * @param appId Between [0, N - 1] (N = number of applications in the file).
+     * @param dataFile The name of the file containing the data profiles
+     *        for all the configurations and for all the applications (not
+     *        normalized).
+     **/
+    Model(uint appId, const std::string& dataFile, bool perColumnNormalization);
+
+    /**
+     * @param sampledData A vector with a length equal to the number of
+     *        possible configurations. The value in a specific position is 0 if the
+     *        corresponding configuration was not sampled. If it is != 0, it is the
+     *        data (power or bandwidth) in the corresponding sampled configuration.
+     * @param computeError If true computes the model error (comparing with the case
+     *        where all the values for all the configurations are known.
+     **/
+    PredictionResults compute(const arma::vec* sampledData,
+                              bool computeError = false);
+
+    /**
+     * Discards the parameters estimated so far. The next computation
+     * starts from scratch.
+     **/
+    void reset();
+};
+
 }
 
 #endif
@@ -42,18 +42,29 @@
 #include <mammut/mammut.hpp>
 #include <riff/riff.hpp>
 
+#include <atomic>
 #include <cmath>
 #include <iostream>
 #include <limits>
 #include <list>
 
 namespace nornir{
+
+// Used when samplingIntervalAdaptive is true.
+#define SAMPLING_INTERVAL_VARIATION_JUMP 2.0 // CV higher than 2x its average
+#define SAMPLING_INTERVAL_THROUGHPUT_JUMP 20.0 // Percentage
+#define SAMPLING_INTERVAL_SHRINK 0.5
+#define SAMPLING_INTERVAL_GROWTH 1.5
 class Configuration;
 class Selector;
 class KnobVirtualCoresFarm;
 class Parameters;
 class ManagerMulti;
 
+namespace dataflow{
+    class Interpreter;
+}
+
 /*!
  * \class Manager
  * \brief This class manages the adaptivity parallel applications.
@@ -63,6 +74,7 @@ class ManagerMulti;
 class Manager: public mammut::utils::Thread{
     friend class ManagerMulti;
     friend class ParallelFor;
+    friend class dataflow::Interpreter;
 public:
     explicit Manager(Parameters nornirParameters);
 
@@ -161,6 +173,14 @@ protected:
     mammut::cpufreq::RollbackPoint _cpufreqRollbackPoint;
     mammut::energy::RollbackPoint _energyRollbackPoint;
 
+    // Used when samplingIntervalAdaptive is true. The workers write on this
+    // eventfd to wake up the manager before the end of the sampling interval.
+    int _wakeupFd;
+
+    // Cleared by the worker which writes on _wakeupFd, so that only one
+    // wakeup is sent for each sampling interval.
+    std::atomic<bool> _wakeupArmed;
+
     /**
      * Wait for the application to start and
      * sets the ProcessHandler to KnobMappingExternal if necessary.
@@ -241,6 +261,30 @@ protected:
      **/
     void observe();
 
+    /**
+     * Waits for the end of the sampling interval. If samplingIntervalAdaptive
+     * is true, returns earlier if a worker signals that its input queue is
+     * almost full.
+     * @param ms The length of the wait (milliseconds).
+     * @return True if the manager has been woken up by a worker before the
+     * end of the interval, false otherwise.
+     */
+    bool waitSamplingInterval(double ms);
+
+    /**
+     * Computes the next sampling interval when samplingIntervalAdaptive is
+     * true. The interval is shortened if the last sample shows a jump in the
+     * throughput or in its coefficient of variation (or if the manager was
+     * woken up by a worker), and lengthened otherwise.
+     * @param current The current sampling interval (milliseconds).
+     * @param max The maximum sampling interval (milliseconds).
+     * @param overheadMs The time spent by the manager in the last iteration.
+     * @param wokenUp True if the manager was woken up by a worker.
+     * @return The next sampling interval (milliseconds).
+     */
+    double getAdaptiveSamplingInterval(double current, double max,
+                                       double overheadMs, bool wokenUp) const;
+
     /**
      * Decides the next configuration and moves to the specified configuration.
      */
@@ -0,0 +1,158 @@
+/*
+ * modelstore.hpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/*!
+ * \file modelstore.hpp
+ * \brief On-disk store of what the predictive selectors learnt about
+ *        an application, used to warm start its next executions.
+ **/
+
+#ifndef NORNIR_MODELSTORE_HPP_
+#define NORNIR_MODELSTORE_HPP_
+
+#include "knob.hpp"
+#include "parameters.hpp"
+#include "utils.hpp"
+
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace nornir{
+
+/**
+ * Returns the name of the executable of a process.
+ * @param pid The identifier of the process.
+ * @return The name of the executable of the process (without the path),
+ *         or an empty string if it can't be found.
+ */
+std::string getExecutableName(pid_t pid);
+
+/**
+ * A configuration observed during the execution of the application.
+ */
+typedef struct{
+    // The real knobs values of the configuration.
+    KnobsValues values;
+
+    // The sample observed on the configuration.
+    MonitoredSample sample;
+}StoredObservation;
+
+/**
+ * Stores, for an application running on a specific machine, the
+ * configurations observed by the predictive selectors and the
+ * configuration they chose for each set of requirements.
+ * Rather than the coefficients of the models, the store keeps the
+ * observations the models were fitted on, so that the models
+ * can be rebuilt (see Predictor::refine) for any prediction strategy.
+ * The store is a file in Parameters::modelStorePath, named after
+ * Parameters::modelStoreName and the architecture data, e.g.:
+ *
+ *   archData 1.8 42.3 1200
+ *   observation [4, 1, 2400000, ...] [Watts: 60.2 Knarr Sample: [...] ]
+ *   configuration 100 0 0 0 0 0 0 0 0 [8, 1, 1800000, ...]
+ *
+ * where the requirements of each configuration are listed in the order
+ * of the Requirements fields.
+ */
+class ModelStore{
+private:
+    std::string _fileName;
+    ArchData _archData;
+    Requirements _requirements;
+    // Sorted by the time the configurations were observed first.
+    std::vector<StoredObservation> _observations;
+    std::vector<std::pair<Requirements, KnobsValues>> _configurations;
+public:
+    /**
+     * Creates the store. Data is not loaded until load() is called.
+     * @param p The parameters. The store refers to the requirements
+     *        specified in p when the store is created.
+     */
+    explicit ModelStore(const Parameters& p);
+
+    /**
+     * Returns the name of the file of the store.
+     * @return The name of the file of the store.
+     */
+    const std::string& getFileName() const;
+
+    /**
+     * Loads the store from its file.
+     * @return False if the file does not exist or if it has been
+     *         created on an architecture with different data,
+     *         true otherwise.
+     */
+    bool load();
+
+    /**
+     * Saves the store to its file.
+     */
+    void save() const;
+
+    /**
+     * Adds an observation. If the configuration was already observed,
+     * the sample replaces the previous one.
+     * @param values The real knobs values of the configuration.
+     * @param sample The sample observed on the configuration.
+     */
+    void addObservation(const KnobsValues& values,
+                        const MonitoredSample& sample);
+
+    /**
+     * Returns the observations, sorted by the time the configurations
+     * were observed first.
+     * @return The observations.
+     */
+    const std::vector<StoredObservation>& getObservations() const;
+
+    /**
+     * Removes all the observations (e.g. when the application changes
+     * its phase and the models are dropped).
+     */
+    void clearObservations();
+
+    /**
+     * Returns the configuration chosen for the requirements of the store.
+     * @param values The real knobs values of the configuration.
+     * @return False if no configuration is stored for the requirements,
+     *         true otherwise.
+     */
+    bool getConfiguration(KnobsValues& values) const;
+
+    /**
+     * Sets the configuration chosen for the requirements of the store.
+     * @param values The real knobs values of the configuration.
+     */
+    void setConfiguration(const KnobsValues& values);
+};
+
+}
+
+#endif /* NORNIR_MODELSTORE_HPP_ */
@@ -32,6 +32,8 @@
 #include "./parameters.hpp"
 #include "utils.hpp"
 
+#include <atomic>
+
 namespace mammut{
     namespace task{
         class TasksManager;
@@ -84,6 +86,9 @@ typedef enum{
     // Switch to blocking/nonblocking
     MGMT_REQ_SWITCH_BLOCKING,
 
+    // Changes the number of workers without freezing the farm.
+    MGMT_REQ_THROTTLE,
+
     // ATTENTION: This must always be the last
     MGMT_REQ_NUM
 }ManagementRequestType;
@@ -146,6 +151,80 @@ private:
     // on _sampleResponse.
     ff::SWSR_Ptr_Buffer _responseQ;
 
+    /**
+     * Used when Parameters::seqlockSampling is true.
+     * The padding keeps the data written by the manager, by the node and
+     * the published counters on different cache lines.
+     */
+    char _padManagement[NORNIR_CACHE_LINE_SIZE];
+    // Incremented by the manager each time a request is pushed
+    // on _managementQ.
+    std::atomic<unsigned long> _managementSeq;
+    unsigned long _managementSeqSeen;
+    bool _seqlockSampling;
+    char _padSample[NORNIR_CACHE_LINE_SIZE];
+    // Seqlock protecting the published counters. The counters are
+    // cumulative, i.e. they are never reset.
+    std::atomic<unsigned long> _sampleSeq;
+    std::atomic<ticks> _publishedResetTicks;
+    std::atomic<ticks> _publishedResetWork;
+    std::atomic<ticks> _publishedWork;
+    std::atomic<unsigned long long> _publishedResetTasks;
+    std::atomic<unsigned long long> _publishedTasks;
+    // When the counters have been published and the last _managementSeq
+    // seen by the node at that time.
+    std::atomic<ticks> _publishedTicks;
+    std::atomic<unsigned long> _publishedEpoch;
+    char _padSampleEnd[NORNIR_CACHE_LINE_SIZE];
+    // Only accessed by the node. Value of the cumulative counters when
+    // the node has been reset for the last time.
+    ticks _resetWork;
+    unsigned long long _resetTasks;
+    // Only accessed by the manager. Value of the counters the last time
+    // they have been read.
+    ticks _baseTicks;
+    ticks _baseWork;
+    unsigned long long _baseTasks;
+    // Only accessed by the manager. Counters published before these
+    // values of _managementSeq are too old for the next sample (or for
+    // the reset of the sample, if _resetPending is true).
+    unsigned long _requestedEpoch;
+    unsigned long _resetEpoch;
+    bool _resetPending;
+
+    /**
+     * Used when Requirements::latencyPercentile is specified. Only
+     * workers record the latencies of the tasks.
+     */
+    bool _recordLatencies;
+    // Only accessed by the node. Value of tickstot when the last
+    // latency has been recorded.
+    ticks _lastTickstot;
+    LatencyHistogram _latencyHistogram;
+    // Only accessed by the manager. Value of the histogram counters
+    // the last time they have been read.
+    std::vector<unsigned long long> _latencyBase;
+
+    /**
+     * Used when Parameters::samplingIntervalAdaptive is true. Only workers
+     * write on _wakeupFd, when their input queue reaches the high-water mark
+     * and _wakeupArmed is set.
+     */
+    int _wakeupFd;
+    std::atomic<bool>* _wakeupArmed;
+
+    /**
+     * Used when Parameters::drainFreeThrottling is true. Futex word shared
+     * by the nodes of the farm, storing the number of workers the emitter
+     * is sending tasks to. A worker whose identifier is greater or equal
+     * than this value sleeps on it as soon as its input queue is empty.
+     */
+    std::atomic<uint32_t>* _throttlingWord;
+    uint32_t _throttlingId;
+    // Only written by the emitter. Time spent by the emitter to apply
+    // the last throttling request.
+    ticks _throttlingTicks;
+
     /**
      * Operations that need to take place before the node is already running.
      * @param p The adaptivity parameters.
@@ -218,6 +297,39 @@ private:
      */
     void thawAll(size_t numWorkers);
 
+    /**
+     * Sets the shared state used by drain-free throttling.
+     * It must be called before running the node.
+     * @param word The futex word shared by the nodes of the farm.
+     * @param id The identifier of the worker (ignored for the emitter).
+     */
+    void setThrottling(std::atomic<uint32_t>* word, uint32_t id = 0);
+
+    /**
+     * Tells the emitter to send the tasks only to the first numWorkers
+     * workers, without freezing the farm. The change is applied when
+     * the emitter stores numWorkers in the futex word.
+     * ATTENTION: Can only be called on emitter.
+     * @param numWorkers The new number of workers.
+     */
+    void throttleAll(size_t numWorkers);
+
+    /**
+     * Changes the number of workers the emitter is sending tasks to and
+     * wakes up the workers waiting for new tasks.
+     * ATTENTION: Can only be called by the emitter thread.
+     * @param numWorkers The new number of workers.
+     * @param notify If true, notifyRethreading is called on the emitter.
+     */
+    void applyThrottling(size_t numWorkers, bool notify);
+
+    /**
+     * Called by a worker excluded by the emitter when its input queue
+     * is empty. Waits until the worker is used again.
+     * @param active The number of workers the emitter is sending tasks to.
+     */
+    void parkThrottled(uint32_t active);
+
     /**
      * Called on the node before starting it.
      * It must be called when the node is running.
@@ -235,6 +347,47 @@ private:
      */
     void reset();
 
+    /**
+     * Notifies the node that a management request has been pushed.
+     * @return The new value of the management sequence.
+     */
+    unsigned long notifyManagementRequest();
+
+    /**
+     * Publishes the counters of the node through the seqlock. Apart from
+     * resets and freezes, it is only done when the manager bumps the
+     * management sequence.
+     */
+    void publishSample();
+
+    /**
+     * Reads the counters published by the node and computes the sample
+     * since the last time they have been read.
+     * @param sample The computed sample.
+     * @param avgLatency The average latency.
+     */
+    void readSample(MonitoredSample& sample, double avgLatency);
+
+    /**
+     * Reads the latencies recorded since the last call and merges them
+     * into a set of counters.
+     * @param counts The counters where the latencies are added. It must have
+     *        LATENCY_HISTOGRAM_BUCKETS elements.
+     */
+    void mergeLatencies(std::vector<unsigned long long>& counts);
+
+    /**
+     * Wakes up the manager if the input queue of the node is filled
+     * for more than Parameters::queueHighWaterMark percent.
+     */
+    void checkHighWaterMark();
+
+    /**
+     * Waits for a while, according to the polling strategy.
+     * @param avgLatency The average latency.
+     */
+    void poll(double avgLatency);
+
     /**
      * Stores a sample.
      */
@@ -254,6 +407,12 @@ private:
      */
     void callbackOut(void *p) NORNIR_CX11_KEYWORD(final);
 
+    /**
+     * Called by FastFlow when the input queue of the node is empty.
+     * Workers excluded by drain-free throttling sleep here.
+     */
+    void losetime_in(unsigned long ticksToWait) NORNIR_CX11_KEYWORD(final);
+
     void svc_end() NORNIR_CX11_KEYWORD(final);
     void eosnotify(ssize_t id) NORNIR_CX11_KEYWORD(final);
 
@@ -288,6 +447,15 @@ public:
     virtual void notifyRethreading(size_t oldNumWorkers,
                                    size_t newNumWorkers);
 
+    /**
+     * This method can be implemented by the workers to wait in a
+     * different way when their input queue is empty (e.g. to sleep
+     * instead of polling the queue).
+     * @return True if the worker already waited, false if the default
+     *         FastFlow waiting must be used.
+     */
+    virtual bool waitTask();
+
     /**
      * Gets the last management request received by the node.
      * NOTE: Only to be used for debug purposes.
@@ -311,6 +479,15 @@ protected:
      */
     void enableRethreading();
 
+    /**
+     * Processes the pending management requests (e.g. rethreading).
+     * They are otherwise only processed when a task is sent to any
+     * worker, so an emitter which only sends tasks to specific workers
+     * must call it periodically.
+     * Can only be called on the emitter.
+     */
+    void checkManagementRequests();
+
     /**
      * ATTENTION: Only for internal use.
      */
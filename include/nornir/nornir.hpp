@@ -35,5 +35,6 @@
 #include <nornir/instrumenter.hpp>
 #include <nornir/manager.hpp>
 #include <nornir/stats.hpp>
+#include <nornir/trace.hpp>
 
 #endif // NORNIR_HPP_
@@ -96,6 +96,8 @@ typedef enum{
     KNOB_FREQUENCY, // Clock frequency of the cores.
     KNOB_CLKMOD, // Clock modulation.
     KNOB_PFOR_CHUNK, // Parallel for chunk size
+    KNOB_DATAFLOW_BATCH, // Instructions in a dataflow scheduler message
+    KNOB_DATAFLOW_WINDOW, // Stream elements in flight in the dataflow interpreter
     KNOB_NUM  // <---- This must always be the last value
 }KnobType;
 
@@ -249,6 +251,27 @@ typedef enum{
     STRATEGY_POLLING_SLEEP_LATENCY
 }StrategyPolling;
 
+/// Placement of the dataflow instructions on the interpreters.
+typedef enum{
+    // With orderedProcessing, instruction i is always executed by
+    // interpreter i % #interpreters. Otherwise, the instructions are
+    // distributed by the farm.
+    DATAFLOW_PLACEMENT_STATIC = 0,
+
+    // On the interpreter with the lowest number of instructions
+    // waiting to be executed.
+    DATAFLOW_PLACEMENT_LEAST_LOADED,
+
+    // On the interpreter which produced the input token of the
+    // instruction.
+    DATAFLOW_PLACEMENT_AFFINITY,
+
+    // On the least loaded interpreter among those running on the
+    // same CPU (NUMA node) of the interpreter which produced the
+    // input token of the instruction.
+    DATAFLOW_PLACEMENT_NUMA
+}DataflowPlacement;
+
 // How to decide if we have to consider new configurations
 typedef enum{
     // Number of samples.
@@ -547,10 +570,19 @@ typedef struct Requirements{
 
     // The maximum latency required for each input element processed by the
     // application (in milliseconds).
-    // It must be greater or equal than 0.
-    // NOT AVAILABLE AT THE MOMENT.
+    // It must be greater or equal than 0. The bound applies to the
+    // percentile of the latencies of the tasks specified by
+    // 'latencyPercentile'. Bounds on the average latency and latency
+    // minimization are NOT AVAILABLE AT THE MOMENT.
+    // [default = unused].
     double latency;
 
+    // The percentile of the tasks latencies bounded by 'latency' (e.g. 99
+    // for a p99 latency bound). It must be in (0, 100]. When used,
+    // 'latency' must be specified.
+    // [default = unused].
+    double latencyPercentile;
+
     // The required energy (in joules) [default = unused].
     double energy;
 
@@ -615,10 +647,60 @@ typedef struct{
     bool orderedOutput;
 
     /**
-     * Maximum number of graphs to keep in the system [default = 1000].
+     * Maximum number of graphs to keep in the system. If
+     * knobDataflowWindowEnabled is true, the number of graphs in the
+     * system is autotuned up to this value [default = 1000].
      */
     uint maxGraphs;
 
+    /**
+     * If true, when a worker computes an instruction it sets the inputs
+     * of the successors and directly executes the ones which become
+     * fireable (or pushes them on its work stealing deque). The scheduler
+     * only manages the input and output streams. orderedProcessing only
+     * applies to the first instruction of each graph [default = false].
+     */
+    bool decentralisedFiring;
+
+    /**
+     * Placement of the instructions on the interpreters. With
+     * orderedProcessing, the interpreter of an instruction only changes
+     * when no instances of that instruction are being executed
+     * [default = DATAFLOW_PLACEMENT_STATIC].
+     */
+    DataflowPlacement placement;
+
+    /**
+     * Number of fireable instructions sent to an interpreter with a single
+     * queue operation (and of computed instructions sent back to the
+     * scheduler). Instructions are never delayed to fill a batch, they
+     * are sent as soon as the scheduler has no more work to do. Only
+     * used if knobDataflowBatchEnabled is false [default = 1].
+     */
+    uint batchSize;
+
+    /**
+     * Maximum number of instructions in a batch. Bounds the latency added
+     * by batching when the batch size is autotuned [default = 16].
+     */
+    uint maxBatchSize;
+
+    /**
+     * If greater than 0, when the scheduler finds no input and no
+     * computed instructions it sleeps instead of spinning, doubling the
+     * sleep time (starting from 1 microsecond) at each idle iteration up
+     * to this value (in microseconds). If 0, the scheduler always spins
+     * [default = 0].
+     */
+    uint maxIdleSleep;
+
+    /**
+     * If true, the interpreters measure the service time of each
+     * instruction, returned by Interpreter::getServiceTimes(). It adds two
+     * timestamps to each computed instruction [default = false].
+     */
+    bool profileServiceTimes;
+
     /**
      * Maximum number of interpreters to be used [default = #Physical cores
      * in the system - 2].
@@ -657,6 +739,13 @@ private:
      */
     uint getLowOverheadSamplingInterval() const;
 
+    /**
+     * Computes the sampling interval such to have a low
+     * performance overhead, without rounding it to milliseconds.
+     * @return The sampling interval (in milliseconds).
+     */
+    double getLowOverheadSamplingIntervalMs() const;
+
     /**
      * Sets the default values for parameters that depends
      * from others.
@@ -776,6 +865,13 @@ public:
     // Polling strategy [default = STRATEGY_POLLING_SLEEP_SMALL].
     StrategyPolling strategyPolling;
 
+    // If true, nodes publish their counters through a seqlock and the
+    // manager reads them without exchanging messages with the nodes. On
+    // each task, nodes only check a sequence counter, which the manager
+    // bumps to ask for a sample or to push a management request. Counters
+    // are only published when it changes [default = false].
+    bool seqlockSampling;
+
     // Persistence strategy [default = STRATEGY_PERSISTENCE_SAMPLES].
     StrategyPersistence strategyPersistence;
 
@@ -805,6 +901,35 @@ public:
     // Flag to enable/disable parallel for chunk size knob autotuning [default = false].
     bool knobPforChunkEnabled;
 
+    // Flag to enable/disable autotuning of the number of instructions
+    // exchanged in a single message between the dataflow scheduler and
+    // the interpreters (between 1 and dataflow.maxBatchSize). Can't be
+    // enabled together with knobPforChunkEnabled [default = false].
+    bool knobDataflowBatchEnabled;
+
+    // Flag to enable/disable autotuning of the maximum number of stream
+    // elements in flight in the dataflow interpreter (between 1 and
+    // dataflow.maxGraphs), to trade latency against throughput. Can be
+    // enabled together with knobDataflowBatchEnabled, but not with
+    // knobPforChunkEnabled [default = false].
+    bool knobDataflowWindowEnabled;
+
+    // If true, parallel for iterations are statically split in one contiguous
+    // block per worker and idle workers steal halves of the ranges still
+    // to be executed by the other workers. When the chunk knob is enabled
+    // its value is used as the minimum size of a stolen range [default = false].
+    bool pforWorkStealing;
+
+    // If true, parallel for threads are kept running between loops and the
+    // end of a loop is detected through a barrier, without exchanging
+    // any message with the workers [default = false].
+    bool pforPersistentTeam;
+
+    // When pforPersistentTeam is true, the thread waiting for the end of a
+    // loop spins for this number of microseconds before sleeping
+    // [default = 100].
+    uint pforTeamSpinTime;
+
     // Number of active threads in the application. Useful for
     // external managers. If 0, number of active threads is unknown [default = 0].
     uint32_t activeThreads;
@@ -812,6 +937,14 @@ public:
     // If true, concurrency throttling is used on fastflow/nornir applications [default = true].
     bool useConcurrencyThrottling;
 
+    // If true, the number of workers of fastflow/nornir farms is changed
+    // without freezing the farm. The emitter stops sending tasks to the
+    // removed workers, which process the tasks already in their queue
+    // and then sleep until they are used again. Only the emitter is
+    // notified through notifyRethreading, from its own thread. Can't be
+    // used with triggerQBlocking [default = false].
+    bool drainFreeThrottling;
+
     // Parameters for LEO predictor.
     LeoParameters leo;
 
@@ -857,6 +990,29 @@ public:
     // [default = 4].
     uint32_t steadyThreshold;
 
+    // If true, the sampling interval is adapted at runtime. It is shortened
+    // when the throughput (or its coefficient of variation) changes abruptly
+    // and lengthened when the application is stable, up to
+    // samplingIntervalCalibration (during calibration) or
+    // samplingIntervalSteady. The manager is also woken up before the end of
+    // the interval when the input queue of a worker reaches the
+    // queueHighWaterMark. The interval never goes below the length needed to
+    // keep the monitoring overhead under maxMonitoringOverhead
+    // [default = false].
+    bool samplingIntervalAdaptive;
+
+    // The minimum length of the sampling interval (in milliseconds) when
+    // samplingIntervalAdaptive is true. It can be smaller than one
+    // millisecond. If 0, it will be automatically computed such to have a
+    // low performance overhead [default = 0].
+    double samplingIntervalMin;
+
+    // When samplingIntervalAdaptive is true, if the input queue of a worker
+    // is filled for more than queueHighWaterMark percent, the manager is
+    // woken up before the end of the sampling interval. In the range (0, 100]
+    // [default = 90.0].
+    double queueHighWaterMark;
+
     // The minimum number of tasks in a worker sample. If 0, no minimum.
     // [default = 0].
     uint minTasksPerSample;
@@ -892,9 +1048,18 @@ public:
     // The aging value for the linear regression predictor. If it has a value
     // of n, then we will only consider the last n configurations we collected
     // in order to perform predictions. If 0, no aging will be applied and all
-    // the previous samples will be considered [default = 0].
+    // the previous samples will be considered. If regressionIncremental is
+    // true, it is used as a forgetting factor of n/(n + 1), i.e. each new
+    // observation scales the weight of the previous ones by n/(n + 1)
+    // [default = 0].
     uint regressionAging;
 
+    // If true, the linear regression predictor is updated incrementally
+    // (recursive least squares) every time a new observation is collected,
+    // instead of being fitted again on all the observations
+    // [default = false].
+    bool regressionIncremental;
+
     // The maximum percentage of monitoring overhead, in the range (0, 100).
     // [default = 1.0].
     double maxMonitoringOverhead;
@@ -959,6 +1124,23 @@ public:
     // This is done to amortize fluctuations. [default = 0.0]
     double conservativeValue;
 
+    // If true, the predictive selectors assume that predicted throughput and
+    // power consumption do not decrease when the number of virtual cores
+    // increases. The best configuration is then searched with a binary
+    // search on the virtual cores for each combination of the other knobs,
+    // instead of predicting all the possible configurations. Only used with
+    // throughput and power requirements (bounds, maximization or
+    // minimization) [default = false].
+    bool prunedSearch;
+
+    // If true, the learning selector searches the best configuration
+    // (and computes the models needed for the search) on a separate
+    // thread, on the observations collected up to that moment. In the
+    // meanwhile the manager keeps monitoring the application in the current
+    // configuration, and switches to the new one as soon as it has been
+    // found. If false, the manager waits for the search [default = false].
+    bool asyncModelFitting;
+
     // A vector containing the number of cores not allowed to be used.
     // E.g. if it contains the number 3, then the runtime will
     // never use  3 cores. It can only be specified when
@@ -974,6 +1156,29 @@ public:
     // of the reconfigurations [default = false].
     bool statsReconfiguration;
 
+    // If greater than 0, the predictive selectors move to a new
+    // configuration only if its predicted gain is higher than the cost
+    // of the reconfiguration. The cost (the average duration of the
+    // reconfigurations performed so far, during which no tasks are
+    // processed) is amortised over this time (in milliseconds), i.e. over
+    // the time the application is expected to spend in the new
+    // configuration. When greater than 0, the statistics about the cost
+    // of the reconfigurations are always computed [default = 0].
+    double reconfigurationResidenceTime;
+
+    // Directory containing the model store. If not empty, the predictive
+    // selectors save what they learnt about the application (the observed
+    // configurations and the configuration chosen for the requirements)
+    // when the application terminates, and load it at the next execution
+    // of the same application on the same machine. In that case, the stored
+    // configuration is only validated with one sample instead of
+    // calibrating from scratch [default = ""].
+    std::string modelStorePath;
+
+    // Name of the application in the model store. If empty, the name of
+    // the executable of the application is used [default = ""].
+    std::string modelStoreName;
+
     // 'Range' of the starting Nelder-Mead simplex [default = 2].
     uint nelderMeadRange;
 
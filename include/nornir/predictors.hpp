@@ -192,6 +192,7 @@ protected:
     double _modelError;
 
     double getMaximumThroughput() const;
+    double getMaximumThroughput(const MonitoredSample& sample) const;
     double getCurrentPower() const;
 public:
     Predictor(PredictorType type,
@@ -220,7 +221,17 @@ public:
      * If possible, refines the model with the information
      * obtained on the current configuration.
      */
-    virtual void refine() = 0;
+    void refine();
+
+    /**
+     * If possible, refines the model with the information obtained
+     * on a given configuration (e.g. by a previous execution of the
+     * application, see ModelStore).
+     * @param realValues The real knobs values of the configuration.
+     * @param sample The sample observed on the configuration.
+     */
+    virtual void refine(const KnobsValues& realValues,
+                        const MonitoredSample& sample) = 0;
 
     /**
      * Prepare the predictor to accept a set of prediction requests.
@@ -236,6 +247,22 @@ public:
      */
     virtual double predict(const KnobsValues& realValues) = 0;
 
+    /**
+     * Predicts the values at a set of knobs values. By default it calls
+     * predict() on each element.
+     * ATTENTION: Predictors may cache data computed on the set of knobs
+     *            values, identified by its version. The caller must change
+     *            the version every time the set is modified. Nothing is
+     *            cached for version 0.
+     * @param realValues The set of real knobs values.
+     * @param version The version of realValues.
+     * @param predictions The predictions, one for each element of
+     *        realValues.
+     */
+    virtual void predictBatch(const std::vector<KnobsValues>& realValues,
+                              size_t version,
+                              std::vector<double>& predictions);
+
     /**
      * Returns the model error, i.e. the error between the observations and the
      * predictions.
@@ -245,6 +272,8 @@ public:
 };
 
 #ifdef ENABLE_MLPACK
+#define RLS_INITIAL_COVARIANCE 1e6 // Large values give less weight to the initial (null) model
+
 typedef struct{
     RegressionData* data;
     double response;
@@ -276,7 +305,48 @@ private:
 
     uint _otherApplicationsCores;
 
-    double getCurrentResponse() const;
+    // Coefficients of the model. The first one is the intercept, then there
+    // is one coefficient for each predictor.
+    arma::vec _coefficients;
+
+    // Preallocated input for predictions (one predictor per row).
+    arma::mat _predictionInputMl;
+
+    // Input for batch predictions (one configuration per row, the first
+    // column is the intercept).
+    size_t _batchVersion;
+    arma::mat _batchInput;
+    arma::vec _batchOutput;
+
+    /**
+     * Used when Parameters::regressionIncremental is true.
+     * The model is updated with recursive least squares on normalized
+     * predictors.
+     */
+    // Inverse of the (weighted) correlation matrix of the normalized
+    // predictors.
+    arma::mat _rlsP;
+    // Coefficients of the model on the normalized predictors.
+    arma::vec _rlsTheta;
+    // Normalized observation (intercept included).
+    arma::vec _rlsX;
+    // P * x
+    arma::vec _rlsPx;
+    // Normalization factors of the predictors.
+    arma::vec _rlsScale;
+    double _rlsForgetting;
+    double _rlsError;
+    double _rlsErrorWeight;
+
+    double getResponse(const MonitoredSample& sample) const;
+
+    /**
+     * Updates the model with a new observation in O(p^2), where p is the
+     * number of predictors.
+     * @param observation The observation.
+     * @param response The response.
+     */
+    void updateIncremental(const RegressionData& observation, double response);
 public:
     PredictorLinearRegression(PredictorType type,
                               const Parameters& p,
@@ -289,12 +359,16 @@ public:
 
     bool readyForPredictions();
 
-    void refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
     void prepareForPredictions();
 
     double predict(const KnobsValues& configuration);
 
+    void predictBatch(const std::vector<KnobsValues>& realValues,
+                      size_t version,
+                      std::vector<double>& predictions);
+
     double getInactivePowerParameter() const;
 };
 #endif
@@ -307,12 +381,18 @@ template <class P>
 class PredictorRegressionMapping: public Predictor{
 private:
     Predictor* _predictors[MAPPING_TYPE_NUM];
+    // Batch predictions, split by mapping.
+    size_t _batchVersion;
+    std::vector<KnobsValues> _batchValues[MAPPING_TYPE_NUM];
+    std::vector<size_t> _batchIds[MAPPING_TYPE_NUM];
+    std::vector<double> _batchPredictions;
 public:
     PredictorRegressionMapping(PredictorType type,
                               const Parameters& p,
                               const Configuration& configuration,
                               const Smoother<MonitoredSample>* samples):
-                                  Predictor(type, p, configuration, samples){
+                                  Predictor(type, p, configuration, samples),
+                                  _batchVersion(0){
         for(size_t i = 0; i < MAPPING_TYPE_NUM; i++){
             _predictors[i] = new P(type, p, configuration, samples);
         }
@@ -339,8 +419,8 @@ public:
         return true;
     }
 
-    void refine(){
-        _predictors[(MappingType) _configuration.getRealValue(KNOB_MAPPING)]->refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample){
+        _predictors[(MappingType) realValues[KNOB_MAPPING]]->refine(realValues, sample);
     }
 
     void prepareForPredictions(){
@@ -353,6 +433,35 @@ public:
         const KnobsValues real = _configuration.getRealValues(values);
         return _predictors[(MappingType) real[KNOB_MAPPING]]->predict(values);
     }
+
+    void predictBatch(const std::vector<KnobsValues>& realValues,
+                      size_t version,
+                      std::vector<double>& predictions){
+        if(!version || version != _batchVersion){
+            for(size_t i = 0; i < MAPPING_TYPE_NUM; i++){
+                _batchValues[i].clear();
+                _batchIds[i].clear();
+            }
+            for(size_t i = 0; i < realValues.size(); i++){
+                MappingType mt = (MappingType) realValues[i][KNOB_MAPPING];
+                _batchValues[mt].push_back(realValues[i]);
+                _batchIds[mt].push_back(i);
+            }
+            _batchVersion = version;
+        }
+        predictions.resize(realValues.size());
+        for(size_t i = 0; i < MAPPING_TYPE_NUM; i++){
+            if(_batchValues[i].empty()){
+                continue;
+            }
+            // The split sets only change with realValues.
+            _predictors[i]->predictBatch(_batchValues[i], version,
+                                         _batchPredictions);
+            for(size_t j = 0; j < _batchIds[i].size(); j++){
+                predictions[_batchIds[i][j]] = _batchPredictions[j];
+            }
+        }
+    }
 };
 
 /**
@@ -410,7 +519,7 @@ public:
 
     bool readyForPredictions();
 
-    void refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
     void prepareForPredictions();
 
@@ -466,7 +575,7 @@ public:
 
     virtual double predict(const KnobsValues& values);
 
-    void refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
     void clear();
 };
@@ -497,11 +606,15 @@ public:
  */
 class PredictorLeo: public Predictor{
 private:
-    std::map<KnobsValues, size_t> _confIndexes;
+    // The i-th value/prediction refers to the i-th combination.
+    KnobsCombinations _combinations;
     arma::vec _values;
     arma::vec _predictions;
     bool _preparationNeeded;
     size_t _appId;
+    // Offline profiling data and state of the model, kept between
+    // successive preparations.
+    leo::Model* _model;
 public:
     PredictorLeo(PredictorType type,
               const Parameters& p,
@@ -514,7 +627,7 @@ public:
 
     void clear();
 
-    void refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
     void prepareForPredictions();
 
@@ -528,8 +641,11 @@ public:
  */
 class PredictorFullSearch: public Predictor{
 private:
-    const std::vector<KnobsValues>& _allConfigurations;
-    std::map<KnobsValues, double> _values;
+    KnobsCombinations _combinations;
+    // Observed value and whether it has been observed, for each combination.
+    std::vector<double> _values;
+    std::vector<bool> _observed;
+    size_t _numObserved;
 public:
     PredictorFullSearch(PredictorType type,
               const Parameters& p,
@@ -542,7 +658,7 @@ public:
 
     void clear();
 
-    void refine();
+    void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
     void prepareForPredictions();
 
@@ -609,9 +725,11 @@ public:
 
 	/**
 	 * If possible, refines the model with the information
-	 * obtained on the current configuration.
+	 * obtained on a given configuration.
+	 * @param realValues The real knobs values of the configuration.
+	 * @param sample The sample observed on the configuration.
 	 */
-	void refine();
+	void refine(const KnobsValues& realValues, const MonitoredSample& sample);
 
 	/**
 	 * Prepare the predictor to accept a set of prediction requests.
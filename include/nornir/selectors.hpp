@@ -32,9 +32,11 @@
 #include "explorers.hpp"
 #include "configuration.hpp"
 #include "knob.hpp"
+#include "modelstore.hpp"
 #include <mammut/mammut.hpp>
 #include <nornir/external/nelder-mead.h>
 
+#include <atomic>
 #include <memory>
 
 namespace nornir{
@@ -59,6 +61,9 @@ protected:
     Smoother<double>* _bandwidthIn;
     bool _forced;
     bool _forcedReturned;
+    // Number of times the best configuration found was not applied
+    // since the gain was lower than the cost of the reconfiguration.
+    uint _avoidedReconfigurations;
     KnobsValues _forcedConfiguration;
     bool _calibrationCoordination;
     bool _calibrationAllowed;
@@ -107,6 +112,15 @@ protected:
      */
     bool isFeasibleUtilization(double value, bool conservative) const;
 
+    /**
+     * Returns the latency of a sample to be checked against the latency
+     * requirement (i.e. the percentile specified in the requirements, or
+     * the average latency if no percentile has been specified).
+     * @param sample The sample.
+     * @return The latency of the sample (in milliseconds).
+     */
+    double getLatency(const MonitoredSample& sample) const;
+
     /**
      * Initializes the best value.
      * @return The best value seed.
@@ -157,7 +171,7 @@ public:
      * MUST be called before calling getNextKnobsValues().
      * @param totalTasks The total processed tasks.
      */
-    void updateTotalTasks(u_int64_t totalTasks);
+    virtual void updateTotalTasks(u_int64_t totalTasks);
 
     /**
      * Updates the input bandwidth history with the current value.
@@ -197,6 +211,14 @@ public:
      */
     double getTotalCalibrationTime() const;
 
+    /**
+     * Returns the number of reconfigurations not performed because
+     * their cost was higher than the predicted gain (see
+     * Parameters::reconfigurationResidenceTime).
+     * @return The number of reconfigurations avoided.
+     */
+    uint getAvoidedReconfigurations() const;
+
     /**
      * Resets the total calibration time.
      */
@@ -222,6 +244,19 @@ public:
      * Considers the contract violations.
      */
     void acceptViolations();
+
+    /**
+     * Saves what has been learnt about the application in the model
+     * store (see Parameters::modelStorePath). By default nothing is saved.
+     */
+    virtual void saveModel(){;}
+
+    /**
+     * Waits for the work the selector is doing in background (if any).
+     * MUST be called when the application terminates, before saving the
+     * model and collecting the statistics.
+     */
+    virtual void terminate(){;}
 };
 
 /**
@@ -299,6 +334,61 @@ private:
     std::map<KnobsValues, MonitoredSample> _observedValues;
     std::map<KnobsValues, double> _performancePredictions;
     std::map<KnobsValues, double> _powerPredictions;
+    // Valid REAL combinations of knobs values (among _batchCombinations)
+    // and the corresponding predictions of the maximum throughput and power.
+    // The version is incremented every time the configurations change.
+    KnobsCombinations _batchCombinations;
+    std::vector<KnobsValues> _batchConfigurations;
+    size_t _batchVersion;
+    std::vector<double> _batchThroughput;
+    std::vector<double> _batchPower;
+    // Not NULL if Parameters::modelStorePath has been specified.
+    std::unique_ptr<ModelStore> _modelStore;
+    // True if the models have been refined with stored observations.
+    bool _modelLoaded;
+
+    /**
+     * Checks if a stored configuration can still be used, i.e. if its
+     * knobs values are allowed in the current configuration.
+     * @param values The real knobs values of the configuration.
+     * @return True if the configuration can be used, false otherwise.
+     */
+    bool isStoredConfigurationValid(const KnobsValues& values);
+
+    /**
+     * Loads the model store and refines the models with the stored
+     * observations of the configurations that are still valid.
+     */
+    void loadModel();
+
+    /**
+     * Computes the predictions of maximum throughput and power for all
+     * the valid combinations of knobs values.
+     */
+    void predictAll();
+
+    /**
+     * Checks if the best configuration can be found with a pruned search
+     * (see Parameters::prunedSearch).
+     * @return True if the pruned search can be used, false otherwise.
+     */
+    bool isPrunedSearchApplicable() const;
+
+    /**
+     * Computes the best relative knobs values for the farm by using a
+     * binary search on the virtual cores.
+     * @return The best relative knobs values.
+     */
+    KnobsValues getBestKnobsValuesPruned();
+
+    /**
+     * Checks if moving from the current configuration to the best one
+     * is worth its cost (see Parameters::reconfigurationResidenceTime).
+     * @param best The best configuration found.
+     * @return The best configuration if the predicted gain is higher than
+     *         the cost of the reconfiguration, the current one otherwise.
+     */
+    KnobsValues applyReconfigurationCost(const KnobsValues& best);
 
     /**
      * Checks if the specified value to maximize/minimize
@@ -330,6 +420,9 @@ private:
 protected:
     double _throughputPrediction;
     double _powerPrediction;
+    // If not NULL, used instead of the current samples when searching
+    // the best configuration (the samples may be modified meanwhile).
+    const MonitoredSample* _samplesSnapshot;
 
     /**
      * Updates the most performing configuration considering the predictions
@@ -382,6 +475,17 @@ protected:
      */
     void clearPredictors();
 
+    /**
+     * Returns the configuration to be used to warm start the selector,
+     * i.e. the one stored for the current requirements or, if none,
+     * the best one according to the models loaded from the store.
+     * Predictions for the configuration are updated, so that it can be
+     * validated with isAccurate() on the next sample.
+     * @param kv The configuration.
+     * @return False if there is nothing to warm start from, true otherwise.
+     */
+    bool getWarmStartKnobsValues(KnobsValues& kv);
+
     bool isMaxPerformanceConfiguration() const;
 public:
     SelectorPredictive(const Parameters& p,
@@ -415,6 +519,17 @@ public:
      */
     double getThroughputPrediction(const KnobsValues& values);
 
+    /**
+     * Return the latency prediction for a given configuration.
+     * @param values The knobs values.
+     * @param maxThroughput The maximum throughput predicted for the
+     *        configuration.
+     * @return The latency prediction (in milliseconds) for a given
+     *         configuration.
+     */
+    double getLatencyPrediction(const KnobsValues& values,
+                                double maxThroughput);
+
     /**
      * Return the power consumption prediction for a given configuration.
      * @param values The knobs values.
@@ -437,6 +552,14 @@ public:
     Predictor* getPrimaryPredictor() const{return _throughputPredictor.get();}
 
     Predictor* getSecondaryPredictor() const{return _powerPredictor.get();}
+
+    /**
+     * Checks the accuracy of the predictions.
+     * @return True if the predictions were accurate, false otherwise.
+     */
+    bool isAccurate();
+
+    void saveModel();
 };
 
 /**
@@ -471,8 +594,23 @@ public:
 /**
  * A generic online learner selector.
  */
+class SelectorLearner;
+
+/**
+ * Thread searching the best configuration for a SelectorLearner.
+ */
+class SelectorLearnerFitter: public mammut::utils::Thread{
+private:
+    SelectorLearner& _selector;
+public:
+    explicit SelectorLearnerFitter(SelectorLearner& selector);
+    void run();
+};
+
 class SelectorLearner: public SelectorPredictive{
     friend class Manager;
+    friend class SelectorLearnerFitter;
+    friend class SelectorLearnerTest;
 private:
     Explorer* _explorer;
     bool _firstPointGenerated;
@@ -485,7 +623,49 @@ private:
     bool _updatingInterference;
     std::vector<KnobsValues> _interferenceUpdatePoints;
 
+    // Stuff used for asynchronous model fitting.
+    typedef enum{
+        FIT_CALIBRATION_END = 0,
+        FIT_BANDWIDTH_CHANGE
+    }FitReason;
+    SelectorLearnerFitter* _fitter;
+    FitReason _fitReason;
+    // Configurations found by the fitter. The fitter writes the one at
+    // position _fitBack and then publishes it by storing its index
+    // in _fitReady (-1 if no configuration has been published).
+    KnobsValues _fitResults[2];
+    uint _fitBack;
+    std::atomic<int> _fitReady;
+    // Total tasks received while fitting, applied when the fitter
+    // terminates (the fitter reads the remaining tasks).
+    u_int64_t _fitTotalTasks;
+    bool _fitTotalTasksPending;
+
     KnobsValues getNextMeaningfulKnobsValues(Explorer* explorer);
+
+    /**
+     * Searches the best configuration and publishes it.
+     * Executed by the fitter thread.
+     */
+    void fit();
+
+    /**
+     * Starts searching the best configuration on the fitter thread.
+     * @param reason Why the search was started.
+     */
+    void startFitting(FitReason reason);
+
+    /**
+     * Returns the configuration found by the fitter, if available.
+     * @param kv The configuration found by the fitter.
+     * @return True if the fitter terminated, false otherwise.
+     */
+    bool fittingTerminated(KnobsValues& kv);
+
+    /**
+     * Waits for the fitter thread and releases its data.
+     */
+    void joinFitter();
   
     std::unique_ptr<Predictor> getPredictor(PredictorType type,
                                             const Parameters& p,
@@ -513,17 +693,17 @@ public:
 
     KnobsValues getNextKnobsValues();
 
+    void updateBandwidthIn();
+
+    void updateTotalTasks(u_int64_t totalTasks);
+
+    void terminate();
+
     /**
      * Checks if the application phase changed.
      * @return true if the phase changed, false otherwise.
      */
     bool phaseChanged() const;
-
-    /**
-     * Checks the accuracy of the predictions.
-     * @return True if the predictions were accurate, false otherwise.
-     */
-    bool isAccurate();
 };
 
 /**
@@ -533,7 +713,11 @@ public:
  */
 class SelectorFixedExploration: public SelectorPredictive{
 private:
-    std::vector<KnobsValues> _confToExplore;
+    KnobsCombinations _combinations;
+    size_t _explorationStep;
+    // Number of configurations still to be explored.
+    size_t _numToExplore;
+    bool _warmStarting;
 public:
     SelectorFixedExploration(const Parameters& p,
                    const Configuration& configuration,
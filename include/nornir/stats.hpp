@@ -42,22 +42,27 @@ class ReconfigurationStats{
 private:
     std::vector<double> _knobs[KNOB_NUM];
     std::vector<double> _total;
+    std::vector<double> _stall;
     bool _storedKnob[KNOB_NUM];
     bool _storedTotal;
+    bool _storedStall;
 public:
     ReconfigurationStats(){
         for(size_t i = 0; i < KNOB_NUM; i++){
             _storedKnob[i] = false;
         }
         _storedTotal = false;
+        _storedStall = false;
     }
 
     void swap(ReconfigurationStats& x){
         using std::swap;
         swap(_knobs, x._knobs);
         swap(_total, x._total);
+        swap(_stall, x._stall);
         swap(_storedKnob, x._storedKnob);
         swap(_storedTotal, x._storedTotal);
+        swap(_storedStall, x._storedStall);
     }
 
     inline ReconfigurationStats(const ReconfigurationStats& other){
@@ -67,6 +72,8 @@ public:
         }
         _total = other._total;
         _storedTotal = other._storedTotal;
+        _stall = other._stall;
+        _storedStall = other._storedStall;
     }
 
     inline ReconfigurationStats& operator=(ReconfigurationStats other){
@@ -84,6 +91,15 @@ public:
         _total.push_back(total);
     }
 
+    /**
+     * Adds the time during which the application did not process
+     * tasks while changing the number of workers.
+     */
+    inline void addSampleStall(double stall){
+        _storedStall = true;
+        _stall.push_back(stall);
+    }
+
     inline double getAverageKnob(KnobType idx){
         return average(_knobs[idx]);
     }
@@ -100,6 +116,14 @@ public:
         return stddev(_total);
     }
 
+    inline double getAverageStall(){
+        return average(_stall);
+    }
+
+    inline double getStdDevStall(){
+        return stddev(_stall);
+    }
+
     inline bool storedKnob(KnobType idx){
         return _storedKnob[idx];
     }
@@ -107,6 +131,10 @@ public:
     inline bool storedTotal(){
         return _storedTotal;
     }
+
+    inline bool storedStall(){
+        return _storedStall;
+    }
 };
 
 typedef struct CalibrationStats{
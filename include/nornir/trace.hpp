@@ -0,0 +1,238 @@
+/*
+ * trace.hpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/*!
+ * \file trace.hpp
+ * \brief Replay of recorded arrival traces, to evaluate the adaptation
+ *        of nornir under realistic load.
+ **/
+
+#ifndef NORNIR_TRACE_HPP_
+#define NORNIR_TRACE_HPP_
+
+#include "stats.hpp"
+
+#include <mammut/mammut.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace nornir{
+
+/**
+ * Format of a trace file.
+ */
+typedef enum{
+    // Each line is 'timestamp payloadSize', where timestamp is the arrival
+    // time of the item (in seconds from the beginning of the trace) and
+    // payloadSize is the size of the item (in bytes).
+    TRACE_FORMAT_TIMESTAMPS = 0,
+
+    // Each line is 'rate duration [payloadSize]' (the same format used by
+    // dataflow::InputStreamRate): items arrive at 'rate' items per second
+    // for 'duration' seconds.
+    TRACE_FORMAT_RATES
+}TraceFormat;
+
+/**
+ * An item of a trace.
+ */
+typedef struct{
+    // Arrival time (in seconds from the beginning of the trace).
+    double arrival;
+
+    // Size of the item (in bytes).
+    size_t payloadSize;
+}TraceItem;
+
+/**
+ * Loads a trace from a file.
+ * @param fileName The name of the file.
+ * @param format The format of the file.
+ * @param defaultPayloadSize The size of the items when it is not
+ *        specified in the file.
+ * @return The items of the trace, sorted by arrival time.
+ */
+std::vector<TraceItem> loadTrace(const std::string& fileName,
+                                 TraceFormat format,
+                                 size_t defaultPayloadSize = 0);
+
+/**
+ * A change of configuration performed by nornir.
+ */
+typedef struct{
+    // Time of the change (milliseconds since the beginning of the monitoring).
+    double timestamp;
+
+    // The new configuration (real values of the knobs).
+    std::string configuration;
+}ReconfigurationEvent;
+
+/**
+ * A logger which records the configuration changes. Must be added to
+ * the loggers of the parameters. Since the manager deletes its loggers
+ * when the farm terminates, the changes are stored in a vector owned
+ * by the caller.
+ */
+class LoggerReconfigurations: public Logger{
+private:
+    std::vector<ReconfigurationEvent>& _events;
+    std::string _lastConfiguration;
+public:
+    /**
+     * Creates the logger.
+     * @param events The vector where the configuration changes are
+     *        stored. The first event is the initial configuration.
+     */
+    explicit LoggerReconfigurations(std::vector<ReconfigurationEvent>& events);
+
+    void log(bool isCalibrationPhase,
+             const Configuration& configuration,
+             const Smoother<MonitoredSample>& samples,
+             const Requirements& requirements);
+
+    void logSummary(const Configuration& configuration,
+                    Selector* selector, ulong durationMs, double totalTasks);
+};
+
+/**
+ * Results of the replay of a trace.
+ */
+typedef struct{
+    // Number of items of the trace.
+    size_t items;
+
+    // Number of items completed.
+    size_t completed;
+
+    // Time between the first arrival and the last completion (seconds).
+    double duration;
+
+    // Completed items per second.
+    double throughput;
+
+    // End-to-end latency of the completed items (milliseconds).
+    double latencyAvg;
+    double latencyP50;
+    double latencyP95;
+    double latencyP99;
+    double latencyMax;
+
+    // Energy consumed during the replay (Joules, 0 if not available).
+    double joules;
+
+    // Number of configuration changes (0 if the events were not provided).
+    size_t reconfigurations;
+}TraceReport;
+
+/**
+ * Writes a report.
+ * @param report The report.
+ * @param events The configuration changes (can be NULL).
+ * @param out The stream where the report is written.
+ */
+void printTraceReport(const TraceReport& report,
+                      const std::vector<ReconfigurationEvent>* events,
+                      std::ostream& out);
+
+/**
+ * Replays a trace: releases each item when its arrival time is reached
+ * and records its end-to-end latency when it is completed. It can be
+ * used to drive a Farm (from the scheduler), a FarmAccelerator (from the
+ * thread offloading the tasks) or a dataflow Interpreter (through
+ * dataflow::InputStreamTrace).
+ */
+class TraceReplayer: public mammut::utils::NonCopyable{
+private:
+    std::vector<TraceItem> _trace;
+    std::vector<double> _latencies;
+    std::vector<double> _completions;
+    size_t _next;
+    double _start;
+    mammut::Mammut _mammut;
+    mammut::energy::Counter* _counter;
+    double _startJoules;
+    const std::vector<ReconfigurationEvent>* _events;
+public:
+    /**
+     * Creates the replayer.
+     * @param trace The trace.
+     * @param events If not NULL, the configuration changes recorded
+     *        by a LoggerReconfigurations.
+     */
+    explicit TraceReplayer(const std::vector<TraceItem>& trace,
+                           const std::vector<ReconfigurationEvent>* events = NULL);
+
+    /**
+     * Returns an item of the trace.
+     * @param id The index of the item.
+     * @return The item.
+     */
+    const TraceItem& getItem(size_t id) const;
+
+    /**
+     * Checks if there are items not yet released.
+     * @return True if there are items not yet released.
+     */
+    bool hasNext() const;
+
+    /**
+     * Releases the next item, if its arrival time has been reached.
+     * The first call starts the replay.
+     * @param id The index of the released item.
+     * @return True if an item has been released, false otherwise.
+     */
+    bool poll(size_t& id);
+
+    /**
+     * Releases the next item, busy waiting until its arrival time.
+     * The first call starts the replay.
+     * @param id The index of the released item.
+     * @return True if an item has been released, false if the
+     *         trace is terminated.
+     */
+    bool next(size_t& id);
+
+    /**
+     * Must be called when the processing of an item is completed.
+     * Can be called concurrently for different items.
+     * @param id The index of the item.
+     */
+    void completed(size_t id);
+
+    /**
+     * Returns the results of the replay. Must be called
+     * after all the items have been completed.
+     * @return The results of the replay.
+     */
+    TraceReport getReport();
+};
+
+}
+
+#endif // NORNIR_TRACE_HPP_
@@ -36,6 +36,7 @@
 #include <riff/riff.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -50,6 +51,7 @@
 
 #define MSECS_IN_SECS 1000.0 // Milliseconds in 1 second
 #define NSECS_IN_SECS 1000000000.0 // Nanoseconds in 1 second
+#define NORNIR_CACHE_LINE_SIZE 64 // Used to pad data accessed by different threads
 #define MAX_RHO 2 //0.0001 (usato per i testcase) //96 //TODO Fix. (occhio ai test)
 
 #define XDG_CONFIG_DIR_FALLBACK "/etc/xdg"
@@ -93,13 +95,124 @@ inline double stddev(const std::vector<double>& v){
     return stddev(v, average(v));
 }
 
+#define LATENCY_HISTOGRAM_SUB_BUCKETS_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BUCKETS_BITS)
+#define LATENCY_HISTOGRAM_MAX_BITS 48 // Larger values are clamped.
+#define LATENCY_HISTOGRAM_BUCKETS ((LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BUCKETS_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * Log-linear histogram (HDR-style) of non negative values (e.g. the
+ * latencies of the tasks, in ticks). Each power of two range is split in
+ * LATENCY_HISTOGRAM_SUB_BUCKETS linear buckets, so the relative error
+ * of the reported values is bounded by 1/LATENCY_HISTOGRAM_SUB_BUCKETS.
+ * The buckets are statically allocated and the counters are cumulative
+ * (they are never reset), so that a single thread can record values while
+ * other threads read them. Differences between two snapshots give the
+ * histogram of the values recorded between them.
+ */
+class LatencyHistogram: NonCopyable{
+private:
+    std::atomic<unsigned long long> _buckets[LATENCY_HISTOGRAM_BUCKETS];
+public:
+    LatencyHistogram(){
+        for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++){
+            _buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Returns the bucket where a value is stored.
+     * @param value The value.
+     * @return The bucket where the value is stored.
+     */
+    static size_t getBucket(unsigned long long value){
+        if(value < LATENCY_HISTOGRAM_SUB_BUCKETS){
+            return value;
+        }
+        if(value >> LATENCY_HISTOGRAM_MAX_BITS){
+            value = (1ULL << LATENCY_HISTOGRAM_MAX_BITS) - 1;
+        }
+        size_t msb = 63 - __builtin_clzll(value);
+        size_t shift = msb - LATENCY_HISTOGRAM_SUB_BUCKETS_BITS;
+        return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS +
+               ((value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKETS);
+    }
+
+    /**
+     * Returns the highest value stored in a bucket.
+     * @param bucket The bucket.
+     * @return The highest value stored in the bucket.
+     */
+    static unsigned long long getBucketValue(size_t bucket){
+        if(bucket < LATENCY_HISTOGRAM_SUB_BUCKETS){
+            return bucket;
+        }
+        size_t shift = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+        unsigned long long mantissa = bucket % LATENCY_HISTOGRAM_SUB_BUCKETS +
+                                      LATENCY_HISTOGRAM_SUB_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    /**
+     * Records a value. Must always be called by the same thread.
+     * @param value The value.
+     */
+    void record(unsigned long long value){
+        std::atomic<unsigned long long>& b = _buckets[getBucket(value)];
+        // Single writer, no need for an atomic increment.
+        b.store(b.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    }
+
+    /**
+     * Reads the current values of the counters. Can be called by any thread.
+     * @param counts The counters. It must have LATENCY_HISTOGRAM_BUCKETS
+     *        elements.
+     */
+    void getCounts(std::vector<unsigned long long>& counts) const{
+        for(size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++){
+            counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Computes a percentile of the values in a set of counters.
+     * @param counts The counters.
+     * @param percentile The percentile, in (0, 100].
+     * @return The highest value of the bucket containing the percentile
+     *         (0 if the counters are empty).
+     */
+    static double getPercentile(const std::vector<unsigned long long>& counts,
+                                double percentile){
+        unsigned long long total = std::accumulate(counts.begin(),
+                                                   counts.end(), 0ULL);
+        if(!total){
+            return 0;
+        }
+        unsigned long long target = std::ceil(total * (percentile / 100.0));
+        if(!target){
+            target = 1;
+        }
+        unsigned long long seen = 0;
+        for(size_t i = 0; i < counts.size(); i++){
+            seen += counts[i];
+            if(seen >= target){
+                return getBucketValue(i);
+            }
+        }
+        return getBucketValue(counts.size() - 1);
+    }
+};
+
 typedef struct MonitoredSample: public riff::ApplicationSample{
     double watts; ///< Consumed watts.
+    double tailLatency; ///< Latency percentile (ns) specified in the requirements.
 
-    MonitoredSample():riff::ApplicationSample(), watts(0){;}
+    MonitoredSample():riff::ApplicationSample(), watts(0), tailLatency(0){;}
 
     MonitoredSample(MonitoredSample const& sample):
-        riff::ApplicationSample(sample), watts(sample.watts){;}
+        riff::ApplicationSample(sample), watts(sample.watts),
+        tailLatency(sample.tailLatency){;}
 
     double getMaximumThroughput(){
         if(loadPercentage < MAX_RHO &&
@@ -115,6 +228,7 @@ typedef struct MonitoredSample: public riff::ApplicationSample{
 
         riff::ApplicationSample::swap(x);
         swap(watts, x.watts);
+        swap(tailLatency, x.tailLatency);
     }
 
     MonitoredSample& operator=(MonitoredSample rhs){
@@ -125,36 +239,42 @@ typedef struct MonitoredSample: public riff::ApplicationSample{
     MonitoredSample& operator+=(const MonitoredSample& rhs){
         riff::ApplicationSample::operator+=(rhs);
         watts += rhs.watts;
+        tailLatency += rhs.tailLatency;
         return *this;
     }
 
     MonitoredSample& operator-=(const MonitoredSample& rhs){
         riff::ApplicationSample::operator-=(rhs);
         watts -= rhs.watts;
+        tailLatency -= rhs.tailLatency;
         return *this;
     }
 
     MonitoredSample& operator*=(const MonitoredSample& rhs){
         riff::ApplicationSample::operator*=(rhs);
         watts *= rhs.watts;
+        tailLatency *= rhs.tailLatency;
         return *this;
     }
 
     MonitoredSample& operator/=(const MonitoredSample& rhs){
         riff::ApplicationSample::operator/=(rhs);
         watts /= rhs.watts;
+        tailLatency /= rhs.tailLatency;
         return *this;
     }
 
     MonitoredSample operator/=(double x){
         riff::ApplicationSample::operator/=(x);
         watts /= x;
+        tailLatency /= x;
         return *this;
     }
 
     MonitoredSample operator*=(double x){
         riff::ApplicationSample::operator*=(x);
         watts *= x;
+        tailLatency *= x;
         return *this;
     }
 }MonitoredSample;
@@ -202,6 +322,7 @@ inline MonitoredSample operator/(const MonitoredSample& lhs, double x){
 inline std::ostream& operator<<(std::ostream& os, const MonitoredSample& sample){
     os << "[";
     os << "Watts: " << sample.watts << " ";
+    os << "TailLatency: " << sample.tailLatency << " ";
     os << "Knarr Sample: " << static_cast<const riff::ApplicationSample&>(sample) << " ";
     os << "]";
     return os;
@@ -211,6 +332,14 @@ inline std::istream& operator>>(std::istream& is, MonitoredSample& sample){
     is.ignore(std::numeric_limits<std::streamsize>::max(), '[');
     is.ignore(std::numeric_limits<std::streamsize>::max(), ':');
     is >> sample.watts;
+    // Samples stored before tailLatency was added don't have it.
+    is >> std::ws;
+    if(is.peek() == 'T'){
+        is.ignore(std::numeric_limits<std::streamsize>::max(), ':');
+        is >> sample.tailLatency;
+    }else{
+        sample.tailLatency = 0;
+    }
     is.ignore(std::numeric_limits<std::streamsize>::max(), ':');
     riff::operator >> (is, sample);
     is.ignore(std::numeric_limits<std::streamsize>::max(), ']');
@@ -230,6 +359,7 @@ inline MonitoredSample squareRoot(const MonitoredSample& x){
         r.customFields[i] = sqrt(x.customFields[i]);
     }
     r.watts = sqrt(x.watts);
+    r.tailLatency = sqrt(x.tailLatency);
     return r;
 }
 
@@ -242,6 +372,7 @@ inline void zero(MonitoredSample& x){
         x.customFields[i] = 0;
     }
     x.watts = 0;
+    x.tailLatency = 0;
 }
 
 inline void regularize(MonitoredSample& x){
@@ -265,6 +396,9 @@ inline void regularize(MonitoredSample& x){
     if(x.watts < 0){
         x.watts = 0;
     }
+    if(x.tailLatency < 0){
+        x.tailLatency = 0;
+    }
 }
 
 inline MonitoredSample minimum(const MonitoredSample& a,
@@ -283,6 +417,7 @@ inline MonitoredSample minimum(const MonitoredSample& a,
         ms.customFields[i] = std::min(a.customFields[i], b.customFields[i]);
     }
     ms.watts = std::min(a.watts, b.watts);
+    ms.tailLatency = std::min(a.tailLatency, b.tailLatency);
     return ms;
 }
 
@@ -301,6 +436,7 @@ inline MonitoredSample maximum(const MonitoredSample& a,
         ms.customFields[i] = std::max(a.customFields[i], b.customFields[i]);
     }
     ms.watts = std::max(a.watts, b.watts);
+    ms.tailLatency = std::max(a.tailLatency, b.tailLatency);
     return ms;
 }
 
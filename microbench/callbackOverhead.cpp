@@ -0,0 +1,91 @@
+/*
+ * callbackOverhead.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * Measures the per-task overhead of the nodes management hook, with
+ * the management queue checked on each task and with seqlock sampling.
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+#include <nornir/interface.hpp>
+
+#include <iostream>
+#include <time.h>
+
+static unsigned long long numTasks;
+static int dummyTask;
+
+unsigned long getNanoSeconds(){
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+class Emitter: public nornir::Scheduler<int>{
+private:
+    unsigned long long _sent;
+public:
+    Emitter():_sent(0){;}
+
+    int* schedule(){
+        if(_sent++ == numTasks){
+            return lastElement();
+        }
+        return &dummyTask;
+    }
+};
+
+class Worker: public nornir::Worker<int>{
+public:
+    void compute(int* task){
+        ;
+    }
+};
+
+double measure(bool seqlockSampling){
+    nornir::Parameters p;
+    p.seqlockSampling = seqlockSampling;
+    // Samples are taken as frequently as possible, to also account
+    // for the cost of answering to the manager.
+    p.samplingIntervalCalibration = 1;
+    p.samplingIntervalSteady = 1;
+    nornir::Farm<int> farm(&p);
+    farm.addScheduler(new Emitter());
+    farm.addWorker(new Worker());
+    unsigned long start = getNanoSeconds();
+    farm.start();
+    farm.wait();
+    return (getNanoSeconds() - start) / (double) numTasks;
+}
+
+int main(int argc, char** argv){
+    if(argc != 2){
+        std::cerr << "Usage: " << argv[0] << " numTasks" << std::endl;
+        return -1;
+    }
+    numTasks = atoll(argv[1]);
+    std::cout << "Management queue: " << measure(false) << " ns per task" << std::endl;
+    std::cout << "Seqlock sampling: " << measure(true) << " ns per task" << std::endl;
+    return 0;
+}
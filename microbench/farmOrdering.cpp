@@ -0,0 +1,112 @@
+/*
+ * farmOrdering.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * Measures the throughput of a farm with tiny tasks, with and without
+ * ordering preservation.
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+#include <nornir/interface.hpp>
+
+#include <iostream>
+#include <time.h>
+
+static unsigned long long numTasks;
+static std::vector<unsigned long long> tasks;
+
+unsigned long getNanoSeconds(){
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+class Emitter: public nornir::Scheduler<unsigned long long>{
+private:
+    unsigned long long _next;
+public:
+    Emitter():_next(0){;}
+
+    unsigned long long* schedule(){
+        if(_next == numTasks){
+            return lastElement();
+        }
+        return &(tasks[_next++]);
+    }
+};
+
+class Worker: public nornir::Worker<unsigned long long, unsigned long long>{
+public:
+    unsigned long long* compute(unsigned long long* task){
+        return task;
+    }
+};
+
+class Collector: public nornir::Gatherer<unsigned long long>{
+private:
+    unsigned long long _expected;
+    bool _ordered;
+public:
+    explicit Collector(bool ordered):_expected(0), _ordered(ordered){;}
+
+    void gather(unsigned long long* task){
+        if(_ordered && *task != _expected){
+            throw std::runtime_error("Ordering not preserved.");
+        }
+        ++_expected;
+    }
+};
+
+double measure(unsigned int numWorkers, bool ordered){
+    nornir::Parameters p;
+    nornir::Farm<unsigned long long, unsigned long long> farm(&p);
+    farm.addScheduler(new Emitter());
+    for(unsigned int i = 0; i < numWorkers; i++){
+        farm.addWorker(new Worker());
+    }
+    farm.addGatherer(new Collector(ordered));
+    if(ordered){
+        farm.preserveOrdering();
+    }
+    unsigned long start = getNanoSeconds();
+    farm.start();
+    farm.wait();
+    return numTasks / ((getNanoSeconds() - start) / 1000000000.0);
+}
+
+int main(int argc, char** argv){
+    if(argc != 3){
+        std::cerr << "Usage: " << argv[0] << " numWorkers numTasks" << std::endl;
+        return -1;
+    }
+    unsigned int numWorkers = atoi(argv[1]);
+    numTasks = atoll(argv[2]);
+    tasks.resize(numTasks);
+    for(unsigned long long i = 0; i < numTasks; i++){
+        tasks[i] = i;
+    }
+    std::cout << "Unordered: " << measure(numWorkers, false) << " tasks/s" << std::endl;
+    std::cout << "Ordered: " << measure(numWorkers, true) << " tasks/s" << std::endl;
+    return 0;
+}
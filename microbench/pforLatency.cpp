@@ -0,0 +1,70 @@
+/*
+ * pforLatency.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * Measures the fork/join latency of a ParallelFor loop, with and without
+ * the persistent team.
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+#include <nornir/interface.hpp>
+
+#include <iostream>
+#include <time.h>
+
+unsigned long getNanoSeconds(){
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return spec.tv_sec * 1000000000 + spec.tv_nsec;
+}
+
+double measure(unsigned long int numThreads, size_t numLoops, bool persistentTeam){
+    nornir::Parameters p;
+    p.pforPersistentTeam = persistentTeam;
+    nornir::ParallelFor pf(numThreads, &p);
+    std::vector<unsigned long long> v(numThreads);
+    // Warmup
+    pf.parallel_for(0, numThreads, 1, 1, [&](long long int idx, long long int id){
+        v[idx] = id;
+    });
+    unsigned long start = getNanoSeconds();
+    for(size_t i = 0; i < numLoops; i++){
+        pf.parallel_for(0, numThreads, 1, 1, [&](long long int idx, long long int id){
+            v[idx] = id;
+        });
+    }
+    return (getNanoSeconds() - start) / (double) numLoops / 1000.0;
+}
+
+int main(int argc, char** argv){
+    if(argc != 3){
+        std::cerr << "Usage: " << argv[0] << " numThreads numLoops" << std::endl;
+        return -1;
+    }
+    unsigned long int numThreads = atoi(argv[1]);
+    size_t numLoops = atoi(argv[2]);
+    std::cout << "Termination ranges: " << measure(numThreads, numLoops, false) << " us per loop" << std::endl;
+    std::cout << "Persistent team: " << measure(numThreads, numLoops, true) << " us per loop" << std::endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * traceReplay.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * Replays an arrival trace on a farm (or on a farm accelerator) managed
+ * by nornir, and reports latency, throughput, energy and reconfigurations.
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+#include <nornir/interface.hpp>
+#include <nornir/trace.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+typedef struct{
+    size_t id;
+    size_t payloadSize;
+    double result;
+}TraceTask;
+
+static nornir::TraceReplayer* replayer;
+static std::vector<TraceTask> tasks;
+
+class Emitter: public nornir::Scheduler<TraceTask>{
+public:
+    TraceTask* schedule(){
+        size_t id;
+        if(!replayer->next(id)){
+            return lastElement();
+        }
+        return &(tasks[id]);
+    }
+};
+
+class Forwarder: public nornir::Scheduler<TraceTask, TraceTask>{
+public:
+    TraceTask* schedule(TraceTask* task){
+        return task;
+    }
+};
+
+class Worker: public nornir::Worker<TraceTask, TraceTask>{
+public:
+    TraceTask* compute(TraceTask* task){
+        // Work proportional to the payload size.
+        double r = 0;
+        for(size_t i = 0; i < task->payloadSize; i++){
+            r += i * 0.5;
+        }
+        task->result = r;
+        return task;
+    }
+};
+
+class Collector: public nornir::Gatherer<TraceTask>{
+public:
+    void gather(TraceTask* task){
+        replayer->completed(task->id);
+    }
+};
+
+
+int main(int argc, char** argv){
+    if(argc < 4){
+        std::cerr << "Usage: " << argv[0] << " traceFile "
+                  << "[timestamps|rates] [farm|accelerator] "
+                  << "[reportFile] [parametersFile]" << std::endl;
+        return -1;
+    }
+    nornir::TraceFormat format;
+    if(!strcmp(argv[2], "timestamps")){
+        format = nornir::TRACE_FORMAT_TIMESTAMPS;
+    }else if(!strcmp(argv[2], "rates")){
+        format = nornir::TRACE_FORMAT_RATES;
+    }else{
+        std::cerr << "Unknown trace format " << argv[2] << std::endl;
+        return -1;
+    }
+    bool accelerator;
+    if(!strcmp(argv[3], "farm")){
+        accelerator = false;
+    }else if(!strcmp(argv[3], "accelerator")){
+        accelerator = true;
+    }else{
+        std::cerr << "Unknown mode " << argv[3] << std::endl;
+        return -1;
+    }
+
+    std::vector<nornir::TraceItem> trace = nornir::loadTrace(argv[1], format, 1000);
+    tasks.resize(trace.size());
+    for(size_t i = 0; i < trace.size(); i++){
+        tasks[i].id = i;
+        tasks[i].payloadSize = trace[i].payloadSize;
+        tasks[i].result = 0;
+    }
+
+    nornir::Parameters* p;
+    if(argc > 5){
+        p = new nornir::Parameters(argv[5]);
+    }else{
+        p = new nornir::Parameters();
+    }
+    // The logger is deleted by the manager, the events are not.
+    std::vector<nornir::ReconfigurationEvent> events;
+    p->loggers.push_back(new nornir::LoggerReconfigurations(events));
+    replayer = new nornir::TraceReplayer(trace, &events);
+    unsigned int numWorkers = mammut::Mammut().getInstanceTopology()->getVirtualCores().size();
+
+    if(accelerator){
+        nornir::FarmAccelerator<TraceTask, TraceTask, TraceTask> farm(p);
+        farm.addScheduler(new Forwarder());
+        for(unsigned int i = 0; i < numWorkers; i++){
+            farm.addWorker(new Worker());
+        }
+        farm.addGatherer(new Collector());
+        farm.start();
+        size_t id;
+        while(replayer->next(id)){
+            farm.offload(&(tasks[id]));
+        }
+        farm.shutdown();
+        farm.wait();
+    }else{
+        nornir::Farm<TraceTask, TraceTask> farm(p);
+        farm.addScheduler(new Emitter());
+        for(unsigned int i = 0; i < numWorkers; i++){
+            farm.addWorker(new Worker());
+        }
+        farm.addGatherer(new Collector());
+        farm.start();
+        farm.wait();
+    }
+
+    nornir::TraceReport report = replayer->getReport();
+    nornir::printTraceReport(report, NULL, std::cout);
+    if(argc > 4){
+        std::ofstream out(argv[4]);
+        nornir::printTraceReport(report, &events, out);
+        out.close();
+    }
+    delete replayer;
+    delete p;
+    return 0;
+}
@@ -25,6 +25,7 @@
  * =========================================================================
  */
 
+#include <algorithm>
 #include <iostream>
 #include <nornir/configuration.hpp>
 
@@ -66,23 +67,70 @@ Configuration::~Configuration() {
   }
 }
 
-// TODO: Works even if a std::vector is empty? (i.e. a knob has no values)
-void Configuration::combinations(std::vector<std::vector<double>> array,
-                                 size_t i, std::vector<double> accum) {
-  if (i == array.size()) {
-    KnobsValues kv(KNOB_VALUE_REAL);
+KnobsCombinations::const_iterator::const_iterator(
+    const KnobsCombinations *combinations, size_t index)
+    : _combinations(combinations), _index(index), _current(KNOB_VALUE_REAL) {
+  if (_index < _combinations->size()) {
     for (size_t i = 0; i < KNOB_NUM; i++) {
-      kv[(KnobType) i] = accum.at(i);
+      _ids[i] = _combinations->getValueId(_index, (KnobType) i);
     }
-    _combinations.push_back(kv);
-  } else {
-    std::vector<double> row = array.at(i);
-    for (size_t j = 0; j < row.size(); ++j) {
-      std::vector<double> tmp(accum);
-      tmp.push_back(row[j]);
-      combinations(array, i + 1, tmp);
+    _combinations->at(_index, _current);
+  }
+}
+
+KnobsCombinations::const_iterator &KnobsCombinations::const_iterator::
+operator++() {
+  ++_index;
+  if (_index < _combinations->size()) {
+    // Mixed-radix increment, only the changed knobs are updated.
+    for (size_t i = KNOB_NUM; i-- > 0;) {
+      const std::vector<double> &values = _combinations->_values[i];
+      if (++_ids[i] == values.size()) {
+        _ids[i] = 0;
+        _current[(KnobType) i] = values[0];
+      } else {
+        _current[(KnobType) i] = values[_ids[i]];
+        break;
+      }
     }
   }
+  return *this;
+}
+
+KnobsCombinations::KnobsCombinations(
+    const std::array<std::vector<double>, KNOB_NUM> &values)
+    : _values(values), _size(1) {
+  for (size_t i = KNOB_NUM; i-- > 0;) {
+    _strides[i] = _size;
+    _size *= _values[i].size();
+  }
+}
+
+void KnobsCombinations::at(size_t index, KnobsValues &values) const {
+  for (size_t i = 0; i < KNOB_NUM; i++) {
+    values[(KnobType) i] = _values[i][getValueId(index, (KnobType) i)];
+  }
+}
+
+KnobsValues KnobsCombinations::at(size_t index) const {
+  KnobsValues kv(KNOB_VALUE_REAL);
+  at(index, kv);
+  return kv;
+}
+
+bool KnobsCombinations::getIndex(const KnobsValues &values,
+                                 size_t &index) const {
+  index = 0;
+  for (size_t i = 0; i < KNOB_NUM; i++) {
+    const std::vector<double> &v = _values[i];
+    std::vector<double>::const_iterator it =
+        std::find(v.begin(), v.end(), values[(KnobType) i]);
+    if (it == v.end()) {
+      return false;
+    }
+    index += (it - v.begin()) * _strides[i];
+  }
+  return true;
 }
 
 uint Configuration::getNumHMP() const {
@@ -131,18 +179,29 @@ bool Configuration::knobsChangeNeeded() const {
   return false;
 }
 
+KnobsCombinations Configuration::getRealCombinations() const {
+  if (_numHMPs > 1) {
+    throw std::runtime_error(
+        "getRealCombinations() cannot be used on HMP systems.");
+  }
+  std::array<std::vector<double>, KNOB_NUM> values;
+  for (size_t i = 0; i < KNOB_NUM; i++) {
+    values[i] = _knobs[0][i]->getAllowedValues();
+  }
+  return KnobsCombinations(values);
+}
+
 void Configuration::createAllRealCombinations() {
   if (_numHMPs > 1) {
     throw std::runtime_error(
         "createAllRealCombinations() cannot be used on HMP systems.");
   }
-  std::vector<std::vector<double>> values;
-  std::vector<double> accum;
+  KnobsCombinations combinations = getRealCombinations();
   _combinations.clear();
-  for (size_t i = 0; i < KNOB_NUM; i++) {
-    values.push_back(_knobs[0][i]->getAllowedValues());
+  _combinations.reserve(combinations.size());
+  for (const KnobsValues &kv : combinations) {
+    _combinations.push_back(kv);
   }
-  combinations(values, 0, accum);
   _combinationsCreated = true;
 }
 
@@ -221,7 +280,7 @@ bool Configuration::virtualCoresWillChange(const KnobsValues &values) const {
 }
 
 ticks Configuration::startReconfigurationStatsKnob() const {
-  if (_p.statsReconfiguration) {
+  if (_p.statsReconfiguration || _p.reconfigurationResidenceTime) {
     return getticks();
   }
   return 0;
@@ -233,7 +292,7 @@ ticks Configuration::startReconfigurationStatsTotal() const {
 
 void Configuration::stopReconfigurationStatsKnob(ticks start, KnobType type,
                                                  bool vcChanged) {
-  if (_p.statsReconfiguration) {
+  if (_p.statsReconfiguration || _p.reconfigurationResidenceTime) {
     if (type == KNOB_VIRTUAL_CORES && !vcChanged) {
       // We do not add statistics about workers reconfiguration
       // since they did not changed.
@@ -247,12 +306,23 @@ void Configuration::stopReconfigurationStatsKnob(ticks start, KnobType type,
 }
 
 void Configuration::stopReconfigurationStatsTotal(ticks start) {
-  if (_p.statsReconfiguration) {
+  if (_p.statsReconfiguration || _p.reconfigurationResidenceTime) {
     double ms = ticksToMilliseconds(getticks() - start, _p.archData.ticksPerNs);
     _reconfigurationStats.addSampleTotal(ms);
   }
 }
 
+void Configuration::stopReconfigurationStatsStall() {
+  if (_p.statsReconfiguration || _p.reconfigurationResidenceTime) {
+    double ms = 0;
+    for (size_t k = 0; k < _knobs.size(); k++) {
+      ms += dynamic_cast<KnobVirtualCores *>(_knobs[k][KNOB_VIRTUAL_CORES])
+                ->getLastStallTime();
+    }
+    _reconfigurationStats.addSampleStall(ms);
+  }
+}
+
 void Configuration::setValues(const KnobsValues &values) {
   bool vcChanged = virtualCoresWillChange(values);
 
@@ -287,6 +357,9 @@ void Configuration::setValues(const KnobsValues &values) {
   }
 
   stopReconfigurationStatsTotal(totalStart);
+  if (vcChanged) {
+    stopReconfigurationStatsStall();
+  }
 
   DEBUG("Changed knobs values.");
 }
@@ -319,6 +392,8 @@ ConfigurationExternal::ConfigurationExternal(const Parameters &p, uint numHMPs)
           _numHMPs, c);
     }
     _knobs[c][KNOB_PFOR_CHUNK] = new KnobDummy(p);
+    _knobs[c][KNOB_DATAFLOW_BATCH] = new KnobDummy(p);
+    _knobs[c][KNOB_DATAFLOW_WINDOW] = new KnobDummy(p);
   }
 
   _triggers[TRIGGER_TYPE_Q_BLOCKING] = NULL;
@@ -354,6 +429,16 @@ ConfigurationFarm::ConfigurationFarm(const Parameters &p,
     }else{
       _knobs[c][KNOB_PFOR_CHUNK] = new KnobDummy(p);
     }
+    if(p.knobDataflowBatchEnabled){
+      _knobs[c][KNOB_DATAFLOW_BATCH] = new KnobDataflowBatch(p);
+    }else{
+      _knobs[c][KNOB_DATAFLOW_BATCH] = new KnobDummy(p);
+    }
+    if(p.knobDataflowWindowEnabled){
+      _knobs[c][KNOB_DATAFLOW_WINDOW] = new KnobDataflowWindow(p);
+    }else{
+      _knobs[c][KNOB_DATAFLOW_WINDOW] = new KnobDummy(p);
+    }
   }
 
   _triggers[TRIGGER_TYPE_Q_BLOCKING] =
@@ -391,6 +476,8 @@ ConfigurationPipe::ConfigurationPipe(
           p, *dynamic_cast<KnobMappingExternal *>(_knobs[c][KNOB_MAPPING]));
     }
     _knobs[c][KNOB_PFOR_CHUNK] = new KnobDummy(p);
+    _knobs[c][KNOB_DATAFLOW_BATCH] = new KnobDummy(p);
+    _knobs[c][KNOB_DATAFLOW_WINDOW] = new KnobDummy(p);
   }
 
   _triggers[TRIGGER_TYPE_Q_BLOCKING] = NULL;
@@ -30,6 +30,8 @@
 #include <nornir/dataflow/interpreter.hpp>
 #include <mammut/mammut.hpp>
 #include <map>
+#include <sched.h>
+#include <unistd.h>
 
 PUSH_WARNING
 GCC_DISABLE_WARNING(vla)
@@ -139,7 +141,6 @@ Mdfg* compile(Computable* c){
         for(int i = 0; i < workersNum; i++){
             Computable* wc = scatterer->getComputable(firstWorkerInstr[i]);
             scatterer->link(scatterer->getComputable(0), wc);
-            ewc->getScatterer()->_workers.push_back(wc);
         }
         delete[] firstWorkerInstr;
         /**Adds the collector.**/
@@ -150,7 +151,6 @@ Mdfg* compile(Computable* c){
         for(int i = 0; i < workersNum; i++){
             Computable* wc = scatterer->getComputable(lastWorkerInstr[i]);
             scatterer->link(wc, scatterer->getComputable(gathererInstrId));
-            ewc->getGatherer()->_workers.push_back(wc);
         }
         delete[] lastWorkerInstr;
         /**
@@ -182,16 +182,35 @@ private:
     const bool _compiled;
     /**Next free graph identifier.**/
     ulong _nextGraphId;
-    /**Pool of usable graphs.**/
-    std::deque<Mdfg*> *_pool;
-    /**Instances of the graph.**/
-    std::map<ulong, Mdfg*> *_graphs;
+    /**Storage for the instances of the graph.**/
+    MdfgInstances *_instances;
+    /**Index of the input token which receives the stream elements.**/
+    uint _inputPort;
+#ifdef DATAFLOW_MAP_TABLES
+    /**Instances of the graph (graph id -> instance index).**/
+    std::map<ulong, size_t> *_graphs;
     /**
      * Computed results. It's necessary to save them into a map for preserving
      * the order of the task received from the input stream. The results will
      * be periodically send to the output stream.
      **/
     std::map<ulong, void*> *_result;
+#else
+    /**Size of the window of graph ids in flight - 1 (power of 2).**/
+    ulong _windowMask;
+    /**Smallest id of a graph still in flight.**/
+    ulong _oldestGraphId;
+    /**Instances of the graph, indexed by graph id % window.**/
+    std::vector<size_t> _graphs;
+    /**
+     * Computed results. It's necessary to save them for preserving
+     * the order of the task received from the input stream. Indexed by
+     * graph id % window. The results will be periodically send to the
+     * output stream.
+     **/
+    std::vector<void*> _result;
+    std::vector<char> _resultPresent;
+#endif
 
     ulong
     /**Number of results not yet calculated.**/
@@ -201,8 +220,20 @@ private:
     size_t _maxWorkers;
     size_t _numWorkers;
     size_t _maxGraphs;
+    /**
+     * Maximum number of graphs in flight (at most _maxGraphs, can be
+     * changed by the knob).
+     **/
+    long int _window;
+    /**Credits last notified to the input stream.**/
+    size_t _credits;
+    /**Maximum and current sleep time when idle (microseconds).**/
+    ulong _maxIdleSleep;
+    ulong _idleSleep;
     bool _orderedProc;
     bool _orderedOut;
+    /**True if the workers fire the instructions.**/
+    bool _decentralised;
     QUEUE* _q;
     size_t _lastRcvId;
     ulong _tasksInside;
@@ -212,58 +243,430 @@ private:
     size_t* _mdfiSent;
     std::vector<WorkerMdf*>& _workers;
 
-    inline void sendToWorkers(Mdfi* instr){
-        ++_tasksInside;
-        if(_orderedProc){
-            size_t destination = _scheduling[instr->getId()];
-            ++_mdfiSent[destination];
-            sendTo(instr, destination);
+    /**Placement of the instructions.**/
+    DataflowPlacement _placement;
+    /**
+     * For each instruction, the instruction which produces its first
+     * input token (-1 for the first instruction).
+     **/
+    long* _producer;
+    /**CPU of each virtual core (for DATAFLOW_PLACEMENT_NUMA).**/
+    std::vector<int> _vcCpu;
+    /**Worker from which the next search for the least loaded starts.**/
+    size_t _nextWorker;
+    size_t _sentSinceSample;
+    double _imbalanceSum;
+    ulong _imbalanceSamples;
+
+    /**Maximum number of instructions in a batch (can be changed by the knob).**/
+    long int _batchSize;
+    /**
+     * Batches not yet sent to each worker. The one at position _maxWorkers
+     * contains the instructions which can be executed by any worker.
+     **/
+    Mdfi** _batchHead;
+    Mdfi** _batchTail;
+    size_t* _batchLength;
+    /**Number of batches not yet sent.**/
+    size_t _pendingBatches;
+    /**
+     * Instances held for each removed worker (only with orderedProcessing).
+     * Their instruction still has instances queued on that worker, they
+     * are sent when the instruction is moved.
+     **/
+    Mdfi** _heldHead;
+    Mdfi** _heldTail;
+
+    /**
+     * Sends a batch of instructions.
+     * \param destination The worker to which the batch must be sent
+     *        (_maxWorkers if the batch can be executed by any worker).
+     */
+    inline void flushBatch(size_t destination){
+        if(destination == _maxWorkers){
+            send(_batchHead[destination]);
         }else{
-            send(instr);
+            sendTo(_batchHead[destination], destination);
         }
+        _batchHead[destination] = NULL;
+        _batchLength[destination] = 0;
+        --_pendingBatches;
     }
 
-    void updateScheduling(size_t insId){
-#if 0
-        size_t minId = 0;
+    /**
+     * Sends all the batches not yet sent.
+     */
+    inline void flushBatches(){
+        for(size_t i = 0; _pendingBatches && i <= _maxWorkers; i++){
+            if(_batchHead[i]){
+                flushBatch(i);
+            }
+        }
+    }
+
+    /**
+     * Adds an instruction to a batch. The batch is sent when full.
+     * \param instr The instruction.
+     * \param destination The worker to which the instruction must be sent
+     *        (_maxWorkers if the instruction can be executed by any worker).
+     * \param canFlush If false, the batch is only sent by flushBatches.
+     */
+    inline void enqueue(Mdfi* instr, size_t destination, bool canFlush = true){
+        instr->setBatchNext(NULL);
+        if(_batchHead[destination]){
+            _batchTail[destination]->setBatchNext(instr);
+        }else{
+            _batchHead[destination] = instr;
+            ++_pendingBatches;
+        }
+        _batchTail[destination] = instr;
+        if(++_batchLength[destination] >= (size_t) _batchSize && canFlush){
+            flushBatch(destination);
+        }
+    }
+
+    /**
+     * Approximates the number of instructions in the input queue of a worker.
+     * \param worker The id of the worker.
+     * \return The number of instructions in the input queue of the worker.
+     */
+    inline size_t getLoad(size_t worker) const{
+        size_t processed = _workers.at(worker)->getProcessedTasks();
+        // With decentralised firing workers also process instructions
+        // which have not been sent by the scheduler.
+        if(processed >= _mdfiSent[worker]){
+            return 0;
+        }
+        return _mdfiSent[worker] - processed;
+    }
+
+    /**
+     * Returns the CPU where a worker is running.
+     * \param worker The id of the worker.
+     * \return The CPU where the worker is running, -1 if not known.
+     */
+    inline int getCpu(size_t worker) const{
+        int vc = _workers.at(worker)->getVirtualCore();
+        if(vc < 0 || (size_t) vc >= _vcCpu.size()){
+            return -1;
+        }
+        return _vcCpu[vc];
+    }
+
+    /**
+     * Finds the least loaded worker.
+     * \param cpu If different from -1, only the workers running on this CPU
+     *        are considered (if there are no such workers, all the workers
+     *        are considered).
+     * \return The id of the least loaded worker.
+     */
+    size_t getLeastLoaded(int cpu){
+        size_t best = _numWorkers;
         size_t minLoad = std::numeric_limits<size_t>::max();
-        size_t load;
-        size_t baseId = _scheduling[insId];
-        size_t workerId = 0;
         for(size_t i = 0; i < _numWorkers; i++){
-            workerId = (baseId + i) % _numWorkers;
-            load = _mdfiSent[workerId] - _workers.at(workerId)->getProcessedTasks(); // Approximates the number of tasks in the input Q of worker i.
-            //std::cout << "Load of " << workerId << ": " << load << std::endl;
+            // Starts from a different worker each time to break ties.
+            size_t worker = (_nextWorker + i) % _numWorkers;
+            if(cpu != -1 && getCpu(worker) != cpu){
+                continue;
+            }
+            size_t load = getLoad(worker);
             if(load < minLoad){
                 minLoad = load;
-                minId = workerId;
+                best = worker;
             }
         }
-        _scheduling[insId] = minId;
-#endif
+        if(best == _numWorkers){
+            return getLeastLoaded(-1);
+        }
+        _nextWorker = (best + 1) % _numWorkers;
+        return best;
     }
 
-    void getFromInput(void* next){
-        Mdfg *newGraph;
-        Mdfi *first;
-#ifdef POOL
-        if(_pool->size()){
-            newGraph = _pool->front();
-            _pool->pop_front();
-            newGraph->reset(_nextGraphId);
-            assert(_graphs->insert(std::pair<ulong, Mdfg*>(_nextGraphId, newGraph)).second);
+    /**
+     * Selects the worker which will execute an instruction.
+     * \param producer The worker which produced the input token of the
+     *        instruction, -1 if not known.
+     * \return The id of the worker.
+     */
+    size_t selectWorker(int producer){
+        if(producer >= (int) _numWorkers){
+            producer = -1;
+        }
+        switch(_placement){
+            case DATAFLOW_PLACEMENT_AFFINITY:{
+                if(producer != -1){
+                    return producer;
+                }
+                return getLeastLoaded(-1);
+            }break;
+            case DATAFLOW_PLACEMENT_NUMA:{
+                return getLeastLoaded(producer != -1 ? getCpu(producer) : -1);
+            }break;
+            default:{
+                return getLeastLoaded(-1);
+            }break;
+        }
+    }
+
+    /**
+     * Updates the queue depth imbalance.
+     */
+    void sampleImbalance(){
+        if(++_sentSinceSample < DATAFLOW_IMBALANCE_SAMPLING){
+            return;
+        }
+        _sentSinceSample = 0;
+        size_t maxLoad = 0, totalLoad = 0;
+        for(size_t i = 0; i < _numWorkers; i++){
+            size_t load = getLoad(i);
+            totalLoad += load;
+            if(load > maxLoad){
+                maxLoad = load;
+            }
+        }
+        if(totalLoad){
+            _imbalanceSum += maxLoad / ((double) totalLoad / _numWorkers);
+            ++_imbalanceSamples;
+        }
+    }
+
+    /**
+     * Sends an instruction to a specific worker.
+     * \param instr The instruction.
+     * \param worker The id of the worker.
+     * \param canFlush If false, the batch is only sent by flushBatches.
+     */
+    inline void sendToWorker(Mdfi* instr, size_t worker, bool canFlush = true){
+        if(!_decentralised){
+            ++_numMdfi[instr->getId()];
+        }
+        ++_mdfiSent[worker];
+        enqueue(instr, worker, canFlush);
+        sampleImbalance();
+    }
+
+    /**
+     * Holds an instruction until its instances queued on a removed
+     * worker have been processed.
+     * \param instr The instruction.
+     * \param worker The id of the removed worker.
+     */
+    inline void hold(Mdfi* instr, size_t worker){
+        instr->setBatchNext(NULL);
+        if(_heldHead[worker]){
+            _heldTail[worker]->setBatchNext(instr);
         }else{
-            newGraph = new Mdfg(*_graph, _nextGraphId);
-            assert(_graphs->insert(std::pair<ulong, Mdfg*>(_nextGraphId, newGraph)).second);
+            _heldHead[worker] = instr;
+        }
+        _heldTail[worker] = instr;
+    }
+
+    /**
+     * Sends the instructions held for a worker which can now be executed
+     * by a running worker. The others are held again, in the same order.
+     * \param worker The id of the worker.
+     * \param canFlush If false, the batches are only sent by flushBatches.
+     */
+    void releaseHeld(size_t worker, bool canFlush = true){
+        Mdfi* instr = _heldHead[worker];
+        _heldHead[worker] = NULL;
+        _heldTail[worker] = NULL;
+        while(instr){
+            Mdfi* next = instr->getBatchNext();
+            size_t destination;
+            if(_orderedProc){
+                destination = _scheduling[instr->getId()];
+            }else{
+                // Only the batches of removed workers, any worker is fine.
+                destination = selectWorker(-1);
+            }
+            if(destination >= _numWorkers){
+                hold(instr, destination);
+            }else{
+                sendToWorker(instr, destination, canFlush);
+            }
+            instr = next;
+        }
+    }
+
+    /**
+     * Sends an instruction to the workers.
+     * \param instr The instruction.
+     * \param producer The worker which produced the input token of the
+     *        instruction, -1 if not known.
+     */
+    inline void sendToWorkers(Mdfi* instr, int producer = -1){
+        ++_tasksInside;
+        if(_orderedProc){
+            // Placement only changes in updateScheduling.
+            size_t destination = _scheduling[instr->getId()];
+            if(destination >= _numWorkers){
+                // Other instances are still queued on a removed worker.
+                hold(instr, destination);
+            }else{
+                sendToWorker(instr, destination);
+            }
+        }else if(_placement != DATAFLOW_PLACEMENT_STATIC){
+            sendToWorker(instr, selectWorker(producer));
+        }else{
+            if(!_decentralised){
+                ++_numMdfi[instr->getId()];
+            }
+            enqueue(instr, _maxWorkers);
+        }
+    }
+
+    /**
+     * Called when no instances of an instruction are being executed.
+     * Moving the instruction to another worker doesn't change the order
+     * in which its instances are processed.
+     * \param insId The id of the instruction.
+     */
+    void updateScheduling(size_t insId){
+        size_t oldWorker = _scheduling[insId];
+        if(_placement == DATAFLOW_PLACEMENT_STATIC){
+            _scheduling[insId] = insId % _numWorkers;
+        }else{
+            int producer = -1;
+            if(_producer[insId] != -1){
+                producer = _scheduling[_producer[insId]];
+            }
+            _scheduling[insId] = selectWorker(producer);
+        }
+        if(oldWorker >= _numWorkers && _heldHead[oldWorker]){
+            releaseHeld(oldWorker);
+        }
+    }
+
+    /**
+     * Checks if a new stream element can be accepted.
+     * \return \e true if a new graph can be instantiated.
+     */
+    inline bool canAcceptGraph() const{
+#ifdef DATAFLOW_MAP_TABLES
+        return _graphsInside < (ulong) _window;
+#else
+        // The ids of the graphs in flight must fit in the window.
+        return _graphsInside < (ulong) _window &&
+               _nextGraphId - _oldestGraphId <= _windowMask;
+#endif
+    }
+
+    /**
+     * Notifies the input stream if the number of graphs it can
+     * still send to the interpreter has changed.
+     */
+    inline void updateCredits(){
+        size_t credits = 0;
+        if(_graphsInside < (ulong) _window){
+            credits = _window - _graphsInside;
+        }
+        if(credits != _credits){
+            _credits = credits;
+            _in->setCredits(credits);
+        }
+    }
+
+    /**
+     * Called when an iteration of the scheduler found nothing to do.
+     * Sleeps with an exponential backoff if maxIdleSleep is set.
+     */
+    inline void idle(){
+        if(_maxIdleSleep){
+            _idleSleep = _idleSleep ? _idleSleep * 2 : 1;
+            if(_idleSleep > _maxIdleSleep){
+                _idleSleep = _maxIdleSleep;
+            }
+            usleep(_idleSleep);
+        }
+    }
+
+    inline void addGraph(ulong graphId, size_t slot){
+#ifdef DATAFLOW_MAP_TABLES
+        _graphs->emplace(graphId, slot);
+#else
+        _graphs[graphId & _windowMask] = slot;
+#endif
+    }
+
+    inline size_t getGraph(ulong graphId){
+#ifdef DATAFLOW_MAP_TABLES
+        return _graphs->at(graphId);
+#else
+        return _graphs[graphId & _windowMask];
+#endif
+    }
+
+    /**
+     * Removes a graph.
+     * \param graphId The id of the graph.
+     * \return The index of the instance used by the graph.
+     */
+    inline size_t removeGraph(ulong graphId){
+        size_t slot;
+#ifdef DATAFLOW_MAP_TABLES
+        auto it = _graphs->find(graphId);
+        if(it == _graphs->end()){
+            throw std::runtime_error("Graph not found.");
+        }
+        slot = it->second;
+        _graphs->erase(it);
+#else
+        size_t& entry = _graphs[graphId & _windowMask];
+        if(entry == DATAFLOW_NO_INSTANCE){
+            throw std::runtime_error("Graph not found.");
+        }
+        slot = entry;
+        entry = DATAFLOW_NO_INSTANCE;
+        while(_oldestGraphId < _nextGraphId &&
+              _graphs[_oldestGraphId & _windowMask] == DATAFLOW_NO_INSTANCE){
+            ++_oldestGraphId;
+        }
+#endif
+        return slot;
+    }
+
+    inline void storeResult(ulong graphId, void* result){
+#ifdef DATAFLOW_MAP_TABLES
+        _result->emplace(std::piecewise_construct,
+                         std::forward_as_tuple(graphId),
+                         std::forward_as_tuple(result));
+#else
+        _result[graphId & _windowMask] = result;
+        _resultPresent[graphId & _windowMask] = true;
+#endif
+    }
+
+    /**
+     * While exist a result with id equals to \e lastSent,
+     * sends the result to the stream.
+     * PRESERVES THE ORDER OF THE TASKS.
+     **/
+    inline void flushResults(){
+#ifdef DATAFLOW_MAP_TABLES
+        std::map<ulong, void*>::iterator it;
+        while((it = _result->find(_lastSent)) != _result->end()){
+            void* se = it->second;
+            _result->erase(it);
+            _out->put(se);
+            ++_lastSent;
         }
 #else
-        newGraph = new Mdfg(*_graph, _nextGraphId);
-        assert(_graphs->insert(std::pair<ulong, Mdfg*>(_nextGraphId, newGraph)).second);
+        while(_resultPresent[_lastSent & _windowMask]){
+            _resultPresent[_lastSent & _windowMask] = false;
+            _out->put(_result[_lastSent & _windowMask]);
+            ++_lastSent;
+        }
 #endif
+    }
+
+    void getFromInput(void* next){
+        Mdfi *first;
+        size_t slot = _instances->acquire(_nextGraphId);
+        addGraph(_nextGraphId, slot);
 
-        first = newGraph->getMdfi(newGraph->getFirstId());
-        first->setInput(next, NULL);
-        ++_numMdfi[first->getId()];
+        first = _instances->getMdfi(slot, _graph->getFirstId());
+        first->setInputPort(next, _inputPort);
         /**Sends the new instruction to the interpreter.*/
         sendToWorkers(first);
         ++_taskSent;
@@ -273,15 +676,36 @@ private:
     }
 public:
     Scheduler(Mdfg *graph, InputStream *i, OutputStream *o, size_t parDegree,
-              QUEUE* q, std::vector<WorkerMdf*>& workers, DataflowParameters* p):
+              QUEUE* q, std::vector<WorkerMdf*>& workers, DataflowParameters* p,
+              Topology* topology):
                 _in(i), _out(o), _graph(graph), _compiled(false), _nextGraphId(0),
-                _pool(NULL), _taskSent(0), _lastSent(0), _maxWorkers(parDegree),
+                _taskSent(0), _lastSent(0), _maxWorkers(parDegree),
                 _numWorkers(parDegree), _maxGraphs(p->maxGraphs),
+                _window(p->maxGraphs), _credits(0),
+                _maxIdleSleep(p->maxIdleSleep), _idleSleep(0),
                 _orderedProc(p->orderedProcessing),
-                _orderedOut(p->orderedOutput), _q(q), _lastRcvId(0),
-                _tasksInside(0), _graphsInside(0), _workers(workers){
-        _graphs = new std::map<ulong, Mdfg*>;
+                _orderedOut(p->orderedOutput),
+                _decentralised(p->decentralisedFiring), _q(q), _lastRcvId(0),
+                _tasksInside(0), _graphsInside(0), _workers(workers),
+                _placement(p->placement), _nextWorker(0), _sentSinceSample(0),
+                _imbalanceSum(0), _imbalanceSamples(0),
+                _batchSize(p->batchSize), _pendingBatches(0){
+        _instances = new MdfgInstances(*_graph, _maxGraphs);
+        _inputPort = _graph->getMdfi(_graph->getFirstId())->getSourcePort(NULL);
+#ifdef DATAFLOW_MAP_TABLES
+        _graphs = new std::map<ulong, size_t>;
         _result = new std::map<ulong, void*>;
+#else
+        ulong window = 1;
+        while(window < DATAFLOW_GRAPHS_WINDOW_FACTOR * _maxGraphs){
+            window <<= 1;
+        }
+        _windowMask = window - 1;
+        _oldestGraphId = 0;
+        _graphs.resize(window, DATAFLOW_NO_INSTANCE);
+        _result.resize(window, NULL);
+        _resultPresent.resize(window, false);
+#endif
         _scheduling = new size_t[_graph->getNumMdfi()];
         _numMdfi = new size_t[_graph->getNumMdfi()];
         for(size_t i = 0; i < _graph->getNumMdfi(); i++){
@@ -292,30 +716,142 @@ public:
         for(size_t i = 0; i < parDegree; i++){
             _mdfiSent[i] = 0;
         }
+        _batchHead = new Mdfi*[parDegree + 1];
+        _batchTail = new Mdfi*[parDegree + 1];
+        _batchLength = new size_t[parDegree + 1];
+        for(size_t i = 0; i < parDegree + 1; i++){
+            _batchHead[i] = NULL;
+            _batchTail[i] = NULL;
+            _batchLength[i] = 0;
+        }
+        _heldHead = new Mdfi*[parDegree];
+        _heldTail = new Mdfi*[parDegree];
+        for(size_t i = 0; i < parDegree; i++){
+            _heldHead[i] = NULL;
+            _heldTail[i] = NULL;
+        }
+        _producer = new long[_graph->getNumMdfi()];
+        for(size_t i = 0; i < _graph->getNumMdfi(); i++){
+            _producer[i] = -1;
+        }
+        for(size_t i = 0; i < _graph->getNumMdfi(); i++){
+            Mdfi* ins = _graph->getMdfi(i);
+            for(uint j = 0; j < ins->getNumOutTokens(); j++){
+                TokenId dest = ins->getOutToken(j)->getDest();
+                if(!dest.isOutStream() && _producer[dest.getMdfId()] == -1){
+                    _producer[dest.getMdfId()] = i;
+                }
+            }
+        }
+        if(_placement == DATAFLOW_PLACEMENT_NUMA){
+            std::vector<VirtualCore*> vcs = topology->getVirtualCores();
+            for(size_t i = 0; i < vcs.size(); i++){
+                VirtualCoreId id = vcs[i]->getVirtualCoreId();
+                if(id >= _vcCpu.size()){
+                    _vcCpu.resize(id + 1, -1);
+                }
+                _vcCpu[id] = vcs[i]->getCpuId();
+            }
+        }
     }
 
     ~Scheduler(){
-#ifdef POOL
-        while(_pool->size()!=0){
-            Mdfg* g = _pool->front();
-            _pool->pop_front();
-            delete g;
-        }
-        delete _pool;
-#endif
+        delete _instances;
+#ifdef DATAFLOW_MAP_TABLES
         delete _graphs;
         delete _result;
+#endif
         delete[] _scheduling;
         delete[] _numMdfi;
         delete[] _mdfiSent;
+        delete[] _producer;
+        delete[] _batchHead;
+        delete[] _batchTail;
+        delete[] _batchLength;
+        delete[] _heldHead;
+        delete[] _heldTail;
     }
 
     void notifyRethreading(size_t oldNumWorkers, size_t newNumWorkers){
         _numWorkers = newNumWorkers;
+        _nextWorker = 0;
+        /**
+         * The batches not yet sent to the removed workers would never be
+         * processed. Their instructions are held like the ones produced
+         * while the instruction can't be moved.
+         **/
+        for(size_t i = _numWorkers; i < _maxWorkers; i++){
+            Mdfi* instr = _batchHead[i];
+            if(!instr){
+                continue;
+            }
+            _batchHead[i] = NULL;
+            _batchLength[i] = 0;
+            --_pendingBatches;
+            while(instr){
+                Mdfi* next = instr->getBatchNext();
+                if(!_decentralised){
+                    --_numMdfi[instr->getId()];
+                }
+                --_mdfiSent[i];
+                hold(instr, i);
+                instr = next;
+            }
+        }
         for(size_t i = 0; i < _graph->getNumMdfi(); i++){
-            _scheduling[i] = i % _numWorkers;
-            _numMdfi[i] = 0;
+            if(_numMdfi[i]){
+                // Instances still queued, moving it now could reorder
+                // them. updateScheduling moves it when they are done.
+                continue;
+            }
+            if(_placement == DATAFLOW_PLACEMENT_STATIC){
+                _scheduling[i] = i % _numWorkers;
+            }else if(_scheduling[i] >= _numWorkers){
+                // Only moves the instructions of the removed workers.
+                _scheduling[i] = selectWorker(-1);
+            }
         }
+        /**
+         * Sends the instructions which can now be executed by a running
+         * worker. We may be called by the manager before the farm is
+         * restarted, so the batches are sent later by the scheduler.
+         **/
+        for(size_t i = 0; i < _maxWorkers; i++){
+            if(_heldHead[i]){
+                releaseHeld(i, false);
+            }
+        }
+    }
+
+    /**
+     * Returns the average queue depth imbalance.
+     * \return The average queue depth imbalance, 0 if not available.
+     */
+    double getImbalance() const{
+        if(!_imbalanceSamples){
+            return 0;
+        }
+        return _imbalanceSum / _imbalanceSamples;
+    }
+
+    /**
+     * Returns the variable containing the maximum number of instructions
+     * in a batch.
+     * \return The variable containing the maximum number of instructions
+     *         in a batch.
+     */
+    long int* getBatchSizePointer(){
+        return &_batchSize;
+    }
+
+    /**
+     * Returns the variable containing the maximum number of graphs
+     * in flight.
+     * \return The variable containing the maximum number of graphs
+     *         in flight.
+     */
+    long int* getWindowPointer(){
+        return &_window;
     }
 
 
@@ -331,17 +867,11 @@ public:
         uint poppedId;
         _q->registerq(0);
 
-#ifdef POOL
-        _pool = new std::deque<Mdfg*>;
-        for(size_t i = 0; i < MAXPOOLSIZE; i++){
-            _pool->push_back(new Mdfg(*_graph, 0));
-        }
-#endif
-
         /** Bootstrap. **/
         size_t inserted = 0;
         size_t totalSent = 0;
-        while(inserted < _maxGraphs && _in->hasNext()){
+        updateCredits();
+        while(canAcceptGraph() && _in->hasNext()){
             next = _in->next();
             if(next){
                 getFromInput(next);
@@ -349,39 +879,56 @@ public:
                 ++totalSent;
             }
         }
+        flushBatches();
         uint popped = 0;
         while(!end){
+            bool gotInput = false, gotOutput = false;
+            if(_orderedProc || _placement != DATAFLOW_PLACEMENT_STATIC){
+                // Instructions are only sent to specific workers.
+                checkManagementRequests();
+            }
             /////////////////////
             // Get from input. //
             /////////////////////
-            if(_graphsInside < _maxGraphs &&
+            if(canAcceptGraph() &&
                _in->hasNext() && (next = _in->next()) != NULL){
                 // cppcheck-suppress unreadVariable
                 getFromInput(next);
                 //popped = 0;                
                 ++inserted;                
                 ++totalSent;
+                gotInput = true;
             }
 
             //////////////////////
             // Get from output. //
             //////////////////////
             if(_q->pop((void**) &task, 0)){
+                gotOutput = true;
+                poppedIns = static_cast<Mdfi*>(task);
+            }else{
+                poppedIns = NULL;
+            }
+            /**The workers send back the computed instructions in batches.**/
+            while(poppedIns){
+                Mdfi* nextPopped = poppedIns->getBatchNext();
                 popped++;
                 --_tasksInside;
-                poppedIns = static_cast<Mdfi*>(task);
-                size_t numOutTokens = poppedIns->getNumOutTokens();
-                for(uint j = 0; j < numOutTokens; j++){
-                    ot = *(poppedIns->getOutToken(j));
-                    poppedId = poppedIns->getId();
+                poppedId = poppedIns->getId();
+                // With decentralised firing, we only receive the last
+                // instruction of each graph.
+                if(!_decentralised){
                     --_numMdfi[poppedId];
                     if(_numMdfi[poppedId] == 0){
                         // Can change the scheduling.
                         updateScheduling(poppedId);
                     }
+                }
+                size_t numOutTokens = poppedIns->getNumOutTokens();
+                for(uint j = 0; j < numOutTokens; j++){
+                    ot = *(poppedIns->getOutToken(j));
                     dest = ot.getDest();
                     graphId = dest.getGraphId();
-                    Mdfg* currentGraph = NULL;
                     /**
                      * If was the last instruction of a graph's copy, puts it
                      * into the output vector and delete
@@ -394,48 +941,44 @@ public:
                                 _out->put(ot.getResult());
                                 ++_lastSent;
                             }else{
-                                _result->emplace(std::piecewise_construct,
-                                                 std::forward_as_tuple(graphId),
-                                                 std::forward_as_tuple(ot.getResult()));
+                                storeResult(graphId, ot.getResult());
                             }
                         }
-                        auto it = _graphs->find(graphId);
-                        if(it != _graphs->end()){
-                            currentGraph = it->second;
-                            _graphs->erase(it);
-                        }else{
-                            throw std::runtime_error("Graph not found.");
-                        }
-#ifdef POOL
-                        if(_pool->size() < MAXPOOLSIZE){
-                            _pool->push_back(currentGraph);
-                        }else{
-                            delete currentGraph;
-                        }
-#else
-                        delete currentGraph;
-#endif
+                        _instances->release(removeGraph(graphId));
                         --_taskSent;
                         --_graphsInside;
                     }else{
-                        /**Takes the pointer to the copy of the graph.**/
-                        currentGraph = _graphs->at(graphId);
                         /**Takes the pointer to the instruction.**/
-                        ins = currentGraph->getMdfi(dest.getMdfId());
+                        ins = _instances->getMdfi(getGraph(graphId),
+                                                  dest.getMdfId());
                         /**Updates the instruction adding the input token.**/
-                        ins->setInput(ot.getResult(), poppedIns->getComputable());
+                        ins->setInputPort(ot.getResult(), dest.getPortId());
                         /**
                          * If the instruction is fireable, adds it to the pool of
                          * fireable instructions.
                          **/
                         if(ins->isFireable()){
-                            sendToWorkers(ins);
-                            // cppcheck-suppress unreadVariable
-                            ++_numMdfi[ins->getId()];                            
+                            sendToWorkers(ins, poppedIns->getWorker());
                             ++totalSent;
                         }
                     }
                 }
+                poppedIns = nextPopped;
+            }
+
+            /**
+             * Batches are never delayed: they are sent as soon as
+             * there is nothing else to do.
+             */
+            if(!gotInput || !gotOutput){
+                flushBatches();
+            }
+
+            updateCredits();
+            if(gotInput || gotOutput){
+                _idleSleep = 0;
+            }else{
+                idle();
             }
 
             /**
@@ -448,19 +991,8 @@ public:
             ////////////////////
             // Output stream. //
             ////////////////////
-            /**
-             * While exist an entry of the map with key equals to \e lastSent,
-             * sends the result to the stream.
-             * PRESERVES THE ORDER OF THE TASKS.
-             **/
             if(_out && _orderedOut){
-                std::map<ulong, void*>::iterator it;
-                while((it = _result->find(_lastSent)) != _result->end()){
-                    void* se = it->second;
-                    _result->erase(it);
-                    _out->put(se);
-                    ++_lastSent;
-                }
+                flushResults();
             }
         }/**End of while(!end).**/
         _q->deregisterq(0);
@@ -468,7 +1000,76 @@ public:
     }
 };
 
-WorkerMdf::WorkerMdf(QUEUE* q):_q(q), _init(false), _qId(-1), _processedTasks(0){;}
+WorkerMdf::WorkerMdf(QUEUE* q, size_t numMdfi, std::vector<MdfiDeque*>* deques,
+                     bool profileServiceTimes):
+        _q(q), _init(false), _qId(-1), _processedTasks(0), _virtualCore(-1),
+        _deques(deques), _profileServiceTimes(profileServiceTimes),
+        _serviceTicks(numMdfi), _serviceCount(numMdfi){
+    for(size_t i = 0; i < numMdfi; i++){
+        _serviceTicks[i].store(0, std::memory_order_relaxed);
+        _serviceCount[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void WorkerMdf::computeMdfi(Mdfi* t){
+    if(_profileServiceTimes){
+        ticks start = getticks();
+        t->compute();
+        ticks elapsed = getticks() - start;
+        std::atomic<ticks>& serviceTicks = _serviceTicks[t->getId()];
+        std::atomic<size_t>& serviceCount = _serviceCount[t->getId()];
+        serviceTicks.store(serviceTicks.load(std::memory_order_relaxed) + elapsed,
+                           std::memory_order_relaxed);
+        serviceCount.store(serviceCount.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+    }else{
+        t->compute();
+    }
+    t->setWorker(getId());
+}
+
+Mdfi* WorkerMdf::fire(Mdfi* t){
+    Mdfi* next = NULL;
+    for(uint i = 0; i < t->getNumOutTokens(); i++){
+        OutputToken* ot = t->getOutToken(i);
+        TokenId dest = ot->getDest();
+        if(dest.isOutStream()){
+            // The scheduler sends the result to the output stream and
+            // recycles the graph, t can't be accessed anymore.
+            assert(t->getNumOutTokens() == 1);
+            _q->push((void*) t, _qId);
+            return NULL;
+        }
+        Mdfi* ins = t->getDestination(i);
+        if(ins->setInputPortConcurrent(ot->getResult(), dest.getPortId())){
+            if(!next){
+                next = ins;
+            }else if(!_deques->at(getId())->push(ins)){
+                _overflow.push_back(ins);
+            }
+        }
+    }
+    return next;
+}
+
+Mdfi* WorkerMdf::getFireable(){
+    Mdfi* ins = NULL;
+    if(!_overflow.empty()){
+        ins = _overflow.back();
+        _overflow.pop_back();
+        return ins;
+    }
+    if(_deques->at(getId())->pop(ins)){
+        return ins;
+    }
+    for(size_t i = 1; i < _deques->size(); i++){
+        size_t victim = (getId() + i) % _deques->size();
+        if(_deques->at(victim)->steal(ins)){
+            return ins;
+        }
+    }
+    return NULL;
+}
 
 void WorkerMdf::compute(Mdfi* t){
     if(!_init){
@@ -476,23 +1077,65 @@ void WorkerMdf::compute(Mdfi* t){
         _init = true;
         _q->registerq(_qId);
     }
-    t->compute();
-    _q->push((void*) t, _qId);
-    ++_processedTasks;
+    _virtualCore.store(sched_getcpu(), std::memory_order_relaxed);
+    if(!_deques){
+        /**
+         * t is a batch of instructions. They are sent back to the
+         * scheduler in a single batch, in the same order.
+         **/
+        size_t computed = 0;
+        for(Mdfi* i = t; i; i = i->getBatchNext()){
+            computeMdfi(i);
+            ++computed;
+        }
+        _q->push((void*) t, _qId);
+        _processedTasks.store(_processedTasks.load(std::memory_order_relaxed) + computed,
+                              std::memory_order_relaxed);
+        return;
+    }
+    while(t){
+        Mdfi* batchNext = t->getBatchNext();
+        t->setBatchNext(NULL);
+        /**
+         * Executes the successors which become fireable. Before moving to
+         * the next instruction of the batch, the worker always empties its
+         * own deque (other workers only steal from it when idle).
+         **/
+        while(t){
+            computeMdfi(t);
+            _processedTasks.store(_processedTasks.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+            Mdfi* next = fire(t);
+            if(!next){
+                next = getFireable();
+            }
+            t = next;
+        }
+        t = batchNext;
+    }
 }
 
 size_t WorkerMdf::getProcessedTasks() const{
-    return _processedTasks;
+    return _processedTasks.load(std::memory_order_relaxed);
+}
+
+int WorkerMdf::getVirtualCore() const{
+    return _virtualCore.load(std::memory_order_relaxed);
+}
+
+ticks WorkerMdf::getServiceTicks(uint id, size_t& count) const{
+    count = _serviceCount.at(id).load(std::memory_order_relaxed);
+    return _serviceTicks.at(id).load(std::memory_order_relaxed);
 }
 
 
 Interpreter::Interpreter(Parameters* p, Computable* c, InputStream *i, OutputStream *o):
             Interpreter(p, compile(c), i, o){
-    //TODO Set compiledgraph
+    _compiledGraph = _graph;
 }
 
 Interpreter::Interpreter(Parameters* p, Mdfg *graph, InputStream *i, OutputStream *o):
-        _p(p), _compiledGraph(NULL){
+        _p(p), _graph(graph), _compiledGraph(NULL){
     graph->init();
     if(_p->dataflow.maxInterpreters){
         _maxWorkers = _p->dataflow.maxInterpreters;
@@ -511,16 +1154,60 @@ Interpreter::Interpreter(Parameters* p, Mdfg *graph, InputStream *i, OutputStrea
     _q->init(_maxWorkers + 1); /* +1 for the scheduler. */
 
     _p->isolateManager = true;
-    _s = new Scheduler(graph, i, o, _maxWorkers, _q, _workers, &(_p->dataflow));
+    _s = new Scheduler(graph, i, o, _maxWorkers, _q, _workers, &(_p->dataflow),
+                       _p->mammut.getInstanceTopology());
     _farm = new nornir::Farm<Mdfi>(_p);
     _farm->addScheduler(_s);
+    if(_p->dataflow.decentralisedFiring){
+        for(size_t i = 0; i < _maxWorkers; ++i){
+            _deques.push_back(new MdfiDeque());
+        }
+    }
     /**Adds the workers to the farm.**/
     for(size_t i = 0; i < _maxWorkers; ++i){
-        _workers.push_back(new WorkerMdf(_q));
+        _workers.push_back(new WorkerMdf(_q, graph->getNumMdfi(),
+                                         _deques.empty() ? NULL : &_deques,
+                                         _p->dataflow.profileServiceTimes));
         _farm->addWorker(_workers.back());
     }
 }
 
+void Interpreter::start(){
+    _farm->start();
+    if(_p->knobDataflowBatchEnabled){
+        ConfigurationFarm* cf = dynamic_cast<ConfigurationFarm*>(_farm->_manager->_configuration);
+        KnobDataflowBatch* knob = dynamic_cast<KnobDataflowBatch*>(cf->getKnob(KNOB_DATAFLOW_BATCH));
+        knob->setBatchPointer(static_cast<Scheduler*>(_s)->getBatchSizePointer());
+    }
+    if(_p->knobDataflowWindowEnabled){
+        ConfigurationFarm* cf = dynamic_cast<ConfigurationFarm*>(_farm->_manager->_configuration);
+        KnobDataflowWindow* knob = dynamic_cast<KnobDataflowWindow*>(cf->getKnob(KNOB_DATAFLOW_WINDOW));
+        knob->setWindowPointer(static_cast<Scheduler*>(_s)->getWindowPointer());
+    }
+}
+
+std::map<Computable*, double> Interpreter::getServiceTimes() const{
+    std::map<Computable*, double> serviceTimes;
+    for(uint i = 0; i < _graph->getNumMdfi(); i++){
+        double totalTicks = 0;
+        size_t total = 0;
+        for(size_t j = 0; j < _workers.size(); j++){
+            size_t count;
+            totalTicks += _workers[j]->getServiceTicks(i, count);
+            total += count;
+        }
+        if(total){
+            serviceTimes[_graph->getComputable(i)] =
+                    totalTicks / total / _p->archData.ticksPerNs / 1000.0;
+        }
+    }
+    return serviceTimes;
+}
+
+double Interpreter::getQueueImbalance() const{
+    return static_cast<Scheduler*>(_s)->getImbalance();
+}
+
 Interpreter::~Interpreter(){
      if(_compiledGraph){
          delete _compiledGraph;
@@ -530,6 +1217,9 @@ Interpreter::~Interpreter(){
      for(size_t i = 0; i < _workers.size(); i++){
          delete _workers.at(i);
      }
+     for(size_t i = 0; i < _deques.size(); i++){
+         delete _deques.at(i);
+     }
 }
 
 }
@@ -42,7 +42,7 @@ Mdfg::Mdfg(Computable* c):_nextId(1), _id(0), _firstId(std::numeric_limits<ulong
 
 Mdfg::Mdfg(const Mdfg& g, ulong gid):_nextId(g._nextId),_id(gid),
         _firstId(g._firstId),
-        _lastId(g._lastId), _init(false){
+        _lastId(g._lastId), _init(false), _fused(g._fused){
     _instructions.reserve(g._instructions.size());
     for(size_t i = 0; i < g._instructions.size(); i++){
         _instructions.emplace_back(g._instructions[i]);
@@ -61,6 +61,193 @@ void Mdfg::reset(ulong newId){
     }
 }
 
+FusedComputable::FusedComputable(Computable* first, Computable* second){
+    FusedComputable* f = dynamic_cast<FusedComputable*>(first);
+    if(f){
+        _stages = f->_stages;
+    }else{
+        _stages.push_back(first);
+    }
+    f = dynamic_cast<FusedComputable*>(second);
+    if(f){
+        _stages.insert(_stages.end(), f->_stages.begin(), f->_stages.end());
+    }else{
+        _stages.push_back(second);
+    }
+}
+
+void FusedComputable::compute(Data* d){
+    void* input = NULL;
+    void* output = NULL;
+    size_t last = _stages.size() - 1;
+    for(size_t i = 0; i <= last; i++){
+        Data stage;
+        if(i == 0){
+            for(uint j = 0; j < d->_numInputs; j++){
+                stage.addSource(d->_inputs[j], d->_sourceKeys[j]);
+            }
+        }else{
+            stage.setSource(input, _stages[i - 1]);
+        }
+        if(i == last){
+            for(uint j = 0; j < d->_numOutputs; j++){
+                stage.addDestination(d->_outputs[j], d->_destinationKeys[j]);
+            }
+        }else{
+            stage.setDestination(&output, _stages[i + 1]);
+        }
+        _stages[i]->compute(&stage);
+        input = output;
+    }
+}
+
+uint Mdfg::fuse(const std::map<Computable*, double>& serviceTimes,
+                double maxServiceTime){
+    if(!_init){
+        throw std::runtime_error("init() must be called before fusing the graph.");
+    }
+    size_t n = _instructions.size();
+    /**Service time of each instruction, negative if not known.**/
+    std::vector<double> times(n, -1);
+    std::vector<bool> removed(n, false);
+    /**Instruction in which each instruction has been fused.**/
+    std::vector<size_t> owner(n);
+    for(size_t i = 0; i < n; i++){
+        std::map<Computable*, double>::const_iterator it =
+                serviceTimes.find(_instructions[i].getComputable());
+        if(it != serviceTimes.end()){
+            times[i] = it->second;
+        }
+        owner[i] = i;
+    }
+
+    uint numRemoved = 0;
+    for(size_t i = 0; i < n; i++){
+        while(!removed[i] && _instructions[i].getOutputSize() == 1){
+            Mdfi& a = _instructions[i];
+            TokenId dest = a.getOutToken(0)->getDest();
+            if(dest.isOutStream()){
+                break;
+            }
+            size_t j = dest.getMdfId();
+            Mdfi& b = _instructions[j];
+            if(b.getInputSize() != 1 || j == _firstId ||
+               times[i] < 0 || times[j] < 0 ||
+               times[i] + times[j] > maxServiceTime){
+                break;
+            }
+            /**
+             * The last stage of a must be the computable from which
+             * b expects its input.
+             **/
+            Computable* aLast = a.getComputable();
+            FusedComputable* fa = dynamic_cast<FusedComputable*>(aLast);
+            if(fa){
+                aLast = fa->getStages().back();
+            }
+            if(b.getSource(0) != aLast){
+                break;
+            }
+            std::shared_ptr<FusedComputable> f(new FusedComputable(a.getComputable(),
+                                                                   b.getComputable()));
+            _fused.push_back(f);
+            a.fuse(b, f.get());
+            times[i] += times[j];
+            removed[j] = true;
+            owner[j] = i;
+            ++numRemoved;
+        }
+    }
+    if(!numRemoved){
+        return 0;
+    }
+
+    /**Compacts the instructions and updates their ids.**/
+    int* newIds = new int[n];
+    std::vector<Mdfi> instructions;
+    instructions.reserve(n - numRemoved);
+    for(size_t i = 0; i < n; i++){
+        if(!removed[i]){
+            newIds[i] = instructions.size();
+            instructions.emplace_back(_instructions[i]);
+        }
+    }
+    for(size_t i = 0; i < instructions.size(); i++){
+        instructions[i].setId(i);
+        instructions[i].updateDestinations(newIds);
+    }
+    size_t last = _lastId;
+    while(owner[last] != last){
+        last = owner[last];
+    }
+    _firstId = newIds[_firstId];
+    _lastId = newIds[last];
+    _nextId = instructions.size();
+    _instructions.swap(instructions);
+    delete[] newIds;
+    return numRemoved;
+}
+
+void Mdfg::printStats(std::ostream& out,
+                      const std::map<Computable*, double>* serviceTimes){
+    out << "Instructions: " << _instructions.size() << std::endl;
+    for(size_t i = 0; i < _instructions.size(); i++){
+        Mdfi& ins = _instructions[i];
+        FusedComputable* f = dynamic_cast<FusedComputable*>(ins.getComputable());
+        out << "Instruction " << i << ": ";
+        out << "Stages: " << (f ? f->getStages().size() : 1) << " ";
+        out << "Inputs: " << ins.getInputSize() << " ";
+        out << "Destinations:";
+        for(uint j = 0; j < ins.getOutputSize(); j++){
+            TokenId dest = ins.getOutToken(j)->getDest();
+            if(dest.isOutStream()){
+                out << " out";
+            }else{
+                out << " " << dest.getMdfId();
+            }
+        }
+        if(serviceTimes){
+            std::map<Computable*, double>::const_iterator it =
+                    serviceTimes->find(ins.getComputable());
+            if(it != serviceTimes->end()){
+                out << " Service time: " << it->second;
+            }
+        }
+        out << std::endl;
+    }
+}
+
+MdfgInstances::MdfgInstances(const Mdfg& g, size_t numSlots):
+        _numMdfi(g._instructions.size()){
+    _instructions.reserve(numSlots * _numMdfi);
+    _freeSlots.reserve(numSlots);
+    for(size_t i = 0; i < numSlots; i++){
+        for(size_t j = 0; j < _numMdfi; j++){
+            _instructions.emplace_back(g._instructions[j]);
+        }
+        // Lowest slots are acquired first.
+        _freeSlots.push_back(numSlots - 1 - i);
+    }
+    for(size_t i = 0; i < numSlots; i++){
+        for(size_t j = 0; j < _numMdfi; j++){
+            getMdfi(i, j)->setInstance(getMdfi(i, 0));
+        }
+    }
+}
+
+size_t MdfgInstances::acquire(ulong graphId){
+    if(_freeSlots.empty()){
+        throw std::runtime_error("No free graph instances.");
+    }
+    size_t slot = _freeSlots.back();
+    _freeSlots.pop_back();
+    Mdfi* instructions = getMdfi(slot, 0);
+    for(size_t i = 0; i < _numMdfi; i++){
+        instructions[i].reset(graphId);
+    }
+    return slot;
+}
+
 }
 }
 
@@ -32,26 +32,32 @@ namespace dataflow{
 
 void Mdfi::compute(){
     Data d;
-    auto sm = sourcesMap.begin();
-    while(sm != sourcesMap.end()){
-        d.setSource(tInput[sm->second].task, sm->first);
-        sm++;
+    for(uint i = 0; i < dInput; i++){
+        d.addSource(tInput[i].task, sources[i]);
     }
 
-    auto dm = destinationsMap.begin();
-    while(dm != destinationsMap.end()){
-        d.setDestination(&(tOutput[dm->second].result), dm->first);
-        dm++;
+    for(uint i = 0; i < dOutput; i++){
+        d.addDestination(&(tOutput[i].result), destinations[i]);
     }
 
     comp->compute(&d);
 }
 
+void Mdfi::updateDestinations(int* v){
+    for(uint i = 0; i < dOutput; i++){
+        if(!tOutput[i].dest.isOutStream()){
+            tOutput[i].dest.mdfiId = v[tOutput[i].dest.mdfiId];
+        }
+    }
+}
+
 void Mdfi::reset(ulong newId){
     setGid(newId);
     for(uint i = 0; i < dInput; i++){
         tInput[i].clear();
     }
+    missing.store(dInput, std::memory_order_relaxed);
+    batchNext = NULL;
 
     for(uint i = 0; i < dOutput; i++){
         TokenId ti = tOutput[i].getDest();
@@ -26,6 +26,7 @@
  */
 
 #include <nornir/dataflow/stream.hpp>
+#include <nornir/trace.hpp>
 
 #include <mammut/mammut.hpp>
 
@@ -209,5 +210,22 @@ bool InputStreamRate::hasNext(){
     return _currentInterval < _rates.size();
 }
 
+InputStreamTrace::InputStreamTrace(TraceReplayer& replayer):
+        _replayer(replayer){
+    ;
+}
+
+void* InputStreamTrace::next(){
+    size_t id;
+    if(_replayer.poll(id)){
+        return createObject(id);
+    }
+    return NULL;
+}
+
+bool InputStreamTrace::hasNext(){
+    return _replayer.hasNext();
+}
+
 }
 }
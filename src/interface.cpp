@@ -27,6 +27,88 @@
 
 #include <nornir/interface.hpp>
 
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 namespace nornir {
 ParallelForRange terminationRange;
+
+static inline void futexWait(std::atomic<uint32_t>* addr, uint32_t value) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE,
+          value, NULL, NULL, 0);
+}
+
+static inline void futexWakeAll(std::atomic<uint32_t>* addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE,
+          INT_MAX, NULL, NULL, 0);
+}
+
+ParallelForBarrier::ParallelForBarrier(ticks spinTicks)
+    : _pending(0), _generation(0), _completed(0), _sleeping(false),
+      _parked(0), _spinTicks(spinTicks) {
+  ;
+}
+
+void ParallelForBarrier::open(long long int iterations) {
+  _pending.store(iterations);
+  _generation.store(_generation.load() + 1);
+  if (_parked.load()) {
+    futexWakeAll(&_generation);
+  }
+}
+
+void ParallelForBarrier::arrive(long long int iterations) {
+  if (_pending.fetch_sub(iterations) == iterations) {
+    // Last iterations of this generation.
+    _completed.store(_generation.load());
+    if (_sleeping.load()) {
+      futexWakeAll(&_completed);
+    }
+  }
+}
+
+void ParallelForBarrier::wait() {
+  uint32_t generation = _generation.load();
+  ticks start = getticks();
+  while (_completed.load(std::memory_order_acquire) != generation) {
+    if (getticks() - start > _spinTicks) {
+      // Setting _sleeping before reading _completed again ensures that
+      // either we see the new generation or the worker sees us sleeping.
+      _sleeping.store(true);
+      uint32_t completed;
+      while ((completed = _completed.load()) != generation) {
+        futexWait(&_completed, completed);
+      }
+      _sleeping.store(false);
+      return;
+    }
+  }
+}
+
+void ParallelForBarrier::park(ff::FFBUFFER* queue) {
+  uint32_t generation = _generation.load();
+  if (_completed.load() != generation) {
+    // A loop is running (or the barrier is closed).
+    return;
+  }
+  // Incrementing _parked before checking the queue and sleeping ensures
+  // that either we see the new generation or open() sees us parked.
+  _parked.fetch_add(1);
+  if (queue->empty()) {
+    futexWait(&_generation, generation);
+  }
+  _parked.fetch_sub(1);
+}
+
+void ParallelForBarrier::close() {
+  // This generation is never completed, so workers don't park anymore.
+  _generation.store(_generation.load() + 1);
+  futexWakeAll(&_generation);
+}
+
+ticks ParallelForBarrier::getSpinTicks() const {
+  return _spinTicks;
+}
 }
\ No newline at end of file
@@ -84,6 +84,12 @@ std::string knobTypeToString(KnobType kv) {
   case KNOB_PFOR_CHUNK: {
     return "FarmGrain";
   } break;
+  case KNOB_DATAFLOW_BATCH: {
+    return "DataflowBatch";
+  } break;
+  case KNOB_DATAFLOW_WINDOW: {
+    return "DataflowWindow";
+  } break;
   default: { return "Unknown"; } break;
   }
 }
@@ -293,7 +299,7 @@ KnobVirtualCoresFarm::KnobVirtualCoresFarm(
     ff::ff_gatherer *gt, const std::vector<AdaptiveNode *> &workers,
     const volatile bool *terminated)
     : KnobVirtualCores(p), _emitter(emitter), _collector(collector), _gt(gt),
-      _allWorkers(workers), _terminated(terminated) {
+      _allWorkers(workers), _terminated(terminated), _lastStallTime(0) {
   _realValue = _allWorkers.size();
   _knobValues.clear();
   for (size_t i = 0; i < _allWorkers.size(); i++) {
@@ -303,6 +309,17 @@ KnobVirtualCoresFarm::KnobVirtualCoresFarm(
   }
 
   _activeWorkers = _allWorkers;
+  _throttlingWord = _allWorkers.size();
+  // Without an emitter nobody can stop sending tasks to the removed
+  // workers, the farm is frozen instead.
+  _throttling =
+      p.useConcurrencyThrottling && p.drainFreeThrottling && _emitter;
+  if (_throttling) {
+    _emitter->setThrottling(&_throttlingWord);
+    for (size_t i = 0; i < _allWorkers.size(); i++) {
+      _allWorkers[i]->setThrottling(&_throttlingWord, i);
+    }
+  }
   DEBUG("Knob workers created.");
 }
 
@@ -311,8 +328,14 @@ void KnobVirtualCoresFarm::changeValue(double v) {
 #error                                                                         \
     "If you want to use concurrency throttling, you need to DO NOT define the FastFlow's BLOCKING_MODE macro."
 #endif
+  _lastStallTime = 0;
   if (_p.useConcurrencyThrottling && v != _realValue) {
     DEBUG("[Workers] Changing real value to: " << v);
+    if (_throttling) {
+      throttle(v);
+      return;
+    }
+    ticks start = getticks();
     freeze();
 
     if (!*_terminated) {
@@ -323,7 +346,35 @@ void KnobVirtualCoresFarm::changeValue(double v) {
       run(v);
       DEBUG("[Workers] Active Workers: " << _activeWorkers);
     }
+    _lastStallTime =
+        ticksToMilliseconds(getticks() - start, _p.archData.ticksPerNs);
+  }
+}
+
+double KnobVirtualCoresFarm::getLastStallTime() const {
+  return _lastStallTime;
+}
+
+bool KnobVirtualCoresFarm::isThrottling() const {
+  return _throttling;
+}
+
+void KnobVirtualCoresFarm::throttle(uint numWorkers) {
+  DEBUG("[Workers] Throttling the farm.");
+  _emitter->throttleAll(numWorkers);
+  // The farm keeps running, we only wait for the emitter to pick up
+  // the request.
+  while (_throttlingWord.load(std::memory_order_acquire) != numWorkers) {
+    if (*_terminated) {
+      return;
+    }
   }
+  _activeWorkers = vector<AdaptiveNode *>(_allWorkers.begin(),
+                                          _allWorkers.begin() + numWorkers);
+  // The emitter only stopped dispatching while applying the change.
+  _lastStallTime =
+      ticksToMilliseconds(_emitter->_throttlingTicks, _p.archData.ticksPerNs);
+  DEBUG("[Workers] Active Workers: " << _activeWorkers);
 }
 
 std::vector<double> KnobVirtualCoresFarm::getAllowedValues() const {
@@ -442,6 +493,15 @@ void KnobVirtualCoresPipe::changeValue(double v) {
   }
 }
 
+double KnobVirtualCoresPipe::getLastStallTime() const {
+  // Farms are reconfigured one after the other.
+  double stall = 0;
+  for (auto f : _farms) {
+    stall += f->getLastStallTime();
+  }
+  return stall;
+}
+
 std::vector<AdaptiveNode *> KnobVirtualCoresPipe::getActiveWorkers() const {
   std::vector<AdaptiveNode *> r;
   for (auto f : _farms) {
@@ -1001,5 +1061,47 @@ void KnobPforChunk::changeValue(double v){
   *_chunkPointer = v;
 }
 
+KnobDataflowBatch::KnobDataflowBatch(Parameters p):_batchPointer(NULL){
+  // Powers of 2 up to the maximum batch size, which bounds the latency.
+  for(uint v = 1; v < p.dataflow.maxBatchSize; v *= 2){
+    _knobValues.push_back(v);
+  }
+  _knobValues.push_back(p.dataflow.maxBatchSize);
+  _realValue = _knobValues[0];
+}
+
+void KnobDataflowBatch::setBatchPointer(long int* batchPointer){
+  _batchPointer = batchPointer;
+  *_batchPointer = _realValue;
+}
+
+void KnobDataflowBatch::changeValue(double v){
+  // The interpreter may not have set the pointer yet, the value
+  // is applied when it does.
+  if(_batchPointer){
+    *_batchPointer = v;
+  }
+}
+
+KnobDataflowWindow::KnobDataflowWindow(Parameters p):_windowPointer(NULL){
+  // Powers of 2 up to the maximum number of graphs, for which the
+  // interpreter allocates the instances.
+  for(uint v = 1; v < p.dataflow.maxGraphs; v *= 2){
+    _knobValues.push_back(v);
+  }
+  _knobValues.push_back(p.dataflow.maxGraphs);
+  _realValue = _knobValues.back();
+}
+
+void KnobDataflowWindow::setWindowPointer(long int* windowPointer){
+  _windowPointer = windowPointer;
+  *_windowPointer = _realValue;
+}
+
+void KnobDataflowWindow::changeValue(double v){
+  if(_windowPointer){
+    *_windowPointer = v;
+  }
+}
 
 } // namespace nornir
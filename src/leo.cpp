@@ -13,18 +13,14 @@ using namespace std;
 using namespace arma;
 
 #include <cfloat>
+#include <stdexcept>
 
 namespace leo {
 
-#ifndef typedef_emParam_t
-#define typedef_emParam_t
-typedef struct {
-  vec mu;
-  mat C;
-  mat T;
-  double sigma;
-} emParam_t;
-#endif // typedef_emParam_t
+// Iterations of the EM algorithm when starting from scratch and when
+// starting from the previous estimate.
+#define LEO_EM_ITERATIONS 5
+#define LEO_EM_WARM_ITERATIONS 2
 
 #ifndef typedef_emValue_t
 #define typedef_emValue_t
@@ -47,6 +43,19 @@ void init_EMParam(emParam_t *Old, int n) {
   Old->sigma = 1;
 }
 
+/**
+ * Solves A * X = B, with A symmetric positive definite, through the
+ * Cholesky decomposition of A.
+ **/
+mat cholSolve(const mat &A, const mat &B) {
+  mat R;
+  if (!chol(R, A)) {
+    // Not positive definite because of rounding errors.
+    return solve(A, B);
+  }
+  return solve(trimatu(R), solve(trimatl(trans(R)), B));
+}
+
 void EM(emParam_t *Old, mat *W, mat *y_em, int i, int ep, int iteration_limit,
         emReturn_t *Appl) {
 
@@ -56,25 +65,32 @@ void EM(emParam_t *Old, mat *W, mat *y_em, int i, int ep, int iteration_limit,
   double pi = 1;
   double tau = 1;
   // double error = INFINITY;
-  mat I = diagmat(*W);
+  vec w = vectorise(*W);
+  mat eyeN = eye<mat>(n, n);
   double sigma = Old->sigma;
   vec mu = Old->mu;
   mat C = Old->C;
   mat wl = zeros<mat>(n, m);
 
   for (int iterator = 1; iterator <= iteration_limit; iterator++) {
-    mat Cinv = inv(C);
-    mat Cl0 = inv(I / sigma + Cinv);
-    mat Cll = inv(eye<mat>(n, n) / sigma + Cinv);
-
-    wl = (Cll / sigma) * (*y_em) + repmat(Cinv * mu, 1, m);
-    wl.col(0) = Cl0 * ((y_em->col(0)) / sigma + Cinv * mu);
-
-    double normSum =
-        pow(norm(I * (y_em->col(0) - wl.col(0)), 2), 2) + trace(I * Cl0);
+    // The inverses are never computed explicitly. Since C is positive
+    // definite, (I/sigma + inv(C))^-1 = sigma * C * (C + sigma * I)^-1
+    // and, by the Woodbury identity (W is diagonal with 0/1 entries),
+    // (W/sigma + inv(C))^-1 = C - C * W * (sigma * I + W * C * W)^-1 * W * C.
+    vec Cinvmu = cholSolve(C, mu);
+    mat WC = diagmat(w) * C;
+    mat WCW = WC * diagmat(w);
+    mat Cl0 = C - trans(WC) * cholSolve(sigma * eyeN + WCW, WC);
+    mat Cll = sigma * cholSolve(C + sigma * eyeN, C);
+
+    wl = (Cll / sigma) * (*y_em) + repmat(Cinvmu, 1, m);
+    wl.col(0) = Cl0 * ((y_em->col(0)) / sigma + Cinvmu);
+
+    double normSum = pow(norm(w % (y_em->col(0) - wl.col(0)), 2), 2) +
+                     sum(w % diagvec(Cl0));
     vec wlSum = sum(wl, 1);
-    mat ClSum = eye<mat>(n, n) + Cl0 + (m - 1) * Cll;
-    mat wlSumCov = eye<mat>(n, n) + (wl.col(0) - mu) * trans(wl.col(0) - mu);
+    mat ClSum = eyeN + Cl0 + (m - 1) * Cll;
+    mat wlSumCov = eyeN + (wl.col(0) - mu) * trans(wl.col(0) - mu);
     for (int l = 1; l < m; l++) {
       wlSumCov = wlSumCov + (wl.col(l) - mu) * trans(wl.col(l) - mu);
       normSum =
@@ -82,7 +98,7 @@ void EM(emParam_t *Old, mat *W, mat *y_em, int i, int ep, int iteration_limit,
     }
     mu = ((1.0 / (double) (pi + m)) * wlSum);
     C = ((1.0 / (double) (tau + m)) *
-         (pi * (mu * trans(mu)) + tau * eye<mat>(n, n) + ClSum + wlSumCov));
+         (pi * (mu * trans(mu)) + tau * eyeN + ClSum + wlSumCov));
     sigma = (1.0 / (double) ((m - 1) * n + numSamples)) * normSum;
     // error = norm(Old->mu - mu,"fro")+ norm(Old->C - C,"fro") + abs(Old->sigma
     // - sigma);
@@ -150,82 +166,90 @@ vec denormalize(vec *data, mat *origData, double low = 0, double high = 100.0) {
   return copy;
 }
 
-void loadData(uint appId, mat *data, vec *trueData, mat *W,
-              std::string dataFile, const vec *sampledData,
-              bool perColumnNormalization, bool computeError = false) {
-  int n; //, numSamples = 0;
-  mat SupPower, SupPerf;
-
-  // numSamples = 20;
-
-  data->load(dataFile.c_str());
-  n = data->n_rows; // # CONFIGURATIONS
-  *W = zeros<vec>(n);
+Model::Model(uint appId, const std::string &dataFile,
+             bool perColumnNormalization)
+    : _appId(appId), _perColumnNormalization(perColumnNormalization),
+      _warm(false) {
+  if (!_data.load(dataFile.c_str())) {
+    throw std::runtime_error("[Leo] Impossible to load " + dataFile);
+  }
+  if (_appId >= _data.n_cols) {
+    throw std::runtime_error("[Leo] Invalid application id.");
+  }
 
-  for (size_t i = 0; i < sampledData->size(); i++) {
-    if (sampledData->at(i) != 0) {
-      //++numSamples;
-      (*W)(i) = 1;
-    }
+  if (_perColumnNormalization) {
+    mat tmp(_data.col(_appId));
+    _trueData = normalize(&tmp);
+  } else {
+    _trueData = normalize(&_data).col(_appId);
   }
 
-  if (computeError) {
-    if (perColumnNormalization) {
-      mat tmp(data->col(appId));
-      *trueData = normalize(&tmp);
-    } else {
-      *trueData = normalize(data).col(appId);
+  _data.swap_cols(0, _appId);
+  // With per column normalization, only the column of the application
+  // changes between computations.
+  if (_perColumnNormalization) {
+    _normData.set_size(_data.n_rows, _data.n_cols);
+    for (size_t i = 0; i < _data.n_cols; i++) {
+      mat tmp(_data.col(i));
+      _normData.col(i) = normalize(&tmp);
     }
   }
-
-  data->col(appId) = *sampledData;
-  data->swap_cols(0, appId);
 }
 
-PredictionResults compute(uint appId, const std::string &dataFile,
-                          const arma::vec *sampledData,
-                          bool perColumnNormalization, bool computeError) {
-  int n;
-  mat data, normData, y_em, W;
-  vec trueData;
-  emParam_t oldData;
+PredictionResults Model::compute(const arma::vec *sampledData,
+                                 bool computeError) {
+  int n = _data.n_rows; // # CONFIGURATIONS
+  mat W = zeros<vec>(n);
   emReturn_t applData;
 
-  // LOAD DATA AND MISSING VALUES, BS is the name of target application
-  loadData(appId, &data, &trueData, &W, dataFile, sampledData,
-           perColumnNormalization, computeError);
+  for (size_t i = 0; i < sampledData->size(); i++) {
+    if (sampledData->at(i) != 0) {
+      W(i) = 1;
+    }
+  }
+
+  _data.col(0) = *sampledData;
 
   // Normalization
-  if (perColumnNormalization) {
-    for (size_t i = 0; i < data.n_cols; i++) {
-      mat tmp(data.col(i));
-      normData.insert_cols(i, normalize(&tmp));
-    }
+  if (_perColumnNormalization) {
+    mat tmp(_data.col(0));
+    _normData.col(0) = normalize(&tmp);
   } else {
-    normData = normalize(&data);
+    _normData = normalize(&_data);
   }
 
-  n = data.n_rows; // # CONFIGURATIONS
-  // m = data.n_cols;    // # APPLICATIONS
-
-  init_EMParam(&oldData, n);
-  EM(&oldData, &W, &normData, 0, 10000, 5, &applData);
+  int iterations = LEO_EM_WARM_ITERATIONS;
+  if (!_warm) {
+    init_EMParam(&_em, n);
+    iterations = LEO_EM_ITERATIONS;
+    _warm = true;
+  }
+  EM(&_em, &W, &_normData, 0, 10000, iterations, &applData);
 
   PredictionResults pr;
   if (computeError) {
-    pr.accuracy = residualAccuracy(applData.w, trueData);
+    pr.accuracy = residualAccuracy(applData.w, _trueData);
   } else {
     pr.accuracy = -1;
   }
 
-  if (perColumnNormalization) {
-    mat tmp(data.col(0));
+  if (_perColumnNormalization) {
+    mat tmp(_data.col(0));
     pr.predictions = denormalize(&(applData.w), &tmp);
   } else {
-    pr.predictions = denormalize(&(applData.w), &data);
+    pr.predictions = denormalize(&(applData.w), &_data);
   }
   return pr;
 }
+
+void Model::reset() { _warm = false; }
+
+PredictionResults compute(uint appId, const std::string &dataFile,
+                          const arma::vec *sampledData,
+                          bool perColumnNormalization, bool computeError) {
+  Model model(appId, dataFile, perColumnNormalization);
+  return model.compute(sampledData, computeError);
+}
 } // namespace leo
 
 #ifdef TESTMAIN
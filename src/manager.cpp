@@ -42,8 +42,11 @@
 #include <iostream>
 #include <limits>
 #include <stdlib.h>
+#include <poll.h>
 #include <string>
+#include <sys/eventfd.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #undef DEBUG
 #undef DEBUGB
@@ -97,8 +100,15 @@ Manager::Manager(Parameters nornirParameters)
       _variations(new MovingAverageExponential<double>(0.5)), _totalTasks(0),
       _remainingTasks(0), _deadline(0), _lastStoredSampleMs(0),
       _inhibited(false), _configuration(NULL), _selector(NULL), _pid(0),
-      _toSimulate(false) {
+      _toSimulate(false), _wakeupFd(-1), _wakeupArmed(false) {
   DEBUG("Initializing manager.");
+  if (_p.samplingIntervalAdaptive) {
+    _wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_wakeupFd == -1) {
+      throw runtime_error("Manager: impossible to create eventfd.");
+    }
+    _wakeupArmed = true;
+  }
   for (LoggerType lt : _p.loggersTypes) {
     switch (lt) {
     case LOGGER_FILE: {
@@ -163,6 +173,9 @@ Manager::~Manager() {
     _cpufreq->rollback(_cpufreqRollbackPoint);
   }
   _energy->rollback(_energyRollbackPoint);
+  if (_wakeupFd != -1) {
+    close(_wakeupFd);
+  }
 }
 
 void Manager::run() {
@@ -176,9 +189,6 @@ void Manager::run() {
 
   waitForStart();
   lockKnobs();
-  if (_numHMP == 1) {
-    _configuration->createAllRealCombinations();
-  }
   _selector = createSelector();
   for (auto logger : _p.loggers) {
     logger->setStartTimestamp();
@@ -206,6 +216,8 @@ void Manager::run() {
 
   double startSample = getMillisecondsTime();
   uint samplingInterval, steadySamples = 0;
+  double adaptiveInterval = _p.samplingIntervalCalibration;
+  bool wokenUp = false;
 
   while (!_terminated) {
     double overheadMs = getMillisecondsTime() - startSample;
@@ -218,12 +230,13 @@ void Manager::run() {
     } else {
       samplingInterval = _p.samplingIntervalSteady;
     }
-    double microsecsSleep = ((double) samplingInterval - overheadMs) *
-                            (double) MAMMUT_MICROSECS_IN_MILLISEC;
-    if (microsecsSleep < 0) {
-      microsecsSleep = 0;
+    if (_p.samplingIntervalAdaptive) {
+      // samplingInterval is used as upper bound.
+      adaptiveInterval = getAdaptiveSamplingInterval(
+          adaptiveInterval, samplingInterval, overheadMs, wokenUp);
+      wokenUp = waitSamplingInterval(adaptiveInterval - overheadMs);
     } else {
-      usleep(microsecsSleep);
+      waitSamplingInterval(samplingInterval - overheadMs);
     }
 
     startSample = getMillisecondsTime();
@@ -243,7 +256,19 @@ void Manager::run() {
     }
   }
 
+  if (_selector) {
+    _selector->terminate();
+  }
   terminationManagement(); // e.g. to collect final tasks count from riff
+  if (_selector) {
+    try {
+      _selector->saveModel();
+    } catch (const std::runtime_error &e) {
+      // The application already completed, losing the model only
+      // prevents the next run from warm starting.
+      cerr << "[Manager] Warning: model not saved. " << e.what() << endl;
+    }
+  }
   ulong duration = getExecutionTime();
 
   for (auto logger : _p.loggers) {
@@ -341,6 +366,12 @@ void Manager::lockKnobs() const {
         // it for the other Nornir components.
         _configuration->getKnob(c, KNOB_PFOR_CHUNK)->lockToMax();
       }
+      if (!_p.knobDataflowBatchEnabled) {
+        _configuration->getKnob(c, KNOB_DATAFLOW_BATCH)->lockToMax();
+      }
+      if (!_p.knobDataflowWindowEnabled) {
+        _configuration->getKnob(c, KNOB_DATAFLOW_WINDOW)->lockToMax();
+      }
     }
   }
 }
@@ -487,6 +518,78 @@ void Manager::observe() {
   }
 }
 
+bool Manager::waitSamplingInterval(double ms) {
+  if (ms < 0) {
+    ms = 0;
+  }
+  if (_wakeupFd == -1) {
+    if (ms) {
+      usleep(ms * (double) MAMMUT_MICROSECS_IN_MILLISEC);
+    }
+    return false;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = _wakeupFd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  struct timespec timeout;
+  timeout.tv_sec = ms / MSECS_IN_SECS;
+  timeout.tv_nsec = (ms - timeout.tv_sec * MSECS_IN_SECS) * 1000000.0;
+  bool wokenUp = false;
+  if (ppoll(&pfd, 1, &timeout, NULL) > 0 && (pfd.revents & POLLIN)) {
+    uint64_t signals;
+    wokenUp = (read(_wakeupFd, &signals, sizeof(signals)) == sizeof(signals));
+  }
+  // Allows the workers to signal again during the next interval.
+  _wakeupArmed = true;
+  return wokenUp;
+}
+
+double Manager::getAdaptiveSamplingInterval(double current, double max,
+                                            double overheadMs,
+                                            bool wokenUp) const {
+  // The interval must be long enough to keep the time spent
+  // by the manager under maxMonitoringOverhead% of the interval.
+  double min = overheadMs * (100.0 / _p.maxMonitoringOverhead);
+  if (min < _p.samplingIntervalMin) {
+    min = _p.samplingIntervalMin;
+  }
+
+  bool jump = wokenUp;
+  if (!jump && _samples->size() > 1) {
+    double variation = _variations->getLastSample();
+    double avgVariation = _variations->average();
+    if (avgVariation &&
+        variation > avgVariation * SAMPLING_INTERVAL_VARIATION_JUMP) {
+      jump = true;
+    }
+    // When the application is not saturated, the throughput follows
+    // the input bandwidth.
+    double throughput = _samples->getLastSample().throughput;
+    double avgThroughput = _samples->average().throughput;
+    if (avgThroughput &&
+        fabs(throughput - avgThroughput) / avgThroughput * 100.0 >
+            SAMPLING_INTERVAL_THROUGHPUT_JUMP) {
+      jump = true;
+    }
+  }
+
+  double next;
+  if (jump) {
+    next = current * SAMPLING_INTERVAL_SHRINK;
+  } else {
+    next = current * SAMPLING_INTERVAL_GROWTH;
+  }
+  if (next > max) {
+    next = max;
+  }
+  if (next < min) {
+    next = min;
+  }
+  return next;
+}
+
 void Manager::decideAndAct(bool force) {
   if (!_p.requirements.anySpecified()) {
     return;
@@ -585,6 +688,10 @@ ManagerInstrumented::~ManagerInstrumented() {
 
 void ManagerInstrumented::waitForStart() {
   Manager::_pid = _monitor.waitStart();
+  // The model store refers to the application, not to the manager.
+  if (_p.modelStoreName.empty()) {
+    _p.modelStoreName = getExecutableName(_pid);
+  }
   for (size_t c = 0; c < _numHMP; c++) {
     if (_monitor.getTotalThreads()) {
       dynamic_cast<KnobVirtualCores *>(
@@ -693,6 +800,10 @@ ManagerBlackBox::ManagerBlackBox(pid_t pid, Parameters nornirParameters)
           nornirParameters.mammut.getInstanceTask()->getProcessHandler(pid)) {
   Manager::_pid = pid;
   Manager::_configuration = new ConfigurationExternal(_p, _numHMP);
+  // The model store refers to the application, not to the manager.
+  if (_p.modelStoreName.empty()) {
+    _p.modelStoreName = getExecutableName(pid);
+  }
   // For blackbox application we do not care if synchronous of not
   // (we count instructions).
   _p.synchronousWorkers = false;
@@ -813,6 +924,10 @@ void ManagerFastFlow::waitForStart() {
   DEBUG("Init pre run");
   initNodesPreRun(_p, _emitter, _activeWorkers, _collector, &_terminated,
                   _farm->getlb(), _farm->getgt());
+  for (size_t i = 0; i < _activeWorkers.size(); i++) {
+    _activeWorkers[i]->_wakeupFd = _wakeupFd;
+    _activeWorkers[i]->_wakeupArmed = &_wakeupArmed;
+  }
 
   DEBUG("Going to run");
   _farm->run_then_freeze();
@@ -832,14 +947,26 @@ MonitoredSample getSampleResponse(std::vector<AdaptiveNode *> nodes,
                                   double currentLatency = 0) {
   MonitoredSample sample;
   uint numActiveWorkers = nodes.size();
+  std::vector<unsigned long long> latencies;
   for (size_t i = 0; i < numActiveWorkers; i++) {
     MonitoredSample tmp;
     AdaptiveNode *w = nodes.at(i);
     w->getSampleResponse(tmp, currentLatency);
     sample += tmp;
+    if (w->_recordLatencies) {
+      latencies.resize(LATENCY_HISTOGRAM_BUCKETS, 0);
+      w->mergeLatencies(latencies);
+    }
   }
   sample.loadPercentage /= numActiveWorkers;
   sample.latency /= numActiveWorkers;
+  if (latencies.size()) {
+    AdaptiveNode *w = nodes.at(0);
+    sample.tailLatency =
+        LatencyHistogram::getPercentile(
+            latencies, w->_p.requirements.latencyPercentile) /
+        w->_ticksPerNs;
+  }
   return sample;
 }
 
@@ -872,12 +999,14 @@ ManagerFastFlow::~ManagerFastFlow() {
 
 void ManagerFastFlow::postConfigurationManagement() {
   std::vector<AdaptiveNode *> newWorkers;
+  bool throttling = true;
   for (size_t c = 0; c < _numHMP; c++) {
     const KnobVirtualCoresFarm *knobWorkers =
         dynamic_cast<const KnobVirtualCoresFarm *>(
             _configuration->getKnob(c, KNOB_VIRTUAL_CORES));
     auto tmp = knobWorkers->getActiveWorkers();
     newWorkers.insert(newWorkers.end(), tmp.begin(), tmp.end());
+    throttling = throttling && knobWorkers->isThrottling();
   }
   MonitoredSample sample;
 
@@ -889,9 +1018,21 @@ void ManagerFastFlow::postConfigurationManagement() {
      * I do not need to ask since the node put it in the Q when it
      * terminated.
      */
+    std::vector<AdaptiveNode *> stoppedWorkers = _activeWorkers;
+    if (throttling) {
+      // Only the removed workers stopped, after emptying their queue.
+      stoppedWorkers.clear();
+      for (AdaptiveNode *w : _activeWorkers) {
+        if (!contains(newWorkers, w)) {
+          stoppedWorkers.push_back(w);
+        }
+      }
+    }
     DEBUG("Getting spurious..");
-    sample = getSampleResponse(_activeWorkers, _samples->average().latency);
-    updateTasksCount(sample);
+    if (stoppedWorkers.size()) {
+      sample = getSampleResponse(stoppedWorkers, _samples->average().latency);
+      updateTasksCount(sample);
+    }
     DEBUG("Spurious got.");
   }
 
@@ -918,10 +1059,9 @@ ManagerFastFlowPipeline::ManagerFastFlowPipeline(ff_pipeline *pipe,
         "You need to specify a flag for each node in the pipeline.");
   }
   Manager::_pid = getpid();
-  // configuration creation, lockKnobs,
-  // _configuration->createAllRealCombinations(); and _selector =
-  // createSelector(); are delayed in the waitForStart(). We need indeed to run
-  // the pipeline for a while to get the values of the knobPipeline knob.
+  // configuration creation, lockKnobs and _selector = createSelector(); are
+  // delayed in the waitForStart(). We need indeed to run the pipeline for a
+  // while to get the values of the knobPipeline knob.
 }
 
 ManagerFastFlowPipeline::~ManagerFastFlowPipeline() {
@@ -987,6 +1127,10 @@ void ManagerFastFlowPipeline::waitForStart() {
       farms.push_back(realFarm);
       initNodesPreRun(_p, emitter, workers, collector, &_terminated,
                       realFarm->getlb(), realFarm->getgt());
+      for (size_t j = 0; j < workers.size(); j++) {
+        workers[j]->_wakeupFd = _wakeupFd;
+        workers[j]->_wakeupArmed = &_wakeupArmed;
+      }
     }
   }
   _farmsKnobs = farmsKnobs;
@@ -1012,6 +1156,10 @@ void ManagerFastFlowPipeline::waitForStart() {
     k->setRealValue(1);
     // When a change in the number of workers in a farm occurs, their workers
     // push a sample, so we need to retrieve it and discard it
+    if (k->isThrottling()) {
+      // Only the removed workers pushed it.
+      allworkers.erase(allworkers.begin());
+    }
     for (auto an : allworkers) {
       MonitoredSample tmp;
       an->getSampleResponse(tmp, 0);
@@ -1111,7 +1259,6 @@ void ManagerFastFlowPipeline::waitForStart() {
     }
   }
   lockKnobs();
-  _configuration->createAllRealCombinations();
   _selector = createSelector();
 }
 
@@ -1189,6 +1336,14 @@ void ManagerFastFlowPipeline::postConfigurationManagement() {
          */
         std::vector<AdaptiveNode *> stoppedWorkers = _allWorkers[i];
         stoppedWorkers.resize(oldAllocation[i]);
+        if (_farmsKnobs[i]->isThrottling()) {
+          // Only the removed workers stopped, after emptying their queue.
+          if (newAllocation[i] > oldAllocation[i]) {
+            continue;
+          }
+          stoppedWorkers.erase(stoppedWorkers.begin(),
+                               stoppedWorkers.begin() + newAllocation[i]);
+        }
         DEBUG("[Manager Pipeline] Getting spurious..");
         sample = getSampleResponse(stoppedWorkers, _samples->average().latency);
         updateTasksCount(sample);
@@ -0,0 +1,255 @@
+/*
+ * modelstore.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/*!
+ * \file modelstore.cpp
+ * \brief On-disk store of what the predictive selectors learnt about
+ *        an application.
+ **/
+
+#include <nornir/modelstore.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace nornir {
+
+using namespace std;
+
+#define MODELSTORE_NUM_REQUIREMENTS 9
+
+static void getRequirements(const Requirements &r, double *values) {
+  values[0] = r.throughput;
+  values[1] = r.powerConsumption;
+  values[2] = r.minUtilization;
+  values[3] = r.maxUtilization;
+  values[4] = r.executionTime;
+  values[5] = r.latency;
+  values[6] = r.latencyPercentile;
+  values[7] = r.energy;
+  values[8] = r.expectedTasksNumber;
+}
+
+static void setRequirements(const double *values, Requirements &r) {
+  r.throughput = values[0];
+  r.powerConsumption = values[1];
+  r.minUtilization = values[2];
+  r.maxUtilization = values[3];
+  r.executionTime = values[4];
+  r.latency = values[5];
+  r.latencyPercentile = values[6];
+  r.energy = values[7];
+  r.expectedTasksNumber = values[8];
+}
+
+static bool sameRequirements(const Requirements &a, const Requirements &b) {
+  double va[MODELSTORE_NUM_REQUIREMENTS], vb[MODELSTORE_NUM_REQUIREMENTS];
+  getRequirements(a, va);
+  getRequirements(b, vb);
+  for (size_t i = 0; i < MODELSTORE_NUM_REQUIREMENTS; i++) {
+    if (va[i] != vb[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static string getArchDataString(const ArchData &archData) {
+  stringstream ss;
+  ss << setprecision(numeric_limits<double>::max_digits10)
+     << archData.ticksPerNs << " " << archData.idlePower << " "
+     << archData.monitoringCost;
+  return ss.str();
+}
+
+// FNV-1a, to get the same name on different builds.
+static uint64_t getHash(const string &s) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < s.size(); i++) {
+    hash ^= (unsigned char)s[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+string getExecutableName(pid_t pid) {
+  char path[4096];
+  string link = "/proc/" + to_string(pid) + "/exe";
+  ssize_t len = readlink(link.c_str(), path, sizeof(path) - 1);
+  if (len <= 0) {
+    return "";
+  }
+  path[len] = '\0';
+  string name(path);
+  size_t pos = name.find_last_of('/');
+  if (pos != string::npos) {
+    name = name.substr(pos + 1);
+  }
+  return name;
+}
+
+ModelStore::ModelStore(const Parameters &p)
+    : _archData(p.archData), _requirements(p.requirements) {
+  string name = p.modelStoreName;
+  if (name.empty()) {
+    name = getExecutableName(getpid());
+  }
+  stringstream ss;
+  ss << p.modelStorePath << "/" << name << "." << hex
+     << getHash(getArchDataString(_archData)) << ".model";
+  _fileName = ss.str();
+}
+
+const string &ModelStore::getFileName() const {
+  return _fileName;
+}
+
+bool ModelStore::load() {
+  ifstream file(_fileName);
+  if (!file.is_open()) {
+    return false;
+  }
+  _observations.clear();
+  _configurations.clear();
+  string line;
+  bool archDataFound = false;
+  while (getline(file, line)) {
+    stringstream ss(line);
+    string tag;
+    ss >> tag;
+    if (tag == "archData") {
+      string archData;
+      getline(ss >> ws, archData);
+      if (archData != getArchDataString(_archData)) {
+        return false;
+      }
+      archDataFound = true;
+    } else if (tag == "observation") {
+      StoredObservation o;
+      o.values = KnobsValues(KNOB_VALUE_REAL);
+      ss >> o.values >> o.sample;
+      if (!ss.fail()) {
+        _observations.push_back(o);
+      }
+    } else if (tag == "configuration") {
+      double r[MODELSTORE_NUM_REQUIREMENTS];
+      for (size_t i = 0; i < MODELSTORE_NUM_REQUIREMENTS; i++) {
+        ss >> r[i];
+      }
+      KnobsValues values(KNOB_VALUE_REAL);
+      ss >> values;
+      if (!ss.fail()) {
+        Requirements requirements;
+        setRequirements(r, requirements);
+        _configurations.push_back(make_pair(requirements, values));
+      }
+    }
+  }
+  if (!archDataFound) {
+    _observations.clear();
+    _configurations.clear();
+  }
+  return archDataFound;
+}
+
+void ModelStore::save() const {
+  // Written on a temporary file and then renamed, so that concurrent
+  // executions of the application never read a partial store.
+  string tmpName = _fileName + "." + to_string(getpid()) + ".tmp";
+  ofstream file(tmpName);
+  if (!file.is_open()) {
+    throw runtime_error("Impossible to create model store file " + tmpName);
+  }
+  file << setprecision(numeric_limits<double>::max_digits10);
+  file << "archData " << getArchDataString(_archData) << endl;
+  for (const StoredObservation &o : _observations) {
+    file << "observation " << o.values << " " << o.sample << endl;
+  }
+  for (const auto &c : _configurations) {
+    double r[MODELSTORE_NUM_REQUIREMENTS];
+    getRequirements(c.first, r);
+    file << "configuration";
+    for (size_t i = 0; i < MODELSTORE_NUM_REQUIREMENTS; i++) {
+      file << " " << r[i];
+    }
+    file << " " << c.second << endl;
+  }
+  file.close();
+  if (rename(tmpName.c_str(), _fileName.c_str())) {
+    remove(tmpName.c_str());
+    throw runtime_error("Impossible to write model store file " + _fileName);
+  }
+}
+
+void ModelStore::addObservation(const KnobsValues &values,
+                                const MonitoredSample &sample) {
+  for (StoredObservation &o : _observations) {
+    if (o.values == values) {
+      o.sample = sample;
+      return;
+    }
+  }
+  StoredObservation o;
+  o.values = values;
+  o.sample = sample;
+  _observations.push_back(o);
+}
+
+const vector<StoredObservation> &ModelStore::getObservations() const {
+  return _observations;
+}
+
+void ModelStore::clearObservations() {
+  _observations.clear();
+}
+
+bool ModelStore::getConfiguration(KnobsValues &values) const {
+  for (const auto &c : _configurations) {
+    if (sameRequirements(c.first, _requirements)) {
+      values = c.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ModelStore::setConfiguration(const KnobsValues &values) {
+  for (auto &c : _configurations) {
+    if (sameRequirements(c.first, _requirements)) {
+      c.second = values;
+      return;
+    }
+  }
+  _configurations.push_back(make_pair(_requirements, values));
+}
+
+} // namespace nornir
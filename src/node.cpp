@@ -30,10 +30,14 @@
 
 #include <mammut/mammut.hpp>
 
+#include <climits>
 #include <fstream>
+#include <linux/futex.h>
 #include <streambuf>
 #include <string>
+#include <sys/syscall.h>
 #include <time.h>
+#include <unistd.h>
 
 #undef DEBUG
 #undef DEBUGB
@@ -74,6 +78,16 @@ static inline void nSleep(long ns) {
 #endif
 }
 
+static inline void futexWait(std::atomic<uint32_t> *addr, uint32_t value) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT_PRIVATE,
+          value, NULL, NULL, 0);
+}
+
+static inline void futexWakeAll(std::atomic<uint32_t> *addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE_PRIVATE,
+          INT_MAX, NULL, NULL, 0);
+}
+
 void AdaptiveNode::initPreRun(const Parameters p, NodeType nodeType,
                               volatile bool *terminated,
                               ff::ff_thread *ffThread) {
@@ -84,10 +98,17 @@ void AdaptiveNode::initPreRun(const Parameters p, NodeType nodeType,
                         "get the tasks manager.");
   }
   _ticksPerNs = _p.archData.ticksPerNs;
+  _seqlockSampling = _p.seqlockSampling;
   _nodeType = nodeType;
   _terminated = terminated;
   _ffThread = ffThread;
   _topology = _p.mammut.getInstanceTopology();
+  _recordLatencies =
+      _nodeType == NODE_TYPE_WORKER &&
+      _p.requirements.latencyPercentile != NORNIR_REQUIREMENT_UNDEF;
+  if (_seqlockSampling) {
+    publishSample();
+  }
 }
 
 void AdaptiveNode::initPostRun() {
@@ -119,40 +140,63 @@ void AdaptiveNode::move(const vector<VirtualCoreId> &virtualCores) {
   }
 }
 
+void AdaptiveNode::poll(double avgLatency) {
+  switch (_p.strategyPolling) {
+  case STRATEGY_POLLING_SPINNING: {
+    ;
+  } break;
+  case STRATEGY_POLLING_PAUSE: {
+    PAUSE();
+  } break;
+  case STRATEGY_POLLING_SLEEP_SMALL: {
+    nSleep(0);
+  } break;
+  case STRATEGY_POLLING_SLEEP_LATENCY: {
+    nSleep(avgLatency);
+  } break;
+  }
+}
+
 void AdaptiveNode::getSampleResponse(MonitoredSample &sample,
                                      double avgLatency) {
+  if (_seqlockSampling) {
+    readSample(sample, avgLatency);
+    return;
+  }
   while (_responseQ.empty()) {
     if (*_terminated) {
       return;
     }
-    switch (_p.strategyPolling) {
-    case STRATEGY_POLLING_SPINNING: {
-      continue;
-    } break;
-    case STRATEGY_POLLING_PAUSE: {
-      PAUSE();
-    } break;
-    case STRATEGY_POLLING_SLEEP_SMALL: {
-      nSleep(0);
-    } break;
-    case STRATEGY_POLLING_SLEEP_LATENCY: {
-      nSleep(avgLatency);
-    } break;
-    }
+    poll(avgLatency);
   }
   _responseQ.inc();
   sample = _sampleResponse;
 }
 
 void AdaptiveNode::resetSample() {
+  _latencyHistogram.getCounts(_latencyBase);
+  if (_seqlockSampling) {
+    // Next sample will start from the counters published when the node
+    // sees the request.
+    _resetEpoch = notifyManagementRequest();
+    _resetPending = true;
+    DEBUG("RESETSAMPLE");
+    return;
+  }
   ManagementRequest *request = &_managementRequests[MGMT_REQ_RESET_SAMPLE];
   request->type = MGMT_REQ_RESET_SAMPLE;
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("RESETSAMPLE");
 }
 
 void AdaptiveNode::askForSample() {
+  if (_seqlockSampling) {
+    // The node publishes its counters when it sees the request.
+    _requestedEpoch = notifyManagementRequest();
+    return;
+  }
   ManagementRequest *request =
       &_managementRequests[MGMT_REQ_GET_AND_RESET_SAMPLE];
   request->type = MGMT_REQ_GET_AND_RESET_SAMPLE;
@@ -160,9 +204,14 @@ void AdaptiveNode::askForSample() {
   // it could be anything except NULL.
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("ASKFORSAMPLE");
 }
 
+unsigned long AdaptiveNode::notifyManagementRequest() {
+  return _managementSeq.fetch_add(1, std::memory_order_release) + 1;
+}
+
 void AdaptiveNode::setQBlocking() {
   ManagementRequest *request = &_managementRequests[MGMT_REQ_SWITCH_BLOCKING];
   request->type = MGMT_REQ_SWITCH_BLOCKING;
@@ -171,6 +220,7 @@ void AdaptiveNode::setQBlocking() {
   // anything except NULL.
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("Queues switched to blocking.");
 }
 
@@ -182,6 +232,7 @@ void AdaptiveNode::setQNonblocking() {
   // anything except NULL.
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("Queues switched to nonblocking.");
 }
 
@@ -194,6 +245,7 @@ void AdaptiveNode::freezeAll(void *mark) {
   DEBUG("FREEZEALLBEF");
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("FREEZEALLAFT");
   if (_nodeType == NODE_TYPE_EMITTER) {
     DEBUG("Pushed freeze req");
@@ -209,9 +261,58 @@ void AdaptiveNode::thawAll(size_t numWorkers) {
   DEBUG("THAWALLBEF");
   while (!_managementQ.push(request))
     ;
+  notifyManagementRequest();
   DEBUG("THAWALLAFT");
 }
 
+void AdaptiveNode::setThrottling(std::atomic<uint32_t> *word, uint32_t id) {
+  _throttlingWord = word;
+  _throttlingId = id;
+}
+
+void AdaptiveNode::throttleAll(size_t numWorkers) {
+  ManagementRequest *request = &_managementRequests[MGMT_REQ_THROTTLE];
+  request->type = MGMT_REQ_THROTTLE;
+  request->numWorkers = numWorkers;
+  while (!_managementQ.push(request))
+    ;
+  notifyManagementRequest();
+  DEBUG("Throttling request pushed.");
+}
+
+void AdaptiveNode::applyThrottling(size_t numWorkers, bool notify) {
+  ticks start = getticks();
+  ff_loadbalancer *lb = static_cast<ff_loadbalancer *>(_ffThread);
+  size_t oldNumWorkers = _throttlingWord->load(std::memory_order_relaxed);
+  lb->setnworkers(numWorkers);
+  if (notify) {
+    notifyRethreading(oldNumWorkers, numWorkers);
+  }
+  _throttlingTicks = getticks() - start;
+  // Tasks sent so far are visible to the workers reading the new value.
+  _throttlingWord->store(numWorkers, std::memory_order_release);
+  if (numWorkers > oldNumWorkers) {
+    futexWakeAll(_throttlingWord);
+  }
+}
+
+void AdaptiveNode::parkThrottled(uint32_t active) {
+  DEBUG("Worker " << _throttlingId << " parked.");
+  // Same accounting done in svc_end when the farm is frozen, the
+  // manager gets the last tasks processed by the worker.
+  if (_seqlockSampling) {
+    publishSample();
+  } else {
+    storeSample();
+  }
+  while (_throttlingId >= active) {
+    futexWait(_throttlingWord, active);
+    active = _throttlingWord->load(std::memory_order_acquire);
+  }
+  reset();
+  DEBUG("Worker " << _throttlingId << " unparked.");
+}
+
 void AdaptiveNode::prepareToFreeze() {
   _goingToFreeze = true;
 }
@@ -221,11 +322,145 @@ void AdaptiveNode::prepareToRun() {
 }
 
 void AdaptiveNode::reset() {
+  if (_seqlockSampling) {
+    _resetWork += tickstot;
+    _resetTasks += taskcnt + _additionalTasks;
+    _additionalTasks = 0;
+  }
   tickstot = 0;
+  _lastTickstot = 0;
   taskcnt = 0;
   _numTasks = 0;
   _ticksWork = 0;
   _startTicks = getticks();
+  if (_seqlockSampling) {
+    publishSample();
+  }
+}
+
+void AdaptiveNode::publishSample() {
+  unsigned long seq = _sampleSeq.load(std::memory_order_relaxed);
+  _sampleSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _publishedResetTicks.store(_startTicks, std::memory_order_relaxed);
+  _publishedResetWork.store(_resetWork, std::memory_order_relaxed);
+  _publishedResetTasks.store(_resetTasks, std::memory_order_relaxed);
+  _publishedWork.store(_resetWork + tickstot, std::memory_order_relaxed);
+  _publishedTasks.store(_resetTasks + taskcnt + _additionalTasks,
+                        std::memory_order_relaxed);
+  _publishedTicks.store(getticks(), std::memory_order_relaxed);
+  _publishedEpoch.store(_managementSeqSeen, std::memory_order_relaxed);
+  _sampleSeq.store(seq + 2, std::memory_order_release);
+}
+
+void AdaptiveNode::readSample(MonitoredSample &sample, double avgLatency) {
+  ticks resetTicks, resetWork, work, now;
+  unsigned long long resetTasks, tasks;
+  unsigned long seqStart, seqEnd, epoch;
+  while (true) {
+    seqStart = _sampleSeq.load(std::memory_order_acquire);
+    resetTicks = _publishedResetTicks.load(std::memory_order_relaxed);
+    resetWork = _publishedResetWork.load(std::memory_order_relaxed);
+    resetTasks = _publishedResetTasks.load(std::memory_order_relaxed);
+    work = _publishedWork.load(std::memory_order_relaxed);
+    tasks = _publishedTasks.load(std::memory_order_relaxed);
+    now = _publishedTicks.load(std::memory_order_relaxed);
+    epoch = _publishedEpoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    seqEnd = _sampleSeq.load(std::memory_order_relaxed);
+    if (seqStart != seqEnd || (seqStart & 1)) {
+      // Node was publishing.
+      continue;
+    }
+    if (*_terminated) {
+      break;
+    }
+    if (_resetPending) {
+      if (epoch < _resetEpoch) {
+        poll(avgLatency);
+        continue;
+      }
+      _resetPending = false;
+      _baseTicks = now;
+      _baseWork = work;
+      _baseTasks = tasks;
+      if (epoch >= _requestedEpoch) {
+        // Same counters used for the reset, we need newer ones.
+        _requestedEpoch = notifyManagementRequest();
+      }
+      continue;
+    }
+    if (epoch < _requestedEpoch) {
+      // Node didn't see the request yet.
+      poll(avgLatency);
+      continue;
+    }
+    if (tasks - _baseTasks >= _p.minTasksPerSample) {
+      break;
+    }
+    // Not enough tasks, asks for newer counters.
+    _requestedEpoch = notifyManagementRequest();
+    poll(avgLatency);
+  }
+
+  ticks windowStart = _baseTicks;
+  ticks windowWork = work - _baseWork;
+  unsigned long long windowTasks = tasks - _baseTasks;
+  if (_baseTicks < resetTicks) {
+    // The node has been reset (e.g. restarted after a reconfiguration)
+    // after the last read. Tasks executed before the reset are still
+    // counted, but rates are computed starting from the reset.
+    windowStart = resetTicks;
+    windowWork = work - resetWork;
+    windowTasks = tasks - resetTasks;
+  }
+  if (now <= windowStart) {
+    // Nothing published since the last read.
+    sample = MonitoredSample();
+    return;
+  }
+  ticks totalTicks = now - windowStart; // Including idle periods
+
+  sample.loadPercentage =
+      ((double) (windowWork) / (double) totalTicks) * 100.0;
+  sample.numTasks = tasks - _baseTasks;
+  if (windowTasks) {
+    sample.latency =
+        ((double) windowWork / (double) windowTasks) / _ticksPerNs;
+  } else {
+    sample.latency = 0.0;
+  }
+  sample.throughput =
+      (double) windowTasks / ticksToSeconds(totalTicks, _ticksPerNs);
+
+  _baseTicks = now;
+  _baseWork = work;
+  _baseTasks = tasks;
+}
+
+void AdaptiveNode::mergeLatencies(std::vector<unsigned long long> &counts) {
+  std::vector<unsigned long long> current(LATENCY_HISTOGRAM_BUCKETS);
+  _latencyHistogram.getCounts(current);
+  for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    counts[i] += current[i] - _latencyBase[i];
+  }
+  _latencyBase.swap(current);
+}
+
+void AdaptiveNode::checkHighWaterMark() {
+  FFBUFFER *in = get_in_buffer();
+  // With single-slot queues a pending task is not a sign of a burst.
+  if (in && in->buffersize() > 1 &&
+      in->length() * 100.0 >= in->buffersize() * _p.queueHighWaterMark &&
+      _wakeupArmed->load(std::memory_order_relaxed) &&
+      _wakeupArmed->exchange(false)) {
+    DEBUG("Input queue high-water mark reached.");
+    uint64_t signal = 1;
+    if (write(_wakeupFd, &signal, sizeof(signal)) != sizeof(signal)) {
+      // The manager will anyway wake up at the end of the interval.
+      ;
+    }
+  }
 }
 
 void AdaptiveNode::storeSample() {
@@ -261,6 +496,26 @@ void AdaptiveNode::callbackIn(void *p) CX11_KEYWORD(final) {
   ManagementRequest *request;
   DEBUG("callbackIn called.");
 
+  if (_recordLatencies && tickstot != _lastTickstot) {
+    // tickstot is updated by ff_node after each svc call.
+    _latencyHistogram.record(tickstot - _lastTickstot);
+    _lastTickstot = tickstot;
+  }
+
+  if (_wakeupFd != -1) {
+    checkHighWaterMark();
+  }
+
+  if (_seqlockSampling) {
+    unsigned long seq = _managementSeq.load(std::memory_order_acquire);
+    if (seq == _managementSeqSeen) {
+      return;
+    }
+    _managementSeqSeen = seq;
+    // The manager asked for the counters or pushed a request.
+    publishSample();
+  }
+
   while (!_managementQ.empty()) {
     request = (ManagementRequest *) _managementQ.top();
     switch (request->type) {
@@ -274,6 +529,8 @@ void AdaptiveNode::callbackIn(void *p) CX11_KEYWORD(final) {
         _managementQ.inc();
         storeSample();
       } else {
+        // Request not consumed, check again on next call.
+        --_managementSeqSeen;
         return;
       }
     } break;
@@ -285,7 +542,9 @@ void AdaptiveNode::callbackIn(void *p) CX11_KEYWORD(final) {
     case MGMT_REQ_FREEZE: {
       if (_rethreadingDisabled) {
         // This is only possible for the emitter, which is the only one
-        // receiving freeze requests.
+        // receiving freeze requests. Request not consumed, check again
+        // on next call.
+        --_managementSeqSeen;
         return;
       }
       _managementQ.inc();
@@ -316,6 +575,19 @@ void AdaptiveNode::callbackIn(void *p) CX11_KEYWORD(final) {
         lb->thawWorkers(true, request->numWorkers);
       }
     } break;
+    case MGMT_REQ_THROTTLE: {
+      if (_rethreadingDisabled) {
+        // Request not consumed, check again on next call.
+        --_managementSeqSeen;
+        return;
+      }
+      _managementQ.inc();
+      if (!*_terminated) {
+        assert(_nodeType == NODE_TYPE_EMITTER);
+        DEBUG("Throttling request received");
+        applyThrottling(request->numWorkers, true);
+      }
+    } break;
     case MGMT_REQ_SWITCH_BLOCKING: {
       _managementQ.inc();
       assert(_nodeType == NODE_TYPE_EMITTER);
@@ -333,16 +605,42 @@ void AdaptiveNode::callbackOut(void *p) CX11_KEYWORD(final) {
   callbackIn(p);
 }
 
+void AdaptiveNode::losetime_in(unsigned long ticksToWait) CX11_KEYWORD(final) {
+  if (_throttlingWord && _nodeType == NODE_TYPE_WORKER) {
+    uint32_t active = _throttlingWord->load(std::memory_order_acquire);
+    // The queue is checked again after reading the number of workers,
+    // since the emitter may have sent a task before excluding us.
+    if (_throttlingId >= active && get_in_buffer()->empty()) {
+      parkThrottled(active);
+      return;
+    }
+  }
+  if (_nodeType == NODE_TYPE_WORKER && waitTask()) {
+    return;
+  }
+  ff_node::losetime_in(ticksToWait);
+}
+
 void AdaptiveNode::svc_end() CX11_KEYWORD(final) {
   if (_nodeType == NODE_TYPE_WORKER) {
     if (_goingToFreeze) {
-      storeSample();
+      if (_seqlockSampling) {
+        // The manager will read the last tasks from the counters.
+        publishSample();
+      } else {
+        storeSample();
+      }
       _goingToFreeze = false;
     }
   }
 }
 
 void AdaptiveNode::eosnotify(ssize_t id) CX11_KEYWORD(final) {
+  if (_throttlingWord && _nodeType == NODE_TYPE_EMITTER) {
+    // The EOS is only broadcasted to the running workers.
+    applyThrottling(
+        static_cast<ff_loadbalancer *>(_ffThread)->getNWorkers(), false);
+  }
 #if 0
     if(_nodeType == NODE_TYPE_WORKER){
         storeSample();
@@ -359,7 +657,16 @@ AdaptiveNode::AdaptiveNode()
       // the node reads any of them. For example, we could enqueue a
       // SWITCH_BLOCKING, a RESET_SAMPLE and a GET_AND_RESET_SAMPLE.
       // For this reason, the size of the managementQ is greater than 1.
-      _managementQ(4), _responseQ(2) {
+      _managementQ(4), _responseQ(2), _managementSeq(0),
+      _managementSeqSeen(0), _seqlockSampling(false), _sampleSeq(0),
+      _publishedResetTicks(0), _publishedResetWork(0), _publishedWork(0),
+      _publishedResetTasks(0), _publishedTasks(0), _publishedTicks(0),
+      _publishedEpoch(0), _resetWork(0), _resetTasks(0), _baseTicks(0),
+      _baseWork(0), _baseTasks(0), _requestedEpoch(0), _resetEpoch(0),
+      _resetPending(false), _recordLatencies(false), _lastTickstot(0),
+      _latencyBase(LATENCY_HISTOGRAM_BUCKETS, 0), _wakeupFd(-1),
+      _wakeupArmed(NULL), _throttlingWord(NULL), _throttlingId(0),
+      _throttlingTicks(0) {
   _managementQ.init();
   _responseQ.init();
   prepareToRun();
@@ -377,6 +684,11 @@ void AdaptiveNode::terminate() {
   while (!_started) {
     ;
   }
+  if (_throttlingWord && _nodeType == NODE_TYPE_EMITTER) {
+    // The EOS is only broadcasted to the running workers.
+    applyThrottling(
+        static_cast<ff_loadbalancer *>(_ffThread)->getNWorkers(), false);
+  }
   *_terminated = true;
 }
 
@@ -385,6 +697,10 @@ void AdaptiveNode::notifyRethreading(size_t oldNumWorkers,
   ;
 }
 
+bool AdaptiveNode::waitTask() {
+  return false;
+}
+
 void AdaptiveNode::disableRethreading() {
   if (_nodeType != NODE_TYPE_EMITTER) {
     throw std::runtime_error(
@@ -401,6 +717,14 @@ void AdaptiveNode::enableRethreading() {
   _rethreadingDisabled = false;
 }
 
+void AdaptiveNode::checkManagementRequests() {
+  if (_nodeType != NODE_TYPE_EMITTER) {
+    throw std::runtime_error(
+        "checkManagementRequests can only be called on the emitter.");
+  }
+  callbackIn(static_cast<ff_loadbalancer *>(_ffThread));
+}
+
 void AdaptiveNode::setAdditionalTasks(size_t additionalTasks){
   size_t copy = _additionalTasks;
   copy += additionalTasks;
@@ -209,6 +209,7 @@ Requirements::Requirements() {
   energy = NORNIR_REQUIREMENT_UNDEF;
   expectedTasksNumber = NORNIR_REQUIREMENT_UNDEF;
   latency = NORNIR_REQUIREMENT_UNDEF;
+  latencyPercentile = NORNIR_REQUIREMENT_UNDEF;
 }
 
 bool Requirements::anySpecified() const {
@@ -230,6 +231,7 @@ void Parameters::setDefault() {
   strategyExploration = STRATEGY_EXPLORATION_HALTON;
   strategySmoothing = STRATEGY_SMOOTHING_EXPONENTIAL;
   strategyPolling = STRATEGY_POLLING_SLEEP_SMALL;
+  seqlockSampling = false;
   strategyPersistence = STRATEGY_PERSISTENCE_SAMPLES;
   strategyPhaseDetection = STRATEGY_PHASE_DETECTION_NONE;
   knobCoresEnabled = true;
@@ -239,8 +241,14 @@ void Parameters::setDefault() {
   knobHyperthreadingEnabled = false;
   knobHyperthreadingFixedValue = 0;
   knobPforChunkEnabled = false;
+  knobDataflowBatchEnabled = false;
+  knobDataflowWindowEnabled = false;
+  pforWorkStealing = false;
+  pforPersistentTeam = false;
+  pforTeamSpinTime = 100;
   activeThreads = 0;
   useConcurrencyThrottling = true;
+  drainFreeThrottling = false;
   fastReconfiguration = true;
   migrateCollector = false;
   smoothingFactor = 0;
@@ -249,6 +257,9 @@ void Parameters::setDefault() {
   samplingIntervalCalibration = 100;
   samplingIntervalSteady = 1000;
   steadyThreshold = 4;
+  samplingIntervalAdaptive = false;
+  samplingIntervalMin = 0;
+  queueHighWaterMark = 90.0;
   minTasksPerSample = 0;
   synchronousWorkers = false;
   maxCalibrationTime = 0;
@@ -256,6 +267,7 @@ void Parameters::setDefault() {
   maxPerformancePredictionError = 10.0;
   maxPowerPredictionError = 5.0;
   regressionAging = 0;
+  regressionIncremental = false;
   maxMonitoringOverhead = 1.0;
   clockModulationEmulated = true;
   clockModulationMin = 1.0;
@@ -268,8 +280,13 @@ void Parameters::setDefault() {
   tolerableSamples = 0;
   qSize = 1;
   conservativeValue = 0;
+  prunedSearch = false;
+  asyncModelFitting = false;
   isolateManager = false;
   statsReconfiguration = false;
+  reconfigurationResidenceTime = 0;
+  modelStorePath = "";
+  modelStoreName = "";
   nelderMeadRange = 2;
   fixedPinning = false;
   powerDomain = mammut::energy::COUNTER_CPUS;
@@ -285,6 +302,12 @@ void Parameters::setDefault() {
   dataflow.orderedProcessing = false;
   dataflow.orderedOutput = false;
   dataflow.maxGraphs = 1000;
+  dataflow.decentralisedFiring = false;
+  dataflow.placement = DATAFLOW_PLACEMENT_STATIC;
+  dataflow.batchSize = 1;
+  dataflow.maxBatchSize = 16;
+  dataflow.maxIdleSleep = 0;
+  dataflow.profileServiceTimes = false;
   dataflow.maxInterpreters = 0;
 
   /** Retrieving global configuration files. **/
@@ -313,7 +336,7 @@ void Parameters::setDefault() {
   }
 }
 
-uint Parameters::getLowOverheadSamplingInterval() const {
+double Parameters::getLowOverheadSamplingIntervalMs() const {
   // TODO Se questo sampling interval è molto minore della latenza
   // media di un task potrei settare il sampling interval alla
   // latenza media di un task.
@@ -323,7 +346,11 @@ uint Parameters::getLowOverheadSamplingInterval() const {
   // maxMonitoringOverhead% of the interval.
   double msMonitoringCost =
       (archData.monitoringCost / archData.ticksPerNs * 0.000001);
-  return ceil(msMonitoringCost * (100.0 - maxMonitoringOverhead));
+  return msMonitoringCost * (100.0 - maxMonitoringOverhead);
+}
+
+uint Parameters::getLowOverheadSamplingInterval() const {
+  return ceil(getLowOverheadSamplingIntervalMs());
 }
 
 /**
@@ -339,6 +366,10 @@ void Parameters::setDefaultPost() {
     samplingIntervalSteady = getLowOverheadSamplingInterval();
   }
 
+  if (!samplingIntervalMin) {
+    samplingIntervalMin = getLowOverheadSamplingIntervalMs();
+  }
+
   if (!smoothingFactor) {
     switch (strategySmoothing) {
     case STRATEGY_SMOOTHING_MOVING_AVERAGE: {
@@ -478,6 +509,15 @@ ParametersValidation Parameters::validateTriggers() {
        thresholdQBlockingBelt > 1)) {
     return VALIDATION_BLOCKING_PARAMETERS;
   }
+  // Blocked workers would not notice that they have been removed.
+  if (drainFreeThrottling && triggerQBlocking != TRIGGER_Q_BLOCKING_NO) {
+    return VALIDATION_NO;
+  }
+  if (samplingIntervalAdaptive &&
+      (queueHighWaterMark <= 0 || queueHighWaterMark > 100 ||
+       samplingIntervalMin < 0)) {
+    return VALIDATION_NO;
+  }
   return VALIDATION_OK;
 }
 
@@ -519,6 +559,12 @@ ParametersValidation Parameters::validateRequirements() {
       requirements.latency < 0) {
     return VALIDATION_WRONG_REQUIREMENT;
   }
+  if (requirements.latencyPercentile != NORNIR_REQUIREMENT_UNDEF &&
+      (requirements.latencyPercentile <= 0 ||
+       requirements.latencyPercentile > 100 ||
+       requirements.latency == NORNIR_REQUIREMENT_UNDEF)) {
+    return VALIDATION_WRONG_REQUIREMENT;
+  }
   if ((requirements.executionTime != NORNIR_REQUIREMENT_UNDEF ||
        requirements.energy != NORNIR_REQUIREMENT_UNDEF) &&
       requirements.expectedTasksNumber == NORNIR_REQUIREMENT_UNDEF) {
@@ -592,6 +638,8 @@ ParametersValidation Parameters::validateSelector() {
       true;
   knobsSupportSelector[STRATEGY_SELECTION_MANUAL_CLI][KNOB_CLKMOD] = true;
   knobsSupportSelector[STRATEGY_SELECTION_MANUAL_CLI][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_MANUAL_CLI][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_MANUAL_CLI][KNOB_DATAFLOW_WINDOW] = false;
 
   // MANUAL WEB
   knobsSupportSelector[STRATEGY_SELECTION_MANUAL_WEB][KNOB_VIRTUAL_CORES] =
@@ -602,6 +650,8 @@ ParametersValidation Parameters::validateSelector() {
       false;
   knobsSupportSelector[STRATEGY_SELECTION_MANUAL_WEB][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_MANUAL_WEB][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_MANUAL_WEB][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_MANUAL_WEB][KNOB_DATAFLOW_WINDOW] = false;
 
   // ANALYTICAL
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL][KNOB_VIRTUAL_CORES] =
@@ -612,6 +662,8 @@ ParametersValidation Parameters::validateSelector() {
       false;
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL][KNOB_CLKMOD] = true;
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL][KNOB_DATAFLOW_WINDOW] = false;
 
   // ANALYTICAL_FULL
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL_FULL][KNOB_VIRTUAL_CORES] =
@@ -624,6 +676,8 @@ ParametersValidation Parameters::validateSelector() {
                       [KNOB_HYPERTHREADING] = false;
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL_FULL][KNOB_CLKMOD] = true;
   knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL_FULL][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL_FULL][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_ANALYTICAL_FULL][KNOB_DATAFLOW_WINDOW] = false;
 
   // FULLSEARCH
   knobsSupportSelector[STRATEGY_SELECTION_FULLSEARCH][KNOB_VIRTUAL_CORES] =
@@ -634,6 +688,8 @@ ParametersValidation Parameters::validateSelector() {
       true;
   knobsSupportSelector[STRATEGY_SELECTION_FULLSEARCH][KNOB_CLKMOD] = true;
   knobsSupportSelector[STRATEGY_SELECTION_FULLSEARCH][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_FULLSEARCH][KNOB_DATAFLOW_BATCH] = true;
+  knobsSupportSelector[STRATEGY_SELECTION_FULLSEARCH][KNOB_DATAFLOW_WINDOW] = true;
 
   // For learning we do not check since it depends from the predictors choice.
   // (we will check in validatePredictors())
@@ -647,6 +703,8 @@ ParametersValidation Parameters::validateSelector() {
       false;
   knobsSupportSelector[STRATEGY_SELECTION_LIMARTINEZ][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_LIMARTINEZ][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_LIMARTINEZ][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_LIMARTINEZ][KNOB_DATAFLOW_WINDOW] = false;
 
   // LEO
   knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_VIRTUAL_CORES] = true;
@@ -655,6 +713,8 @@ ParametersValidation Parameters::validateSelector() {
   knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_HYPERTHREADING] = false;
   knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_LEO][KNOB_DATAFLOW_WINDOW] = false;
 
   if (strategySelection == STRATEGY_SELECTION_LEO &&
       (leo.throughputData.compare("") == 0 || leo.powerData.compare("") == 0 ||
@@ -673,6 +733,8 @@ ParametersValidation Parameters::validateSelector() {
       false;
   knobsSupportSelector[STRATEGY_SELECTION_HMP_NELDERMEAD][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_HMP_NELDERMEAD][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_HMP_NELDERMEAD][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_HMP_NELDERMEAD][KNOB_DATAFLOW_WINDOW] = false;
 
   // RAPL
   knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_VIRTUAL_CORES] = false;
@@ -681,6 +743,8 @@ ParametersValidation Parameters::validateSelector() {
   knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_HYPERTHREADING] = false;
   knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_PFOR_CHUNK] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_RAPL][KNOB_DATAFLOW_WINDOW] = false;
 
   // PFOR_CHUNK
   knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_VIRTUAL_CORES] = false;
@@ -689,6 +753,8 @@ ParametersValidation Parameters::validateSelector() {
   knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_HYPERTHREADING] = false;
   knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_CLKMOD] = false;
   knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_PFOR_CHUNK] = true;
+  knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_DATAFLOW_BATCH] = false;
+  knobsSupportSelector[STRATEGY_SELECTION_PFOR_CHUNK][KNOB_DATAFLOW_WINDOW] = false;
 
   if (strategySelection == STRATEGY_SELECTION_HMP_NELDERMEAD &&
       (firstConfiguration.virtualCores.empty() ||
@@ -729,6 +795,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_AMDAHL][KNOB_HYPERTHREADING] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_AMDAHL][KNOB_CLKMOD] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_AMDAHL][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_AMDAHL][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_AMDAHL][KNOB_DATAFLOW_WINDOW] = false;
     // LEO
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_FREQUENCY] = true;
@@ -736,6 +804,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_HYPERTHREADING] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_CLKMOD] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_LEO][KNOB_DATAFLOW_WINDOW] = false;
     // USL
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_FREQUENCY] = true;
@@ -743,6 +813,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_HYPERTHREADING] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_CLKMOD] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USL][KNOB_DATAFLOW_WINDOW] = false;
     // USLP
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_FREQUENCY] = true;
@@ -750,6 +822,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_HYPERTHREADING] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_CLKMOD] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_USLP][KNOB_DATAFLOW_WINDOW] = false;
     // SMT
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_FREQUENCY] = true;
@@ -757,6 +831,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_HYPERTHREADING] = true;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_CLKMOD] = false;
     knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPerformance[STRATEGY_PREDICTION_PERFORMANCE_SMT][KNOB_DATAFLOW_WINDOW] = false;
 
     /******************************************/
     /*              Power models.             */
@@ -768,6 +844,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LINEAR][KNOB_HYPERTHREADING] = false;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LINEAR][KNOB_CLKMOD] = true;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LINEAR][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_LINEAR][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_LINEAR][KNOB_DATAFLOW_WINDOW] = false;
     // LEO
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_FREQUENCY] = true;
@@ -775,6 +853,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_HYPERTHREADING] = false;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_CLKMOD] = false;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_LEO][KNOB_DATAFLOW_WINDOW] = false;
     // SMT
     knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_VIRTUAL_CORES] = true;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_FREQUENCY] = true;
@@ -782,6 +862,8 @@ ParametersValidation Parameters::validateSelector() {
     knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_HYPERTHREADING] = true;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_CLKMOD] = false;
     knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_PFOR_CHUNK] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_DATAFLOW_BATCH] = false;
+    knobsSupportPower[STRATEGY_PREDICTION_POWER_SMT][KNOB_DATAFLOW_WINDOW] = false;
 
     // Check if the knob enabled can be managed by the predictors specified.
     for (size_t i = 0; i < KNOB_NUM; i++) {
@@ -921,6 +1003,7 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, DoubleOrMin, requirements.executionTime);
   SETVALUE(xt, DoubleOrMin, requirements.energy);
   SETVALUE(xt, DoubleOrMin, requirements.latency);
+  SETVALUE(xt, Double, requirements.latencyPercentile);
 
   SETVALUE(xt, Enum, strategyUnusedVirtualCores);
   SETVALUE(xt, Enum, strategySelection);
@@ -929,6 +1012,7 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Enum, strategyExploration);
   SETVALUE(xt, Enum, strategySmoothing);
   SETVALUE(xt, Enum, strategyPolling);
+  SETVALUE(xt, Bool, seqlockSampling);
   SETVALUE(xt, Enum, strategyPersistence);
   SETVALUE(xt, Enum, strategyPhaseDetection);
   SETVALUE(xt, Enum, triggerQBlocking);
@@ -939,9 +1023,15 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Bool, knobHyperthreadingEnabled);
   SETVALUE(xt, Double, knobHyperthreadingFixedValue);
   SETVALUE(xt, Bool, knobPforChunkEnabled);
+  SETVALUE(xt, Bool, knobDataflowBatchEnabled);
+  SETVALUE(xt, Bool, knobDataflowWindowEnabled);
+  SETVALUE(xt, Bool, pforWorkStealing);
+  SETVALUE(xt, Bool, pforPersistentTeam);
+  SETVALUE(xt, Uint, pforTeamSpinTime);
 
   SETVALUE(xt, Uint, activeThreads);
   SETVALUE(xt, Bool, useConcurrencyThrottling);
+  SETVALUE(xt, Bool, drainFreeThrottling);
   SETVALUE(xt, Bool, fastReconfiguration);
   SETVALUE(xt, Double, smoothingFactor);
   SETVALUE(xt, Double, persistenceValue);
@@ -949,6 +1039,9 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Uint, samplingIntervalCalibration);
   SETVALUE(xt, Uint, samplingIntervalSteady);
   SETVALUE(xt, Uint, steadyThreshold);
+  SETVALUE(xt, Bool, samplingIntervalAdaptive);
+  SETVALUE(xt, Double, samplingIntervalMin);
+  SETVALUE(xt, Double, queueHighWaterMark);
   SETVALUE(xt, Uint, minTasksPerSample);
   SETVALUE(xt, Bool, migrateCollector);
   SETVALUE(xt, Bool, synchronousWorkers);
@@ -957,6 +1050,7 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Double, maxPerformancePredictionError);
   SETVALUE(xt, Double, maxPowerPredictionError);
   SETVALUE(xt, Uint, regressionAging);
+  SETVALUE(xt, Bool, regressionIncremental);
   SETVALUE(xt, Double, maxMonitoringOverhead);
   SETVALUE(xt, Bool, clockModulationEmulated);
   SETVALUE(xt, Double, clockModulationMin);
@@ -969,9 +1063,14 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Uint, tolerableSamples);
   SETVALUE(xt, Ulong, qSize);
   SETVALUE(xt, Double, conservativeValue);
+  SETVALUE(xt, Bool, prunedSearch);
+  SETVALUE(xt, Bool, asyncModelFitting);
   SETVALUE(xt, ArrayUint, disallowedNumCores);
   SETVALUE(xt, Bool, isolateManager);
   SETVALUE(xt, Bool, statsReconfiguration);
+  SETVALUE(xt, Double, reconfigurationResidenceTime);
+  SETVALUE(xt, String, modelStorePath);
+  SETVALUE(xt, String, modelStoreName);
   SETVALUE(xt, Enum, powerDomain);
   SETVALUE(xt, Uint, nelderMeadRange);
   SETVALUE(xt, Bool, fixedPinning);
@@ -992,6 +1091,12 @@ void Parameters::loadXml(const string &paramFileName) {
   SETVALUE(xt, Bool, dataflow.orderedProcessing);
   SETVALUE(xt, Bool, dataflow.orderedOutput);
   SETVALUE(xt, Uint, dataflow.maxGraphs);
+  SETVALUE(xt, Bool, dataflow.decentralisedFiring);
+  SETVALUE(xt, Enum, dataflow.placement);
+  SETVALUE(xt, Uint, dataflow.batchSize);
+  SETVALUE(xt, Uint, dataflow.maxBatchSize);
+  SETVALUE(xt, Uint, dataflow.maxIdleSleep);
+  SETVALUE(xt, Bool, dataflow.profileServiceTimes);
   SETVALUE(xt, Uint, dataflow.maxInterpreters);
 }
 
@@ -1025,6 +1130,8 @@ ParametersValidation Parameters::validate() {
   _knobEnabled[KNOB_HYPERTHREADING] = knobHyperthreadingEnabled;
   _knobEnabled[KNOB_CLKMOD] = knobClkModEnabled;
   _knobEnabled[KNOB_PFOR_CHUNK] = knobPforChunkEnabled;
+  _knobEnabled[KNOB_DATAFLOW_BATCH] = knobDataflowBatchEnabled;
+  _knobEnabled[KNOB_DATAFLOW_WINDOW] = knobDataflowWindowEnabled;
 
   /** Validate frequency knob. **/
   ParametersValidation r = validateKnobFrequencies();
@@ -1037,6 +1144,17 @@ ParametersValidation Parameters::validate() {
     return r;
   }
 
+  /**
+   * Validate dataflow batch and window knobs (the parallel for is not a
+   * dataflow program).
+   **/
+  if ((knobPforChunkEnabled &&
+       (knobDataflowBatchEnabled || knobDataflowWindowEnabled)) ||
+      !dataflow.batchSize || dataflow.batchSize > dataflow.maxBatchSize ||
+      !dataflow.maxGraphs) {
+    return VALIDATION_NO;
+  }
+
   /** Validate triggers. **/
   r = validateTriggers();
   if (r != VALIDATION_OK) {
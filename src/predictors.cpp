@@ -35,6 +35,8 @@
 
 #include <mammut/cpufreq/cpufreq.hpp>
 
+#include <algorithm>
+
 #undef DEBUG
 #undef DEBUGB
 //#define DEBUG_PREDICTORS
@@ -368,11 +370,14 @@ Predictor::~Predictor() {
 }
 
 double Predictor::getMaximumThroughput() const {
-  if (_samples->average().loadPercentage >= MAX_RHO ||
-      _samples->average().inconsistent) {
-    return _samples->average().throughput;
+  return getMaximumThroughput(_samples->average());
+}
+
+double Predictor::getMaximumThroughput(const MonitoredSample &sample) const {
+  if (sample.loadPercentage >= MAX_RHO || sample.inconsistent) {
+    return sample.throughput;
   } else {
-    return _samples->average().getMaximumThroughput();
+    return sample.getMaximumThroughput();
   }
 }
 
@@ -380,11 +385,25 @@ double Predictor::getCurrentPower() const {
   return _samples->average().watts;
 }
 
+void Predictor::refine() {
+  refine(_configuration.getRealValues(), _samples->average());
+}
+
+void Predictor::predictBatch(const std::vector<KnobsValues> &realValues,
+                             size_t version,
+                             std::vector<double> &predictions) {
+  predictions.resize(realValues.size());
+  for (size_t i = 0; i < realValues.size(); i++) {
+    predictions[i] = predict(realValues[i]);
+  }
+}
+
 #ifdef ENABLE_MLPACK
 PredictorLinearRegression::PredictorLinearRegression(
     PredictorType type, const Parameters &p, const Configuration &configuration,
     const Smoother<MonitoredSample> *samples)
-    : Predictor(type, p, configuration, samples), _preparationNeeded(true) {
+    : Predictor(type, p, configuration, samples), _preparationNeeded(true),
+      _batchVersion(0) {
   switch (_type) {
   case PREDICTION_THROUGHPUT: {
     _predictionInput = new RegressionDataServiceTime(p, configuration, samples);
@@ -410,6 +429,23 @@ void PredictorLinearRegression::clear() {
   _agingVector.clear();
   _agingVector.reserve(_p.regressionAging);
   _currentAgingId = 0;
+
+  size_t numCoefficients = _predictionInput->getNumPredictors() + 1;
+  _coefficients.zeros(numCoefficients);
+  _predictionInputMl.zeros(numCoefficients - 1, 1);
+  _rlsP.eye(numCoefficients, numCoefficients);
+  _rlsP *= RLS_INITIAL_COVARIANCE;
+  _rlsTheta.zeros(numCoefficients);
+  _rlsX.zeros(numCoefficients);
+  _rlsPx.zeros(numCoefficients);
+  _rlsScale.zeros(numCoefficients);
+  _rlsScale(0) = 1.0; // Intercept
+  _rlsForgetting = 1.0;
+  if (_p.regressionAging) {
+    _rlsForgetting = _p.regressionAging / (_p.regressionAging + 1.0);
+  }
+  _rlsError = 0;
+  _rlsErrorWeight = 0;
 }
 
 bool PredictorLinearRegression::readyForPredictions() {
@@ -418,21 +454,23 @@ bool PredictorLinearRegression::readyForPredictions() {
   return _observations.size() >= minPoints;
 }
 
-double PredictorLinearRegression::getCurrentResponse() const {
+double
+PredictorLinearRegression::getResponse(const MonitoredSample &sample) const {
   double r = 0.0;
   switch (_type) {
   case PREDICTION_THROUGHPUT: {
-    r = 1.0 / getMaximumThroughput();
+    r = 1.0 / getMaximumThroughput(sample);
   } break;
   case PREDICTION_POWER: {
-    r = getCurrentPower();
+    r = sample.watts;
   } break;
   }
   return r;
 }
 
-void PredictorLinearRegression::refine() {
-  KnobsValues currentValues = _configuration.getRealValues();
+void PredictorLinearRegression::refine(const KnobsValues &realValues,
+                                       const MonitoredSample &sample) {
+  KnobsValues currentValues = realValues;
   _preparationNeeded = true;
   if (_type == PREDICTION_POWER) {
     // Add service nodes
@@ -448,13 +486,28 @@ void PredictorLinearRegression::refine() {
     }
     _currentAgingId = (_currentAgingId + 1) % _p.regressionAging;
   }
-  double response = getCurrentResponse();
+  double response = getResponse(sample);
   DEBUG("Refining with configuration " << currentValues << ": " << response);
+  if (_p.regressionIncremental) {
+    // Observations are only kept to count the visited configurations.
+    _predictionInput->init(realValues);
+    updateIncremental(*_predictionInput, response);
+    if (lb == _observations.end() ||
+        _observations.key_comp()(currentValues, lb->first)) {
+      Observation o;
+      o.data = NULL;
+      o.response = response;
+      _observations.insert(lb, Observations::value_type(currentValues, o));
+    } else {
+      lb->second.response = response;
+    }
+    return;
+  }
   if (lb != _observations.end() &&
       !(_observations.key_comp()(currentValues, lb->first))) {
     // Key already exists
     DEBUG("Replacing " << currentValues);
-    lb->second.data->init();
+    lb->second.data->init(realValues);
     lb->second.response = response;
   } else {
     // The key does not exist in the map
@@ -467,17 +520,74 @@ void PredictorLinearRegression::refine() {
       o.data = new RegressionDataPower(_p, _configuration, _samples);
     } break;
     }
+    o.data->init(realValues);
     o.response = response;
     _observations.insert(lb, Observations::value_type(currentValues, o));
   }
 }
 
+void PredictorLinearRegression::updateIncremental(
+    const RegressionData &observation, double response) {
+  size_t n = _rlsX.n_elem;
+  observation.toArmaRow(0, _predictionInputMl);
+  _rlsX(0) = 1.0;
+  for (size_t i = 1; i < n; i++) {
+    double x = _predictionInputMl(i - 1, 0);
+    if (!_rlsScale(i)) {
+      // Normalize each predictor with the first (non zero) value observed,
+      // to keep the correlation matrix well conditioned.
+      _rlsScale(i) = std::abs(x);
+    }
+    _rlsX(i) = _rlsScale(i) ? x / _rlsScale(i) : 0;
+  }
+
+  // Gain: k = P * x / (lambda + x' * P * x). _rlsPx holds k.
+  double denominator = _rlsForgetting;
+  for (size_t i = 0; i < n; i++) {
+    double v = 0;
+    for (size_t j = 0; j < n; j++) {
+      v += _rlsP(i, j) * _rlsX(j);
+    }
+    _rlsPx(i) = v;
+    denominator += _rlsX(i) * v;
+  }
+  double error = response;
+  for (size_t i = 0; i < n; i++) {
+    error -= _rlsTheta(i) * _rlsX(i);
+  }
+  for (size_t i = 0; i < n; i++) {
+    _rlsTheta(i) += (_rlsPx(i) / denominator) * error;
+  }
+  // P = (P - k * x' * P) / lambda. P is symmetric, so x' * P = (P * x)'.
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i; j < n; j++) {
+      double v = (_rlsP(i, j) - _rlsPx(i) * _rlsPx(j) / denominator) /
+                 _rlsForgetting;
+      _rlsP(i, j) = v;
+      _rlsP(j, i) = v;
+    }
+  }
+  // A priori error, exponentially weighted.
+  _rlsError = _rlsForgetting * _rlsError + error * error;
+  _rlsErrorWeight = _rlsForgetting * _rlsErrorWeight + 1;
+  _modelError = _rlsError / _rlsErrorWeight;
+
+  for (size_t i = 0; i < n; i++) {
+    _coefficients(i) = _rlsScale(i) ? _rlsTheta(i) / _rlsScale(i) : 0;
+  }
+}
+
 void PredictorLinearRegression::prepareForPredictions() {
   if (_preparationNeeded) {
     if (!readyForPredictions()) {
       throw std::runtime_error("prepareForPredictions: Not enough "
                                "points are present");
     }
+    if (_p.regressionIncremental) {
+      // Coefficients already updated by refine().
+      _preparationNeeded = false;
+      return;
+    }
 
     // One observation per column.
     arma::mat dataMl(_observations.begin()->second.data->getNumPredictors(),
@@ -542,6 +652,16 @@ void PredictorLinearRegression::prepareForPredictions() {
     } else {
       _lr = newlr;
       _modelError = _lr.ComputeError(dataMl, responsesMl);
+      // Coefficients of the removed rows are zero.
+      const arma::vec &parameters = _lr.Parameters();
+      _coefficients.zeros();
+      _coefficients(0) = parameters(0);
+      size_t parameterId = 1;
+      for (size_t i = 1; i < _coefficients.n_elem; i++) {
+        if (!contains(_removedRows, i - 1)) {
+          _coefficients(i) = parameters(parameterId++);
+        }
+      }
     }
 
     DEBUG("Error in model: " << _modelError);
@@ -551,35 +671,50 @@ void PredictorLinearRegression::prepareForPredictions() {
 
 double PredictorLinearRegression::predict(const KnobsValues &values) {
   _predictionInput->init(values);
+  _predictionInput->toArmaRow(0, _predictionInputMl);
 
-  // One observation per column.
-  arma::mat predictionInputMl(_predictionInput->getNumPredictors(), 1);
-  arma::rowvec result(1);
-  double res = 0;
-  _predictionInput->toArmaRow(0, predictionInputMl);
-
-  // Remove from prediction input the corresponding positions
-  // for(size_t i = 0; i < _removedRows.size(); i++){
-  //    predictionInputMl.shed_row(_removedRows.at(i));
-  //}
-  arma::mat predictionInputMlShed(_predictionInput->getNumPredictors(), 1);
-  size_t realSize = 0;
-  for (size_t i = 0; i < _predictionInput->getNumPredictors(); i++) {
-    if (!contains(_removedRows, i)) {
-      predictionInputMlShed(realSize, 0) = predictionInputMl(i, 0);
-      ++realSize;
+  // Coefficients of the rows removed from the data matrix are zero.
+  double result = _coefficients(0);
+  for (size_t i = 1; i < _coefficients.n_elem; i++) {
+    result += _coefficients(i) * _predictionInputMl(i - 1, 0);
+  }
+  if (_type == PREDICTION_THROUGHPUT) {
+    return 1.0 / result;
+  } else {
+    return result;
+  }
+}
+
+void PredictorLinearRegression::predictBatch(
+    const std::vector<KnobsValues> &realValues, size_t version,
+    std::vector<double> &predictions) {
+  if (!version || version != _batchVersion ||
+      _batchInput.n_rows != realValues.size()) {
+    // The predictors only depend on the knobs values, so they are computed
+    // once and reused for all the subsequent batches.
+    _batchInput.set_size(realValues.size(), _coefficients.n_elem);
+    for (size_t i = 0; i < realValues.size(); i++) {
+      _predictionInput->init(realValues[i]);
+      _predictionInput->toArmaRow(0, _predictionInputMl);
+      _batchInput(i, 0) = 1.0;
+      for (size_t j = 1; j < _coefficients.n_elem; j++) {
+        _batchInput(i, j) = _predictionInputMl(j - 1, 0);
+      }
     }
+    _batchVersion = version;
   }
-  predictionInputMlShed.resize(realSize, 1);
 
-  _lr.Predict(predictionInputMlShed, result);
+  _batchOutput = _batchInput * _coefficients;
+  predictions.resize(realValues.size());
   if (_type == PREDICTION_THROUGHPUT) {
-    res = 1.0 / result.at(0);
+    for (size_t i = 0; i < realValues.size(); i++) {
+      predictions[i] = 1.0 / _batchOutput(i);
+    }
   } else {
-    res = result.at(0);
+    for (size_t i = 0; i < realValues.size(); i++) {
+      predictions[i] = _batchOutput(i);
+    }
   }
-
-  return res;
 }
 
 double PredictorLinearRegression::getInactivePowerParameter() const {
@@ -589,7 +724,7 @@ double PredictorLinearRegression::getInactivePowerParameter() const {
              ->getInactivePowerPosition(pos)) {
       throw std::runtime_error("Impossible to get inactive power parameter.");
     }
-    return _lr.Parameters().at(pos);
+    return _coefficients.at(pos);
   } else {
     throw std::runtime_error(
         "getInactivePowerParameter can only be called on POWER predictors.");
@@ -648,17 +783,18 @@ bool PredictorUsl::readyForPredictions() {
   return _xs.size() >= _maxPolDegree;
 }
 
-void PredictorUsl::refine() {
-  double numCores = _configuration.getKnob(KNOB_VIRTUAL_CORES)->getRealValue();
-  double throughput = getMaximumThroughput();
+void PredictorUsl::refine(const KnobsValues &realValues,
+                          const MonitoredSample &sample) {
+  double numCores = realValues[KNOB_VIRTUAL_CORES];
+  double throughput = getMaximumThroughput(sample);
   double speed = 1;
 
   if (_p.knobFrequencyEnabled) {
-    speed = _configuration.getKnob(KNOB_FREQUENCY)->getRealValue();
+    speed = realValues[KNOB_FREQUENCY];
   }
 
   if (_p.knobClkModEnabled) {
-    speed *= _configuration.getKnob(KNOB_CLKMOD)->getRealValue() / 100.0;
+    speed *= realValues[KNOB_CLKMOD] / 100.0;
   }
 
   double maxCores =
@@ -988,7 +1124,8 @@ bool PredictorAnalytical::readyForPredictions() {
   return true;
 }
 
-void PredictorAnalytical::refine() {
+void PredictorAnalytical::refine(const KnobsValues &realValues,
+                                 const MonitoredSample &sample) {
   ;
 }
 
@@ -1040,14 +1177,11 @@ double PredictorAnalyticalFull::predict(const KnobsValues &values) {
 PredictorLeo::PredictorLeo(PredictorType type, const Parameters &p,
                            const Configuration &configuration,
                            const Smoother<MonitoredSample> *samples)
-    : Predictor(type, p, configuration, samples), _preparationNeeded(true) {
-  const std::vector<KnobsValues> &combinations =
-      _configuration.getAllRealCombinations();
-  DEBUG("Found: " << combinations.size() << " combinations.");
-  for (size_t i = 0; i < combinations.size(); i++) {
-    _confIndexes[combinations.at(i)] = i;
-  }
-  _values.resize(combinations.size());
+    : Predictor(type, p, configuration, samples),
+      _combinations(_configuration.getRealCombinations()),
+      _preparationNeeded(true), _model(NULL) {
+  DEBUG("Found: " << _combinations.size() << " combinations.");
+  _values.resize(_combinations.size());
   _values.zeros();
   std::vector<std::string> names = mammut::utils::readFile(p.leo.namesData);
   bool appFound = false;
@@ -1061,10 +1195,20 @@ PredictorLeo::PredictorLeo(PredictorType type, const Parameters &p,
     throw std::runtime_error("Impossible to find application " +
                              p.leo.applicationName + " in " + p.leo.namesData);
   }
+
+  switch (_type) {
+  case PREDICTION_THROUGHPUT: {
+    _model = new leo::Model(_appId, _p.leo.throughputData, true);
+  } break;
+  case PREDICTION_POWER: {
+    _model = new leo::Model(_appId, _p.leo.powerData, false);
+  } break;
+  default: { throw std::runtime_error("Unknown predictor type."); }
+  }
 }
 
 PredictorLeo::~PredictorLeo() {
-  ;
+  delete _model;
 }
 
 bool PredictorLeo::readyForPredictions() {
@@ -1074,16 +1218,17 @@ bool PredictorLeo::readyForPredictions() {
 void PredictorLeo::clear() {
   _values.zeros();
   _predictions.zeros();
+  _model->reset();
 }
 
-void PredictorLeo::refine() {
+void PredictorLeo::refine(const KnobsValues &realValues,
+                          const MonitoredSample &sample) {
   _preparationNeeded = true;
-  auto it = _confIndexes.find(_configuration.getRealValues());
-  if (it == _confIndexes.end()) {
+  size_t confId;
+  if (!_combinations.getIndex(realValues, confId)) {
     throw std::runtime_error(
         "[Leo] Impossible to find index for configuration.");
   }
-  size_t confId = it->second;
   if (confId >= _values.size()) {
     throw std::runtime_error("[Leo] Invalid configuration index: " + confId);
   }
@@ -1097,10 +1242,10 @@ void PredictorLeo::refine() {
                 throw std::runtime_error("[Leo] throughput throughputMax problem.");
             }
 #endif
-    _values.at(confId) = getMaximumThroughput();
+    _values.at(confId) = getMaximumThroughput(sample);
   } break;
   case PREDICTION_POWER: {
-    _values.at(confId) = getCurrentPower();
+    _values.at(confId) = sample.watts;
   } break;
   default: { throw std::runtime_error("[Leo] Unknown predictor type."); }
   }
@@ -1113,34 +1258,18 @@ void PredictorLeo::prepareForPredictions() {
                                "points are present");
     }
 
-    string dataFile;
-    bool perColumnNormalization;
-    switch (_type) {
-    case PREDICTION_THROUGHPUT: {
-      dataFile = _p.leo.throughputData;
-      perColumnNormalization = true;
-    } break;
-    case PREDICTION_POWER: {
-      dataFile = _p.leo.powerData;
-      perColumnNormalization = false;
-    } break;
-    default: { throw std::runtime_error("Unknown predictor type."); }
-    }
-
-    leo::PredictionResults pr =
-        leo::compute(_appId, dataFile, &_values, perColumnNormalization);
+    leo::PredictionResults pr = _model->compute(&_values);
     _predictions = arma::conv_to<std::vector<double>>::from(pr.predictions);
     _preparationNeeded = false;
   }
 }
 
 double PredictorLeo::predict(const KnobsValues &realValues) {
-  auto it = _confIndexes.find(realValues);
-  if (it == _confIndexes.end()) {
+  size_t confId;
+  if (!_combinations.getIndex(realValues, confId)) {
     throw std::runtime_error(
         "[Leo] Impossible to find index for configuration.");
   }
-  size_t confId = it->second;
   if (confId >= _predictions.size()) {
     throw std::runtime_error("[Leo] Invalid configuration index: " + confId);
   }
@@ -1152,7 +1281,9 @@ PredictorFullSearch::PredictorFullSearch(
     PredictorType type, const Parameters &p, const Configuration &configuration,
     const Smoother<MonitoredSample> *samples)
     : Predictor(type, p, configuration, samples),
-      _allConfigurations(_configuration.getAllRealCombinations()) {
+      _combinations(_configuration.getRealCombinations()),
+      _values(_combinations.size()), _observed(_combinations.size(), false),
+      _numObserved(0) {
   ;
 }
 
@@ -1161,25 +1292,36 @@ PredictorFullSearch::~PredictorFullSearch() {
 }
 
 bool PredictorFullSearch::readyForPredictions() {
-  return _values.size() == _allConfigurations.size();
+  return _numObserved == _combinations.size();
 }
 
 void PredictorFullSearch::clear() {
-  _values.clear();
+  std::fill(_observed.begin(), _observed.end(), false);
+  _numObserved = 0;
 }
 
-void PredictorFullSearch::refine() {
+void PredictorFullSearch::refine(const KnobsValues &realValues,
+                                 const MonitoredSample &sample) {
   double value = 0;
   switch (_type) {
   case PREDICTION_THROUGHPUT: {
-    value = getMaximumThroughput();
+    value = getMaximumThroughput(sample);
   } break;
   case PREDICTION_POWER: {
-    value = getCurrentPower();
+    value = sample.watts;
   } break;
   default: { throw std::runtime_error("Unknown predictor type."); }
   }
-  _values[_configuration.getRealValues()] = value;
+  size_t index;
+  if (!_combinations.getIndex(realValues, index)) {
+    // Not one of the configurations to be explored.
+    return;
+  }
+  if (!_observed[index]) {
+    _observed[index] = true;
+    ++_numObserved;
+  }
+  _values[index] = value;
 }
 
 void PredictorFullSearch::prepareForPredictions() {
@@ -1191,7 +1333,11 @@ double PredictorFullSearch::predict(const KnobsValues &realValues) {
     throw std::runtime_error("prepareForPredictions: Not enough "
                              "points are present");
   }
-  return _values.at(realValues);
+  size_t index;
+  if (!_combinations.getIndex(realValues, index)) {
+    throw std::runtime_error("[FullSearch] Configuration never explored.");
+  }
+  return _values[index];
 }
 
 #ifdef ENABLE_MLPACK
@@ -1274,14 +1420,13 @@ double PredictorSMT::getHT(double numContexts) const {
   //return (1 / numContexts) - 1;
 }
 
-void PredictorSMT::refine() {
-  double numContexts =
-      _configuration.getKnob(KNOB_HYPERTHREADING)->getRealValue();
-  double numCores =
-      _configuration.getKnob(KNOB_VIRTUAL_CORES)->getRealValue() / numContexts;
+void PredictorSMT::refine(const KnobsValues &realValues,
+                          const MonitoredSample &sample) {
+  double numContexts = realValues[KNOB_HYPERTHREADING];
+  double numCores = realValues[KNOB_VIRTUAL_CORES] / numContexts;
 
-  double executionTime = 1.0 / (getMaximumThroughput());
-  double power = getCurrentPower();
+  double executionTime = 1.0 / (getMaximumThroughput(sample));
+  double power = sample.watts;
   double freq = 1.0;
   double nActiveCpu = floor(numCores / _phyCoresPerDomain);
   double nCoresInSpuriousCpu = ((uint) numCores) % _phyCoresPerDomain;
@@ -1291,7 +1436,7 @@ void PredictorSMT::refine() {
   }
 
   if (_p.knobFrequencyEnabled) {
-    freq = _configuration.getKnob(KNOB_FREQUENCY)->getRealValue();
+    freq = realValues[KNOB_FREQUENCY];
   }
 
   switch (_type) {
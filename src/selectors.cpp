@@ -24,6 +24,7 @@
  *
  * =========================================================================
  */
+#include <algorithm>
 #include <cfloat>
 #include <iostream>
 #include <nornir/selectors.hpp>
@@ -68,8 +69,9 @@ Selector::Selector(const Parameters &p, const Configuration &configuration,
       _totalCalibrationTime(0), _calibrating(false), _ignoreViolations(false),
       _p(p), _configuration(configuration), _samples(samples),
       _numCalibrationPoints(0), _forced(false), _forcedReturned(false),
-      _calibrationCoordination(false), _calibrationAllowed(false),
-      _totalTasks(0), _remainingTasks(p.requirements.expectedTasksNumber) {
+      _avoidedReconfigurations(0), _calibrationCoordination(false),
+      _calibrationAllowed(false), _totalTasks(0),
+      _remainingTasks(p.requirements.expectedTasksNumber) {
   //_joulesCounter = _localMammut.getInstanceEnergy()->getCounter();
   _numPhyCores = _p.mammut.getInstanceTopology()->getPhysicalCores().size();
   // TODO Fare meglio con mammut
@@ -101,9 +103,27 @@ bool Selector::isFeasibleThroughput(double value, bool conservative) const {
 }
 
 bool Selector::isFeasibleLatency(double value, bool conservative) const {
+  // Only percentile latency bounds are supported.
+  if (isPrimaryRequirement(_p.requirements.latency) &&
+      _p.requirements.latencyPercentile != NORNIR_REQUIREMENT_UNDEF) {
+    double conservativeOffset = 0;
+    if (conservative && _p.conservativeValue) {
+      conservativeOffset =
+          _p.requirements.latency * (_p.conservativeValue / 100.0);
+    }
+    return value < _p.requirements.latency - conservativeOffset;
+  }
   return true;
 }
 
+double Selector::getLatency(const MonitoredSample &sample) const {
+  double latency = sample.latency;
+  if (_p.requirements.latencyPercentile != NORNIR_REQUIREMENT_UNDEF) {
+    latency = sample.tailLatency;
+  }
+  return latency / (NSECS_IN_SECS / MSECS_IN_SECS);
+}
+
 bool Selector::isFeasibleUtilization(double value, bool conservative) const {
   if (isPrimaryRequirement(_p.requirements.minUtilization)) {
     double conservativeOffset = 0;
@@ -164,7 +184,7 @@ bool Selector::isContractViolated() const {
   double avgTime = _remainingTasks / avg.throughput;
   double avgEnergy = avgTime * avg.watts;
   return !isFeasibleThroughput(avg.throughput, false) ||
-         !isFeasibleLatency(avg.latency, false) ||
+         !isFeasibleLatency(getLatency(avg), false) ||
          !isFeasibleUtilization(avg.loadPercentage, false) ||
          !isFeasiblePower(avg.watts, false) ||
          !isFeasibleTime(avgTime, false) || !isFeasibleEnergy(avgEnergy, false);
@@ -220,6 +240,10 @@ double Selector::getTotalCalibrationTime() const {
   return _totalCalibrationTime;
 }
 
+uint Selector::getAvoidedReconfigurations() const {
+  return _avoidedReconfigurations;
+}
+
 void Selector::resetTotalCalibrationTime() {
   _totalCalibrationTime = 0;
 }
@@ -431,7 +455,10 @@ SelectorPredictive::SelectorPredictive(
     : Selector(p, configuration, samples),
       _throughputPredictor(std::move(throughputPredictor)),
       _powerPredictor(std::move(powerPredictor)), _feasible(true),
-      _throughputPrediction(NOT_VALID), _powerPrediction(NOT_VALID) {
+      _batchCombinations(std::array<std::vector<double>, KNOB_NUM>()),
+      _batchVersion(0),
+      _modelLoaded(false), _throughputPrediction(NOT_VALID),
+      _powerPrediction(NOT_VALID), _samplesSnapshot(NULL) {
   /****************************************/
   /*              Predictors              */
   /****************************************/
@@ -439,13 +466,16 @@ SelectorPredictive::SelectorPredictive(
 #if STORE_PREDICTIONS
   // Just to let the multi manager work even if this manager terminates
   // before making some predictions.
-  const vector<KnobsValues> &combinations =
-      _configuration.getAllRealCombinations();
-  for (size_t i = 0; i < combinations.size(); i++) {
-    _performancePredictions[combinations.at(i)] = -1;
-    _powerPredictions[combinations.at(i)] = -1;
+  const KnobsCombinations combinations = _configuration.getRealCombinations();
+  for (const KnobsValues &values : combinations) {
+    _performancePredictions[values] = -1;
+    _powerPredictions[values] = -1;
   }
 #endif
+  if (!_p.modelStorePath.empty()) {
+    _modelStore.reset(new ModelStore(_p));
+    loadModel();
+  }
 }
 
 SelectorPredictive::~SelectorPredictive() {
@@ -476,6 +506,32 @@ double SelectorPredictive::getThroughputPrediction(const KnobsValues &values) {
   }
 }
 
+double SelectorPredictive::getLatencyPrediction(const KnobsValues &values,
+                                                double maxThroughput) {
+  if (!isPrimaryRequirement(_p.requirements.latency) ||
+      _p.requirements.latencyPercentile == NORNIR_REQUIREMENT_UNDEF) {
+    return 0;
+  }
+  auto observation = _observedValues.find(_configuration.getRealValues(values));
+  if (observation != _observedValues.end()) {
+    return getLatency(observation->second);
+  }
+  // Each task is processed by one worker, so the latency scales with
+  // the service time of a worker (i.e. workers / maximum throughput).
+  MonitoredSample current =
+      _samplesSnapshot ? *_samplesSnapshot : _samples->average();
+  double currentThroughput = current.getMaximumThroughput();
+  if (currentThroughput <= 0 || maxThroughput <= 0) {
+    // Nothing to scale (no tasks completed in the current configuration,
+    // or none predicted in the new one). Keep the current latency.
+    return getLatency(current);
+  }
+  double currentServiceTime =
+      _configuration.getRealValues()[KNOB_VIRTUAL_CORES] / currentThroughput;
+  double serviceTime = values[KNOB_VIRTUAL_CORES] / maxThroughput;
+  return getLatency(current) * (serviceTime / currentServiceTime);
+}
+
 double SelectorPredictive::getPowerPrediction(const KnobsValues &values) {
   auto observation = _observedValues.find(_configuration.getRealValues(values));
   if (observation != _observedValues.end()) {
@@ -578,13 +634,13 @@ bool SelectorPredictive::isBestSuboptimal(double throughput, double latency,
 
   // Latency requirement
   if (isPrimaryRequirement(_p.requirements.latency)) {
-    throw std::runtime_error("Latency control not yet supported.");
-    /*
-    if(latency < best){
-        best = latency;
-        return true;
+    if (_p.requirements.latencyPercentile == NORNIR_REQUIREMENT_UNDEF) {
+      throw std::runtime_error("Latency control not yet supported.");
+    }
+    if (latency < best) {
+      best = latency;
+      return true;
     }
-    */
   }
 
   // Utilization requirement
@@ -629,7 +685,259 @@ void SelectorPredictive::updateMaxPerformanceConfiguration(KnobsValues values,
   }
 }
 
+void SelectorPredictive::predictAll() {
+  // Only rebuilt if the allowed values of some knob changed.
+  KnobsCombinations combinations = _configuration.getRealCombinations();
+  if (combinations != _batchCombinations) {
+    _batchConfigurations.clear();
+    for (const KnobsValues &values : combinations) {
+      if (areKnobsValid(values)) {
+        _batchConfigurations.push_back(values);
+      }
+    }
+    _batchCombinations = combinations;
+    ++_batchVersion;
+  }
+  _throughputPredictor->prepareForPredictions();
+  _throughputPredictor->predictBatch(_batchConfigurations, _batchVersion,
+                                     _batchThroughput);
+  _powerPredictor->prepareForPredictions();
+  _powerPredictor->predictBatch(_batchConfigurations, _batchVersion,
+                                _batchPower);
+  if (!_observedValues.empty()) {
+    for (size_t i = 0; i < _batchConfigurations.size(); i++) {
+      auto observation = _observedValues.find(_batchConfigurations[i]);
+      if (observation != _observedValues.end()) {
+        _batchThroughput[i] = observation->second.getMaximumThroughput();
+        _batchPower[i] = observation->second.watts;
+      }
+    }
+  }
+}
+
+bool SelectorPredictive::isPrunedSearchApplicable() const {
+  // Throughput and power are monotone in the number of cores, so the
+  // configurations satisfying their bounds are intervals on that knob.
+  return _p.prunedSearch &&
+         _p.requirements.minUtilization == NORNIR_REQUIREMENT_UNDEF &&
+         _p.requirements.maxUtilization == NORNIR_REQUIREMENT_UNDEF &&
+         _p.requirements.executionTime == NORNIR_REQUIREMENT_UNDEF &&
+         _p.requirements.latency == NORNIR_REQUIREMENT_UNDEF &&
+         _p.requirements.energy == NORNIR_REQUIREMENT_UNDEF;
+}
+
+KnobsValues SelectorPredictive::getBestKnobsValuesPruned() {
+  KnobsValues bestKnobs(KNOB_VALUE_REAL);
+  KnobsValues bestSuboptimalKnobs = _configuration.getRealValues();
+  double bestValue = initBestValue();
+  double bestSuboptimalValue = initBestSuboptimalValue();
+  bool bestKnobsSet = false;
+  _feasible = false;
+
+  const KnobsCombinations combinations = _configuration.getRealCombinations();
+  size_t numCores = combinations.getNumValues(KNOB_VIRTUAL_CORES);
+  size_t stride = combinations.getStride(KNOB_VIRTUAL_CORES);
+  size_t numGroups = numCores ? combinations.size() / numCores : 0;
+  KnobsValues kv(KNOB_VALUE_REAL);
+  std::vector<size_t> ids;
+  ids.reserve(numCores);
+
+  // Configurations to be evaluated, and whether they are feasible.
+  std::vector<std::pair<size_t, bool>> candidates;
+
+  for (size_t g = 0; g < numGroups; g++) {
+    // Combinations of the group only differ by the number of cores
+    // (allowed values of the virtual cores knob are sorted).
+    size_t base = (g / stride) * stride * numCores + g % stride;
+    ids.clear();
+    for (size_t c = 0; c < numCores; c++) {
+      combinations.at(base + c * stride, kv);
+      if (areKnobsValid(kv)) {
+        ids.push_back(base + c * stride);
+      }
+    }
+    if (ids.empty()) {
+      continue;
+    }
+
+    // First configuration satisfying the throughput requirement.
+    size_t low = 0, high = ids.size();
+    if (isPrimaryRequirement(_p.requirements.throughput)) {
+      size_t l = 0, h = ids.size();
+      while (l < h) {
+        size_t m = (l + h) / 2;
+        combinations.at(ids[m], kv);
+        if (isFeasibleThroughput(getThroughputPrediction(kv), true)) {
+          h = m;
+        } else {
+          l = m + 1;
+        }
+      }
+      low = l;
+    }
+    // First configuration violating the power requirement.
+    if (isPrimaryRequirement(_p.requirements.powerConsumption)) {
+      size_t l = 0, h = ids.size();
+      while (l < h) {
+        size_t m = (l + h) / 2;
+        combinations.at(ids[m], kv);
+        if (isFeasiblePower(getPowerPrediction(kv), true)) {
+          l = m + 1;
+        } else {
+          h = m;
+        }
+      }
+      high = l;
+    }
+
+    // The most performing configuration of the group uses all the cores.
+    combinations.at(ids.back(), kv);
+    updateMaxPerformanceConfiguration(kv, getThroughputPrediction(kv));
+
+    if (low < high) {
+      // The best configuration is on one of the bounds of the interval.
+      if (_p.requirements.throughput == NORNIR_REQUIREMENT_MAX) {
+        candidates.push_back(std::make_pair(ids[high - 1], true));
+      } else {
+        candidates.push_back(std::make_pair(ids[low], true));
+      }
+    } else {
+      // The closest configurations to the requirements are the ones with
+      // the highest throughput and with the lowest power.
+      candidates.push_back(std::make_pair(ids.back(), false));
+      candidates.push_back(std::make_pair(ids.front(), false));
+    }
+  }
+
+  for (const std::pair<size_t, bool> &candidate : candidates) {
+    combinations.at(candidate.first, kv);
+    double throughput = getThroughputPrediction(kv);
+    double power = getPowerPrediction(kv);
+    double utilization = _bandwidthIn->average() / throughput * 100.0;
+    double time = _remainingTasks / throughput;
+    double energy = time * power;
+    if (throughput < 0 || power < 0) {
+      continue;
+    }
+#if STORE_PREDICTIONS
+    _performancePredictions[kv] = throughput;
+    _powerPredictions[kv] = power;
+#endif
+    if (candidate.second) {
+      _feasible = true;
+      if (isBestMinMax(throughput, 0, utilization, power, time, energy,
+                       bestValue) ||
+          !bestKnobsSet) {
+        bestKnobs = kv;
+        bestKnobsSet = true;
+      }
+    } else if (isBestSuboptimal(throughput, 0, utilization, power, time,
+                                energy, bestSuboptimalValue)) {
+      bestSuboptimalKnobs = kv;
+    }
+  }
+
+  if (_feasible) {
+    DEBUG("Best solution found: " << bestKnobs);
+    return bestKnobs;
+  } else {
+    DEBUG("Suboptimal solution found: " << bestSuboptimalKnobs);
+    return bestSuboptimalKnobs;
+  }
+}
+
+KnobsValues SelectorPredictive::applyReconfigurationCost(const KnobsValues &best) {
+  double residence = _p.reconfigurationResidenceTime;
+  if (!residence || _configuration.equal(best)) {
+    return best;
+  }
+  ReconfigurationStats stats = _configuration.getReconfigurationStats();
+  if (!stats.storedTotal()) {
+    // No reconfigurations measured yet.
+    return best;
+  }
+  double cost = stats.getAverageTotal();
+  const KnobsValues current = _configuration.getRealValues();
+  const KnobsValues next = _configuration.getRealValues(best);
+  double currentPower =
+      _samplesSnapshot ? _samplesSnapshot->watts : _samples->average().watts;
+  bool realThroughput = !isPrimaryRequirement(_p.requirements.minUtilization);
+  double bandwidthIn = _bandwidthIn->average();
+
+  // Predictions for the current configuration.
+  double throughput = getThroughputPrediction(current);
+  double latency = getLatencyPrediction(current, throughput);
+  if (realThroughput) {
+    throughput = getRealThroughput(throughput);
+  }
+  double power = getPowerPrediction(current);
+  double utilization = bandwidthIn / throughput * 100.0;
+  double time = _remainingTasks / throughput;
+  double energy = time * power;
+
+  // Predictions for the best configuration, amortising the cost over
+  // the residence time: no tasks are processed while reconfiguring,
+  // and the power consumption is the current one.
+  double nextThroughput = getThroughputPrediction(next);
+  double nextLatency = getLatencyPrediction(next, nextThroughput);
+  if (realThroughput) {
+    nextThroughput = getRealThroughput(nextThroughput);
+  }
+  nextThroughput = nextThroughput * residence / (residence + cost);
+  double nextPower = (getPowerPrediction(next) * residence +
+                      currentPower * cost) / (residence + cost);
+  double nextUtilization = bandwidthIn / nextThroughput * 100.0;
+  double nextTime = _remainingTasks / nextThroughput;
+  double nextEnergy = nextTime * nextPower;
+
+  if (throughput < 0 || power < 0 || nextThroughput < 0 || nextPower < 0) {
+    return best;
+  }
+
+  bool currentFeasible = isFeasibleThroughput(throughput, true) &&
+                         isFeasibleLatency(latency, true) &&
+                         isFeasibleUtilization(utilization, true) &&
+                         isFeasiblePower(power, true) &&
+                         isFeasibleTime(time, true) &&
+                         isFeasibleEnergy(energy, true);
+  bool moveNeeded;
+  if (currentFeasible) {
+    // Moves only if the best one is still feasible and better.
+    double bestValue = initBestValue();
+    isBestMinMax(throughput, latency, utilization, power, time, energy,
+                 bestValue);
+    moveNeeded = isFeasibleThroughput(nextThroughput, true) &&
+                 isFeasibleLatency(nextLatency, true) &&
+                 isFeasibleUtilization(nextUtilization, true) &&
+                 isFeasiblePower(nextPower, true) &&
+                 isFeasibleTime(nextTime, true) &&
+                 isFeasibleEnergy(nextEnergy, true) &&
+                 isBestMinMax(nextThroughput, nextLatency, nextUtilization,
+                              nextPower, nextTime, nextEnergy, bestValue);
+  } else if (_feasible) {
+    // Always leave an unfeasible configuration for a feasible one.
+    moveNeeded = true;
+  } else {
+    double bestValue = initBestSuboptimalValue();
+    isBestSuboptimal(throughput, latency, utilization, power, time, energy,
+                     bestValue);
+    moveNeeded = isBestSuboptimal(nextThroughput, nextLatency,
+                                  nextUtilization, nextPower, nextTime,
+                                  nextEnergy, bestValue);
+  }
+
+  if (moveNeeded) {
+    return best;
+  }
+  DEBUG("Reconfiguration to " << best << " avoided, cost: " << cost);
+  ++_avoidedReconfigurations;
+  return current;
+}
+
 KnobsValues SelectorPredictive::getBestKnobsValues() {
+  if (isPrunedSearchApplicable()) {
+    return applyReconfigurationCost(getBestKnobsValuesPruned());
+  }
   KnobsValues bestKnobs(KNOB_VALUE_REAL);
   KnobsValues bestSuboptimalKnobs = _configuration.getRealValues();
   double bestValue = initBestValue();
@@ -647,24 +955,26 @@ KnobsValues SelectorPredictive::getBestKnobsValues() {
 #endif
   bool bestKnobsSet = false;
   //std::cout << "Getting best." << std::endl;
-  const vector<KnobsValues> &combinations =
-      _configuration.getAllRealCombinations();
-  for (const KnobsValues &currentValues : combinations) {
-    if (!areKnobsValid(currentValues)) {
-      continue;
+  predictAll();
+  bool realThroughput = !isPrimaryRequirement(_p.requirements.minUtilization);
+  double bandwidthIn = _bandwidthIn->average();
+  for (size_t i = 0; i < _batchConfigurations.size(); i++) {
+    const KnobsValues &currentValues = _batchConfigurations[i];
+    double throughputPrediction = _batchThroughput[i];
+    if (realThroughput) {
+      throughputPrediction = getRealThroughput(throughputPrediction);
     }
-
-    double throughputPrediction = getThroughputPrediction(currentValues);
-    double powerPrediction = getPowerPrediction(currentValues);
-    double utilizationPrediction =
-        _bandwidthIn->average() / throughputPrediction * 100.0;
+    double powerPrediction = _batchPower[i];
+    double utilizationPrediction = bandwidthIn / throughputPrediction * 100.0;
     double timePrediction = _remainingTasks / throughputPrediction;
     double energyPrediction = timePrediction * powerPrediction;
+    double latencyPrediction =
+        getLatencyPrediction(currentValues, _batchThroughput[i]);
 
     // Skip negative predictions
     if (throughputPrediction < 0 || powerPrediction < 0 ||
         utilizationPrediction < 0 || timePrediction < 0 ||
-        energyPrediction < 0) {
+        energyPrediction < 0 || latencyPrediction < 0) {
       //std::cout << "Skip negative" << std::endl;
       continue;
     }
@@ -683,15 +993,15 @@ KnobsValues SelectorPredictive::getBestKnobsValues() {
     //	      << powerPrediction << " " << energyPrediction << std::endl;
 #endif
     if (isFeasibleThroughput(throughputPrediction, true) &&
-        isFeasibleLatency(0, true) &&
+        isFeasibleLatency(latencyPrediction, true) &&
         isFeasibleUtilization(utilizationPrediction, true) &&
         isFeasiblePower(powerPrediction, true) &&
         isFeasibleTime(timePrediction, true) &&
         isFeasibleEnergy(energyPrediction, true)) {
       _feasible = true;
-      if (isBestMinMax(throughputPrediction, 0, utilizationPrediction,
-                       powerPrediction, timePrediction, energyPrediction,
-                       bestValue) ||
+      if (isBestMinMax(throughputPrediction, latencyPrediction,
+                       utilizationPrediction, powerPrediction, timePrediction,
+                       energyPrediction, bestValue) ||
           !bestKnobsSet) {
 #ifdef DEBUG_SELECTORS
         bestThroughputPrediction = throughputPrediction;
@@ -700,9 +1010,10 @@ KnobsValues SelectorPredictive::getBestKnobsValues() {
         bestKnobs = currentValues;
         bestKnobsSet = true;
       }
-    } else if (isBestSuboptimal(throughputPrediction, 0, utilizationPrediction,
-                                powerPrediction, timePrediction,
-                                energyPrediction, bestSuboptimalValue)) {
+    } else if (isBestSuboptimal(throughputPrediction, latencyPrediction,
+                                utilizationPrediction, powerPrediction,
+                                timePrediction, energyPrediction,
+                                bestSuboptimalValue)) {
       // TODO In realta' per controllare se e' un sottoottimale
       // migliore bisognerebbe prendere la configurazione che soddisfa
       // il maggior numero di constraints fra quelli specificati.
@@ -720,12 +1031,12 @@ KnobsValues SelectorPredictive::getBestKnobsValues() {
     DEBUG("Best solution found: " << bestKnobs);
     DEBUG("Throughput prediction: " << bestThroughputPrediction);
     DEBUG("Power prediction: " << bestPowerPrediction);
-    return bestKnobs;
+    return applyReconfigurationCost(bestKnobs);
   } else {
     DEBUG("Suboptimal solution found: " << bestSuboptimalKnobs);
     DEBUG("Throughput prediction: " << bestSuboptimalThroughputPrediction);
     DEBUG("Power prediction: " << bestSuboptimalPowerPrediction);
-    return bestSuboptimalKnobs;
+    return applyReconfigurationCost(bestSuboptimalKnobs);
   }
 }
 
@@ -735,6 +1046,75 @@ void SelectorPredictive::refine() {
   if (_p.strategySelection == STRATEGY_SELECTION_LEARNING) {
     _observedValues[_configuration.getRealValues()] = _samples->average();
   }
+  if (_modelStore) {
+    _modelStore->addObservation(_configuration.getRealValues(),
+                                _samples->average());
+  }
+}
+
+bool SelectorPredictive::isStoredConfigurationValid(const KnobsValues &values) {
+  if (!areKnobsValid(values)) {
+    return false;
+  }
+  for (size_t i = 0; i < KNOB_NUM; i++) {
+    vector<double> allowed =
+        _configuration.getKnob((KnobType) i)->getAllowedValues();
+    if (!allowed.empty() &&
+        find(allowed.begin(), allowed.end(), values[(KnobType) i]) ==
+            allowed.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SelectorPredictive::loadModel() {
+  if (!_modelStore->load()) {
+    DEBUG("No model stored in " << _modelStore->getFileName());
+    return;
+  }
+  // Observations are replayed in the order they were collected, since
+  // some models (e.g. USL) need some configurations to be seen first.
+  const vector<StoredObservation> &observations =
+      _modelStore->getObservations();
+  for (const StoredObservation &o : observations) {
+    if (!isStoredConfigurationValid(o.values)) {
+      continue;
+    }
+    _throughputPredictor->refine(o.values, o.sample);
+    _powerPredictor->refine(o.values, o.sample);
+    if (_p.strategySelection == STRATEGY_SELECTION_LEARNING) {
+      _observedValues[o.values] = o.sample;
+    }
+    _modelLoaded = true;
+  }
+  DEBUG("Model loaded from " << _modelStore->getFileName());
+}
+
+bool SelectorPredictive::getWarmStartKnobsValues(KnobsValues &kv) {
+  if (!_modelStore) {
+    return false;
+  }
+  if (!_modelStore->getConfiguration(kv) ||
+      !isStoredConfigurationValid(kv)) {
+    if (!_modelLoaded || !predictorsReady()) {
+      return false;
+    }
+    kv = getBestKnobsValues();
+  }
+  updatePredictions(kv);
+  return true;
+}
+
+void SelectorPredictive::saveModel() {
+  if (!_modelStore) {
+    return;
+  }
+  // The configuration is not stored if it is still being calibrated.
+  if (!isCalibrating()) {
+    _modelStore->setConfiguration(_configuration.getRealValues());
+  }
+  _modelStore->save();
 }
 
 void SelectorPredictive::updatePredictions(const KnobsValues &next) {
@@ -758,6 +1138,9 @@ void SelectorPredictive::clearPredictors() {
   _throughputPrediction = NOT_VALID;
   _powerPrediction = NOT_VALID;
   _observedValues.clear();
+  if (_modelStore) {
+    _modelStore->clearObservations();
+  }
 }
 
 bool SelectorPredictive::isMaxPerformanceConfiguration() const {
@@ -771,7 +1154,7 @@ bool SelectorPredictive::isMaxPerformanceConfiguration() const {
   return _configuration.getRealValues() != _maxPerformanceConfiguration;
 }
 
-bool SelectorLearner::isAccurate() {
+bool SelectorPredictive::isAccurate() {
   double predictedMaxThroughput = _throughputPrediction;
   double predictedPower = _powerPrediction;
 
@@ -834,6 +1217,12 @@ KnobsValues SelectorAnalytical::getNextKnobsValues() {
   KnobsValues kv;
 
   if (!_firstPointGenerated) {
+    if (getWarmStartKnobsValues(kv)) {
+      // Validated by the contract checks on the next samples.
+      _firstPointGenerated = true;
+      DEBUG("Warm start with configuration " << kv);
+      return kv;
+    }
     kv = getBestKnobsValues();
   }
 
@@ -1012,7 +1401,9 @@ SelectorLearner::SelectorLearner(const Parameters &p,
           getPredictor(PREDICTION_THROUGHPUT, p, configuration, samples),
           getPredictor(PREDICTION_POWER, p, configuration, samples)),
       _explorer(NULL), _firstPointGenerated(false), _contractViolations(0),
-      _accuracyViolations(0), _totalCalPoints(0), _updatingInterference(false) {
+      _accuracyViolations(0), _totalCalPoints(0), _updatingInterference(false),
+      _fitter(NULL), _fitReason(FIT_CALIBRATION_END), _fitBack(0),
+      _fitReady(-1), _fitTotalTasks(0), _fitTotalTasksPending(false) {
   /***************************************/
   /*              Explorers              */
   /***************************************/
@@ -1154,13 +1545,109 @@ SelectorLearner::SelectorLearner(const Parameters &p,
 }
 
 SelectorLearner::~SelectorLearner() {
+  if (_fitter) {
+    joinFitter();
+  }
   if (_explorer) {
     delete _explorer;
   }
 }
 
+SelectorLearnerFitter::SelectorLearnerFitter(SelectorLearner &selector)
+    : _selector(selector) {
+  ;
+}
+
+void SelectorLearnerFitter::run() { _selector.fit(); }
+
+void SelectorLearner::fit() {
+  KnobsValues kv = getBestKnobsValues();
+  updatePredictions(kv);
+  _fitResults[_fitBack] = kv;
+  _fitReady.store(_fitBack, std::memory_order_release);
+}
+
+void SelectorLearner::startFitting(FitReason reason) {
+  // The fitter works on the observations collected up to now, the
+  // inputs it needs are not updated until it terminates.
+  _fitReason = reason;
+  _samplesSnapshot = new MonitoredSample(_samples->average());
+  _fitter = new SelectorLearnerFitter(*this);
+  _fitter->start();
+}
+
+bool SelectorLearner::fittingTerminated(KnobsValues &kv) {
+  int ready = _fitReady.exchange(-1, std::memory_order_acquire);
+  if (ready == -1) {
+    return false;
+  }
+  joinFitter();
+  kv = _fitResults[ready];
+  // The next search writes on the other buffer.
+  _fitBack = 1 - ready;
+  return true;
+}
+
+void SelectorLearner::joinFitter() {
+  _fitter->join();
+  delete _fitter;
+  _fitter = NULL;
+  delete _samplesSnapshot;
+  _samplesSnapshot = NULL;
+  if (_fitTotalTasksPending) {
+    _fitTotalTasksPending = false;
+    SelectorPredictive::updateTotalTasks(_fitTotalTasks);
+  }
+}
+
+void SelectorLearner::terminate() {
+  if (_fitter) {
+    // The configuration found is discarded.
+    joinFitter();
+    _fitReady.store(-1, std::memory_order_relaxed);
+  }
+}
+
+void SelectorLearner::updateBandwidthIn() {
+  if (!_fitter) {
+    SelectorPredictive::updateBandwidthIn();
+  }
+}
+
+void SelectorLearner::updateTotalTasks(u_int64_t totalTasks) {
+  if (_fitter) {
+    _fitTotalTasks = totalTasks;
+    _fitTotalTasksPending = true;
+  } else {
+    SelectorPredictive::updateTotalTasks(totalTasks);
+  }
+}
+
 KnobsValues SelectorLearner::getNextKnobsValues() {
   KnobsValues kv;
+  if (_fitter) {
+    // Keep monitoring the current configuration until the fitter finds
+    // the new one.
+    if (!fittingTerminated(kv)) {
+      return _configuration.getRealValues();
+    }
+    switch (_fitReason) {
+    case FIT_CALIBRATION_END: {
+      DEBUG("Finished in " << _numCalibrationPoints
+                           << " steps with configuration " << kv);
+      stopCalibration();
+    } break;
+    case FIT_BANDWIDTH_CHANGE: {
+      _accuracyViolations = 0;
+      _contractViolations = 0;
+      _bandwidthIn->reset();
+      _forced = false;
+      DEBUG("Input bandwidth fluctuations, recomputing best solution.");
+    } break;
+    }
+    _previousConfiguration = _configuration.getRealValues();
+    return kv;
+  }
   if (_updatingInterference) {
 #ifdef ENABLE_GSL
     // It can only be done for PERF_* contract (so is primary) and on USL
@@ -1200,6 +1687,13 @@ KnobsValues SelectorLearner::getNextKnobsValues() {
   if (!_firstPointGenerated) {
     _firstPointGenerated = true;
     startCalibration();
+    if (getWarmStartKnobsValues(kv)) {
+      // Validated (and refined) on the next sample, like the configuration
+      // found at the end of the calibration.
+      ++_numCalibrationPoints;
+      DEBUG("Warm start with configuration " << kv);
+      return kv;
+    }
   } else {
     if (isCalibrating()) {
       refine();
@@ -1212,7 +1706,10 @@ KnobsValues SelectorLearner::getNextKnobsValues() {
       kv = getNextMeaningfulKnobsValues(_explorer);
       ++_numCalibrationPoints;
     } else {
-      if (predictionsDone() && accurate) {
+      if (predictionsDone() && accurate && _p.asyncModelFitting) {
+        startFitting(FIT_CALIBRATION_END);
+        kv = _configuration.getRealValues();
+      } else if (predictionsDone() && accurate) {
         kv = getBestKnobsValues();
         updatePredictions(kv);
         DEBUG("Finished in " << _numCalibrationPoints
@@ -1256,13 +1753,18 @@ KnobsValues SelectorLearner::getNextKnobsValues() {
       /******************* Bandwidth change. *******************/
       refine();
       ++_totalCalPoints;
-      kv = getBestKnobsValues();
-      updatePredictions(kv);
-      _accuracyViolations = 0;
-      _contractViolations = 0;
-      _bandwidthIn->reset();
-      _forced = false;
-      DEBUG("Input bandwidth fluctuations, recomputing best solution.");
+      if (_p.asyncModelFitting) {
+        startFitting(FIT_BANDWIDTH_CHANGE);
+        kv = _configuration.getRealValues();
+      } else {
+        kv = getBestKnobsValues();
+        updatePredictions(kv);
+        _accuracyViolations = 0;
+        _contractViolations = 0;
+        _bandwidthIn->reset();
+        _forced = false;
+        DEBUG("Input bandwidth fluctuations, recomputing best solution.");
+      }
     } else if ((!_p.maxCalibrationTime ||
                 getTotalCalibrationTime() < _p.maxCalibrationTime) &&
                (!_p.maxCalibrationSteps ||
@@ -1352,13 +1854,15 @@ SelectorFixedExploration::SelectorFixedExploration(
     std::unique_ptr<Predictor> powerPredictor, size_t numSamples)
     : SelectorPredictive(p, configuration, samples,
                          std::move(throughputPredictor),
-                         std::move(powerPredictor)) {
-  const std::vector<KnobsValues> &combinations =
-      _configuration.getAllRealCombinations();
-  size_t numConfigurations = combinations.size();
-  for (size_t i = 0; i < numConfigurations;
-       i += ceil((double) numConfigurations / numSamples)) {
-    _confToExplore.push_back(combinations.at(i));
+                         std::move(powerPredictor)),
+      _combinations(_configuration.getRealCombinations()),
+      _explorationStep(1), _numToExplore(0), _warmStarting(false) {
+  size_t numConfigurations = _combinations.size();
+  if (numConfigurations && numSamples) {
+    // Configurations are explored from the last one with this step.
+    _explorationStep = ceil((double) numConfigurations / numSamples);
+    _numToExplore =
+        (numConfigurations + _explorationStep - 1) / _explorationStep;
   }
 }
 
@@ -1368,14 +1872,35 @@ SelectorFixedExploration::~SelectorFixedExploration() {
 
 KnobsValues SelectorFixedExploration::getNextKnobsValues() {
   _previousConfiguration = _configuration.getRealValues();
-  if (_confToExplore.size()) {
+  if (!isCalibrating() && !_numCalibrationPoints) {
+    KnobsValues kv;
+    if (getWarmStartKnobsValues(kv)) {
+      startCalibration();
+      ++_numCalibrationPoints;
+      _warmStarting = true;
+      DEBUG("Warm start with configuration " << kv);
+      return kv;
+    }
+  } else if (_warmStarting) {
+    _warmStarting = false;
+    if (isAccurate()) {
+      refine();
+      _numToExplore = 0;
+      stopCalibration();
+      return _configuration.getRealValues();
+    }
+    // Otherwise the sample refines the models like any other
+    // calibration point, and the exploration starts.
+    DEBUG("Inaccurate stored model, exploring.");
+  }
+  if (_numToExplore) {
     if (!isCalibrating()) {
       startCalibration();
     } else {
       refine();
     }
-    KnobsValues r = _confToExplore.back();
-    _confToExplore.pop_back();
+    --_numToExplore;
+    KnobsValues r = _combinations.at(_numToExplore * _explorationStep);
     ++_numCalibrationPoints;
     return r;
   } else {
@@ -1418,7 +1943,7 @@ SelectorFullSearch::SelectorFullSearch(const Parameters &p,
               PREDICTION_THROUGHPUT, p, configuration, samples)),
           std::unique_ptr<Predictor>(new PredictorFullSearch(
               PREDICTION_POWER, p, configuration, samples)),
-          configuration.getAllRealCombinations().size()) {
+          configuration.getRealCombinations().size()) {
   ;
 }
 
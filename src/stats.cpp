@@ -93,6 +93,10 @@ LoggerStream::LoggerStream(std::ostream *statsStream,
                 << "\t";
   *_statsStream << "PForChunk"
                 << "\t";
+  *_statsStream << "DataflowBatch"
+                << "\t";
+  *_statsStream << "DataflowWindow"
+                << "\t";
   *_statsStream << "CurrentThroughput"
                 << "\t";
   *_statsStream << "SmoothedThroughput"
@@ -153,6 +157,12 @@ LoggerStream::LoggerStream(std::ostream *statsStream,
                   << "\t";
   *_summaryStream << "ReconfigurationsTotalStddev"
                   << "\t";
+  *_summaryStream << "ReconfigurationsStallAverage"
+                  << "\t";
+  *_summaryStream << "ReconfigurationsStallStddev"
+                  << "\t";
+  *_summaryStream << "ReconfigurationsAvoided"
+                  << "\t";
   *_summaryStream << endl;
 }
 
@@ -222,6 +232,22 @@ void LoggerStream::log(bool isCalibrationPhase,
   }
   *_statsStream << "\t";
 
+  for (size_t c = 0; c < configuration.getNumHMP(); c++) {
+    *_statsStream << configuration.getRealValue(c, KNOB_DATAFLOW_BATCH);
+    if (configuration.getNumHMP() > 1) {
+      *_statsStream << "|";
+    }
+  }
+  *_statsStream << "\t";
+
+  for (size_t c = 0; c < configuration.getNumHMP(); c++) {
+    *_statsStream << configuration.getRealValue(c, KNOB_DATAFLOW_WINDOW);
+    if (configuration.getNumHMP() > 1) {
+      *_statsStream << "|";
+    }
+  }
+  *_statsStream << "\t";
+
   *_statsStream << samples.getLastSample().throughput << "\t";
   *_statsStream << ms.throughput << "\t";
   *_statsStream << samples.coefficientVariation().throughput << "\t";
@@ -312,6 +338,23 @@ void LoggerStream::logSummary(const Configuration &configuration,
                     << "\t";
   }
 
+  if (reconfigurationStats.storedStall()) {
+    *_summaryStream << reconfigurationStats.getAverageStall() << "\t";
+    *_summaryStream << reconfigurationStats.getStdDevStall() << "\t";
+  } else {
+    *_summaryStream << "N.D."
+                    << "\t";
+    *_summaryStream << "N.D."
+                    << "\t";
+  }
+
+  if (selector) {
+    *_summaryStream << selector->getAvoidedReconfigurations() << "\t";
+  } else {
+    *_summaryStream << "N.D."
+                    << "\t";
+  }
+
   *_summaryStream << endl;
 }
 
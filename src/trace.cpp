@@ -0,0 +1,246 @@
+/*
+ * trace.cpp
+ *
+ * Created on: 18/10/2026
+ *
+ * =========================================================================
+ *  Copyright (C) 2015-, Daniele De Sensi (d.desensi.software@gmail.com)
+ *
+ *  This file is part of nornir.
+ *
+ *  nornir is free software: you can redistribute it and/or
+ *  modify it under the terms of the Lesser GNU General Public
+ *  License as published by the Free Software Foundation, either
+ *  version 3 of the License, or (at your option) any later version.
+
+ *  nornir is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  Lesser GNU General Public License for more details.
+ *
+ *  You should have received a copy of the Lesser GNU General Public
+ *  License along with nornir.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * =========================================================================
+ */
+
+/*!
+ * \file trace.cpp
+ * \brief Replay of recorded arrival traces.
+ **/
+
+#include <nornir/configuration.hpp>
+#include <nornir/trace.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace nornir {
+
+using namespace std;
+using namespace mammut;
+
+static bool compareArrival(const TraceItem &a, const TraceItem &b) {
+  return a.arrival < b.arrival;
+}
+
+vector<TraceItem> loadTrace(const string &fileName, TraceFormat format,
+                            size_t defaultPayloadSize) {
+  FILE *f = fopen(fileName.c_str(), "r");
+  if (!f) {
+    throw runtime_error("Impossible to open trace file " + fileName);
+  }
+  vector<TraceItem> trace;
+  double rateStart = 0;
+  char line[512];
+  while (fgets(line, 512, f) != NULL) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    double first = 0, second = 0;
+    unsigned long payload = defaultPayloadSize;
+    int read = sscanf(line, "%lf %lf %lu", &first, &second, &payload);
+    if (format == TRACE_FORMAT_TIMESTAMPS) {
+      if (read < 1) {
+        continue;
+      }
+      TraceItem item;
+      item.arrival = first;
+      // The second field is the payload size.
+      item.payloadSize = (read >= 2) ? (size_t)second : defaultPayloadSize;
+      trace.push_back(item);
+    } else {
+      if (read < 2) {
+        continue;
+      }
+      // 'rate' items per second for 'second' seconds, evenly spaced.
+      size_t numItems = (size_t)(first * second);
+      for (size_t i = 0; i < numItems; i++) {
+        TraceItem item;
+        item.arrival = rateStart + i / first;
+        item.payloadSize = payload;
+        trace.push_back(item);
+      }
+      rateStart += second;
+    }
+  }
+  fclose(f);
+  stable_sort(trace.begin(), trace.end(), compareArrival);
+  return trace;
+}
+
+LoggerReconfigurations::LoggerReconfigurations(
+    vector<ReconfigurationEvent> &events)
+    : Logger(0), _events(events) {
+  ;
+}
+
+void LoggerReconfigurations::log(bool isCalibrationPhase,
+                                 const Configuration &configuration,
+                                 const Smoother<MonitoredSample> &samples,
+                                 const Requirements &requirements) {
+  stringstream ss;
+  for (size_t c = 0; c < configuration.getNumHMP(); c++) {
+    for (size_t i = 0; i < KNOB_NUM; i++) {
+      if (i == KNOB_MAPPING) {
+        continue;
+      }
+      ss << configuration.getRealValue(c, (KnobType)i) << " ";
+    }
+    if (configuration.getNumHMP() > 1) {
+      ss << "| ";
+    }
+  }
+  string current = ss.str();
+  if (_events.empty() || current != _lastConfiguration) {
+    ReconfigurationEvent event;
+    event.timestamp = getRelativeTimestamp();
+    event.configuration = current;
+    _events.push_back(event);
+    _lastConfiguration = current;
+  }
+}
+
+void LoggerReconfigurations::logSummary(const Configuration &configuration,
+                                        Selector *selector, ulong durationMs,
+                                        double totalTasks) {
+  ;
+}
+
+static double percentile(const vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+void printTraceReport(const TraceReport &report,
+                      const vector<ReconfigurationEvent> *events,
+                      ostream &out) {
+  out << "Items: " << report.completed << "/" << report.items << endl;
+  out << "Duration (s): " << report.duration << endl;
+  out << "Throughput (items/s): " << report.throughput << endl;
+  out << "Latency avg/p50/p95/p99/max (ms): " << report.latencyAvg << " "
+      << report.latencyP50 << " " << report.latencyP95 << " "
+      << report.latencyP99 << " " << report.latencyMax << endl;
+  out << "Energy (J): " << report.joules << endl;
+  out << "Reconfigurations: " << report.reconfigurations << endl;
+  if (events) {
+    for (size_t i = 0; i < events->size(); i++) {
+      out << events->at(i).timestamp << "\t" << events->at(i).configuration
+          << endl;
+    }
+  }
+}
+
+TraceReplayer::TraceReplayer(const vector<TraceItem> &trace,
+                             const vector<ReconfigurationEvent> *events)
+    : _trace(trace), _latencies(trace.size(), -1),
+      _completions(trace.size(), 0), _next(0), _start(0), _counter(NULL),
+      _startJoules(0), _events(events) {
+  // A separate counter, the one of the manager is reset at each sample.
+  energy::Energy *energy = _mammut.getInstanceEnergy();
+  if (energy) {
+    _counter = energy->getCounter();
+  }
+}
+
+const TraceItem &TraceReplayer::getItem(size_t id) const {
+  return _trace[id];
+}
+
+bool TraceReplayer::hasNext() const { return _next < _trace.size(); }
+
+bool TraceReplayer::poll(size_t &id) {
+  if (!hasNext()) {
+    return false;
+  }
+  double now = utils::getMillisecondsTime();
+  if (!_start) {
+    _start = now;
+    if (_counter) {
+      _startJoules = _counter->getJoules();
+    }
+  }
+  if (now - _start < _trace[_next].arrival * 1000.0) {
+    return false;
+  }
+  id = _next++;
+  return true;
+}
+
+bool TraceReplayer::next(size_t &id) {
+  while (hasNext()) {
+    if (poll(id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TraceReplayer::completed(size_t id) {
+  double now = utils::getMillisecondsTime();
+  _completions[id] = now;
+  _latencies[id] = now - (_start + _trace[id].arrival * 1000.0);
+}
+
+TraceReport TraceReplayer::getReport() {
+  TraceReport report;
+  report.items = _trace.size();
+  report.joules = 0;
+  if (_counter && _start) {
+    report.joules = _counter->getJoules() - _startJoules;
+  }
+  report.reconfigurations = 0;
+  if (_events && !_events->empty()) {
+    // The first event is the initial configuration.
+    report.reconfigurations = _events->size() - 1;
+  }
+
+  vector<double> latencies;
+  double lastCompletion = _start;
+  double sum = 0;
+  for (size_t i = 0; i < _latencies.size(); i++) {
+    if (_latencies[i] >= 0) {
+      latencies.push_back(_latencies[i]);
+      sum += _latencies[i];
+      lastCompletion = max(lastCompletion, _completions[i]);
+    }
+  }
+  sort(latencies.begin(), latencies.end());
+  report.completed = latencies.size();
+  report.duration = (lastCompletion - _start) / 1000.0;
+  report.throughput = report.duration ? report.completed / report.duration : 0;
+  report.latencyAvg = latencies.empty() ? 0 : sum / latencies.size();
+  report.latencyP50 = percentile(latencies, 0.5);
+  report.latencyP95 = percentile(latencies, 0.95);
+  report.latencyP99 = percentile(latencies, 0.99);
+  report.latencyMax = latencies.empty() ? 0 : latencies.back();
+  return report;
+}
+
+} // namespace nornir
@@ -130,3 +130,75 @@ TEST(ConfigurationTest, HMPTest) {
     }
     EXPECT_FALSE(configuration3.knobsChangeNeeded());
 }
+
+TEST(ConfigurationTest, LazyCombinations) {
+    Parameters  p = getParameters("repara");
+    p.strategyUnusedVirtualCores = STRATEGY_UNUSED_VC_OFF;
+    p.knobHyperthreadingEnabled = true;
+    ConfigurationExternal configuration(p);
+    dynamic_cast<KnobMappingExternal*>(configuration.getKnob(KNOB_MAPPING))->setPid(getpid());
+    dynamic_cast<KnobClkModEmulated*>(configuration.getKnob(KNOB_CLKMOD))->setPid(getpid());
+    configuration.createAllRealCombinations();
+    const std::vector<KnobsValues>& all = configuration.getAllRealCombinations();
+    KnobsCombinations combinations = configuration.getRealCombinations();
+
+    // Reference cartesian product of the allowed values, the last knob
+    // changes faster.
+    static_assert(KNOB_NUM == 8, "Please update the reference combinations.");
+    std::vector<double> v[KNOB_NUM];
+    for(size_t i = 0; i < KNOB_NUM; i++){
+        v[i] = configuration.getKnob((KnobType) i)->getAllowedValues();
+    }
+    std::vector<KnobsValues> expected;
+    for(double vc : v[KNOB_VIRTUAL_CORES]){
+        for(double ht : v[KNOB_HYPERTHREADING]){
+            for(double mapping : v[KNOB_MAPPING]){
+                for(double frequency : v[KNOB_FREQUENCY]){
+                    for(double clkmod : v[KNOB_CLKMOD]){
+                        for(double chunk : v[KNOB_PFOR_CHUNK]){
+                            for(double batch : v[KNOB_DATAFLOW_BATCH]){
+                                for(double window : v[KNOB_DATAFLOW_WINDOW]){
+                                    KnobsValues kv(KNOB_VALUE_REAL);
+                                    kv[KNOB_VIRTUAL_CORES] = vc;
+                                    kv[KNOB_HYPERTHREADING] = ht;
+                                    kv[KNOB_MAPPING] = mapping;
+                                    kv[KNOB_FREQUENCY] = frequency;
+                                    kv[KNOB_CLKMOD] = clkmod;
+                                    kv[KNOB_PFOR_CHUNK] = chunk;
+                                    kv[KNOB_DATAFLOW_BATCH] = batch;
+                                    kv[KNOB_DATAFLOW_WINDOW] = window;
+                                    expected.push_back(kv);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(combinations.size(), expected.size());
+    EXPECT_EQ(all.size(), expected.size());
+
+    size_t index = 0;
+    for(const KnobsValues& kv : combinations){
+        ASSERT_LT(index, expected.size());
+        KnobsValues random = combinations.at(index);
+        for(size_t i = 0; i < KNOB_NUM; i++){
+            EXPECT_EQ(kv[(KnobType) i], expected[index][(KnobType) i]);
+            EXPECT_EQ(random[(KnobType) i], expected[index][(KnobType) i]);
+            EXPECT_EQ(all.at(index)[(KnobType) i], expected[index][(KnobType) i]);
+        }
+        size_t id;
+        EXPECT_TRUE(combinations.getIndex(kv, id));
+        EXPECT_EQ(id, index);
+        ++index;
+    }
+    EXPECT_EQ(index, expected.size());
+
+    KnobsValues missing = combinations.at(0);
+    missing[KNOB_FREQUENCY] = -1;
+    size_t id;
+    EXPECT_FALSE(combinations.getIndex(missing, id));
+    EXPECT_TRUE(combinations == configuration.getRealCombinations());
+}
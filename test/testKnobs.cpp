@@ -3,11 +3,14 @@
  **/
 #include "parametersLoader.hpp"
 #include <algorithm>
+#include <atomic>
 #include <limits.h>
 #include <stdlib.h>
 #include <time.h>
 #include <sstream>
+#include <unistd.h>
 #include <nornir/nornir.hpp>
+#include <nornir/selectors.hpp>
 #include <nornir/trigger.hpp>
 #include "gtest/gtest.h"
 
@@ -486,3 +489,113 @@ TEST(KnobsTest, GlobalUnusedSame){
         EXPECT_EQ(d->getCurrentFrequencyUserspace(), (Frequency) 1800000);
     }
 }
+
+#define THROTTLING_WORKERS 4
+static std::atomic<bool> throttlingStop(false);
+static std::atomic<unsigned long long> throttlingProcessed[THROTTLING_WORKERS];
+
+class ThrottlingEmitter: public nornir::Scheduler<int>{
+private:
+    int _task;
+public:
+    int* schedule(){
+        if(throttlingStop){
+            return lastElement();
+        }
+        usleep(50);
+        return &_task;
+    }
+};
+
+class ThrottlingWorker: public nornir::Worker<int>{
+private:
+    size_t _id;
+public:
+    explicit ThrottlingWorker(size_t id):_id(id){;}
+
+    void compute(int* task){
+        ++throttlingProcessed[_id];
+    }
+};
+
+static void setThrottlingWorkers(double relative){
+    KnobsValues kv(KNOB_VALUE_RELATIVE);
+    for(size_t i = 0; i < KNOB_NUM; i++){
+        kv[(KnobType) i] = 100;
+    }
+    kv[KNOB_VIRTUAL_CORES] = relative;
+    std::ofstream control(getSelectorManualCliControlFile().c_str());
+    control << kv;
+    control.close();
+}
+
+// Waits until all the workers in [first, last) processed new tasks.
+static bool waitThrottlingProgress(size_t first, size_t last){
+    unsigned long long start[THROTTLING_WORKERS];
+    for(size_t i = first; i < last; i++){
+        start[i] = throttlingProcessed[i];
+    }
+    for(size_t t = 0; t < 1000; t++){
+        bool progress = true;
+        for(size_t i = first; i < last; i++){
+            progress = progress && throttlingProcessed[i] > start[i];
+        }
+        if(progress){
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+// Waits until the workers in [first, last) don't process tasks anymore.
+static bool waitThrottlingParked(size_t first, size_t last){
+    for(size_t t = 0; t < 50; t++){
+        unsigned long long start[THROTTLING_WORKERS];
+        for(size_t i = first; i < last; i++){
+            start[i] = throttlingProcessed[i];
+        }
+        usleep(200000);
+        bool parked = true;
+        for(size_t i = first; i < last; i++){
+            parked = parked && throttlingProcessed[i] == start[i];
+        }
+        if(parked){
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST(KnobsTest, DrainFreeThrottling){
+    Parameters p = getParameters("repara");
+    p.strategySelection = STRATEGY_SELECTION_MANUAL_CLI;
+    p.drainFreeThrottling = true;
+    p.samplingIntervalCalibration = 10;
+    p.samplingIntervalSteady = 10;
+    for(size_t i = 0; i < THROTTLING_WORKERS; i++){
+        throttlingProcessed[i] = 0;
+    }
+    setThrottlingWorkers(100);
+
+    nornir::Farm<int> farm(&p);
+    farm.addScheduler(new ThrottlingEmitter());
+    for(size_t i = 0; i < THROTTLING_WORKERS; i++){
+        farm.addWorker(new ThrottlingWorker(i));
+    }
+    farm.start();
+    EXPECT_TRUE(waitThrottlingProgress(0, THROTTLING_WORKERS));
+
+    // Only the first worker keeps receiving tasks, the others park.
+    setThrottlingWorkers(0);
+    EXPECT_TRUE(waitThrottlingParked(1, THROTTLING_WORKERS));
+    EXPECT_TRUE(waitThrottlingProgress(0, 1));
+
+    // Parked workers resume.
+    setThrottlingWorkers(100);
+    EXPECT_TRUE(waitThrottlingProgress(0, THROTTLING_WORKERS));
+
+    throttlingStop = true;
+    farm.wait();
+    remove(getSelectorManualCliControlFile().c_str());
+}
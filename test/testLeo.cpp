@@ -0,0 +1,206 @@
+/**
+ *  Different tests on the LEO predictor.
+ **/
+#include "gtest/gtest.h"
+
+#ifdef ENABLE_ARMADILLO
+#include <cfloat>
+#include <nornir/leo.h>
+
+using namespace arma;
+
+#define LEO_TEST_TOLERANCE 1e-6
+#define LEO_TEST_REFINEMENTS 6
+
+std::string getLeoDataPath(){
+    return "./validationdata/repara/gcc-pthreads-nornir/blackscholes/perf_bandwidth/leo/";
+}
+
+/**
+ * The LEO computation as it was before the Cholesky solves, with the
+ * explicit inverses. It is only used as a reference for the predictions.
+ **/
+class ReferenceLeo{
+private:
+    mat _data;
+    uint _appId;
+    bool _perColumnNormalization;
+    vec _mu;
+    mat _C;
+    double _sigma;
+
+    static double minNonZero(const mat& data){
+        double min = DBL_MAX;
+        for(auto& val : data){
+            if(val && val < min){
+                min = val;
+            }
+        }
+        return min;
+    }
+
+    static mat normalize(const mat& data){
+        double min = minNonZero(data);
+        double max = data.max();
+        mat copy = data;
+        for(auto& val : copy){
+            if(val){
+                val = 100.0 - ((100.0 * (max - val)) / (max - min));
+            }
+        }
+        return copy;
+    }
+
+    static vec denormalize(const vec& v, const mat& origData){
+        double min = minNonZero(origData);
+        double max = origData.max();
+        vec copy = v;
+        for(auto& val : copy){
+            val = max + (((val - 100.0) * (max - min)) / 100.0);
+        }
+        return copy;
+    }
+
+    vec em(const mat& W, const mat& y, int iterations){
+        int n = y.n_rows;
+        int m = y.n_cols;
+        int numSamples = accu(W);
+        mat I = diagmat(W);
+        mat wl;
+        for(int it = 0; it < iterations; it++){
+            mat Cinv = inv(_C);
+            mat Cl0 = inv(I / _sigma + Cinv);
+            mat Cll = inv(eye<mat>(n, n) / _sigma + Cinv);
+            wl = (Cll / _sigma) * y + repmat(Cinv * _mu, 1, m);
+            wl.col(0) = Cl0 * (y.col(0) / _sigma + Cinv * _mu);
+            double normSum = pow(norm(I * (y.col(0) - wl.col(0)), 2), 2) +
+                             trace(I * Cl0);
+            mat ClSum = eye<mat>(n, n) + Cl0 + (m - 1) * Cll;
+            mat wlSumCov = eye<mat>(n, n) +
+                           (wl.col(0) - _mu) * trans(wl.col(0) - _mu);
+            for(int l = 1; l < m; l++){
+                wlSumCov = wlSumCov + (wl.col(l) - _mu) * trans(wl.col(l) - _mu);
+                normSum = normSum + pow(norm(y.col(l) - wl.col(l), 2), 2) +
+                          trace(Cll);
+            }
+            _mu = (1.0 / (1.0 + m)) * sum(wl, 1);
+            _C = (1.0 / (1.0 + m)) * (_mu * trans(_mu) + eye<mat>(n, n) +
+                                      ClSum + wlSumCov);
+            _sigma = (1.0 / ((m - 1) * n + numSamples)) * normSum;
+        }
+        return wl.col(0);
+    }
+public:
+    ReferenceLeo(const mat& data, uint appId, bool perColumnNormalization):
+        _data(data), _appId(appId),
+        _perColumnNormalization(perColumnNormalization){
+        reset();
+    }
+
+    void reset(){
+        _mu = zeros<vec>(_data.n_rows);
+        _C = eye<mat>(_data.n_rows, _data.n_rows);
+        _sigma = 1;
+    }
+
+    vec compute(const vec& sampledData, int iterations){
+        mat data = _data;
+        mat W = zeros<vec>(data.n_rows);
+        for(size_t i = 0; i < sampledData.n_elem; i++){
+            if(sampledData(i)){
+                W(i) = 1;
+            }
+        }
+        data.col(_appId) = sampledData;
+        data.swap_cols(0, _appId);
+        mat normData;
+        if(_perColumnNormalization){
+            normData.set_size(data.n_rows, data.n_cols);
+            for(size_t i = 0; i < data.n_cols; i++){
+                normData.col(i) = normalize(data.col(i));
+            }
+        }else{
+            normData = normalize(data);
+        }
+        vec w = em(W, normData, iterations);
+        if(_perColumnNormalization){
+            return denormalize(w, data.col(0));
+        }else{
+            return denormalize(w, data);
+        }
+    }
+};
+
+double getMaxRelativeError(const vec& a, const vec& b, double range){
+    return max(abs(a - b)) / range;
+}
+
+// Same metric used by leo::compute, on the real values.
+double getAccuracy(const vec& predicted, const vec& real){
+    double n = real.n_elem;
+    double rss = pow(norm(real - predicted, 2), 2);
+    double tss = pow(norm(real - mean(real), 2), 2);
+    return (1 - (rss / tss) * (n - 1) / (n - 2)) * 100.0;
+}
+
+/**
+ * Samples about 20 configurations (as PredictorLeo does), then refines
+ * the model by adding one sample at a time. Cold and warm predictions must
+ * match the explicit inverses path, and warm starting must not be less
+ * accurate than recomputing the model from scratch.
+ **/
+void checkLeo(const std::string& dataFile, uint appId, bool perColumnNormalization){
+    mat data;
+    ASSERT_TRUE(data.load(dataFile));
+    ASSERT_LT(appId, data.n_cols);
+    size_t n = data.n_rows;
+    vec real = data.col(appId);
+    double range = real.max() - real.min();
+    size_t step = n / 20 + 1;
+    vec sampled = zeros<vec>(n);
+    for(size_t i = 0; i < n; i += step){
+        sampled(i) = real(i);
+    }
+
+    leo::Model model(appId, dataFile, perColumnNormalization);
+    ReferenceLeo reference(data, appId, perColumnNormalization);
+    ReferenceLeo referenceCold(data, appId, perColumnNormalization);
+
+    // Cold start.
+    leo::PredictionResults pr = model.compute(&sampled);
+    vec expected = reference.compute(sampled, 5);
+    EXPECT_LT(getMaxRelativeError(pr.predictions, expected, range),
+              LEO_TEST_TOLERANCE);
+
+    // Warm refinements.
+    for(size_t r = 0; r < LEO_TEST_REFINEMENTS; r++){
+        size_t conf = 1 + r * step;
+        ASSERT_LT(conf, n);
+        sampled(conf) = real(conf);
+        pr = model.compute(&sampled);
+        expected = reference.compute(sampled, 2);
+        EXPECT_LT(getMaxRelativeError(pr.predictions, expected, range),
+                  LEO_TEST_TOLERANCE);
+    }
+    vec cold = referenceCold.compute(sampled, 5);
+    EXPECT_GE(getAccuracy(pr.predictions, real), getAccuracy(cold, real));
+
+    // After a reset the model starts again from scratch.
+    model.reset();
+    pr = model.compute(&sampled);
+    EXPECT_LT(getMaxRelativeError(pr.predictions, cold, range),
+              LEO_TEST_TOLERANCE);
+}
+
+TEST(LeoTest, Throughput) {
+    for(uint appId : {0, 3}){
+        checkLeo(getLeoDataPath() + "leo_performance_raw.csv", appId, true);
+    }
+}
+
+TEST(LeoTest, Power) {
+    for(uint appId : {0, 3}){
+        checkLeo(getLeoDataPath() + "leo_power_raw.csv", appId, false);
+    }
+}
+#endif
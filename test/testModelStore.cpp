@@ -0,0 +1,65 @@
+/**
+ *  Different tests on the model store.
+ **/
+#include "parametersLoader.hpp"
+#include <stdio.h>
+#include <nornir/nornir.hpp>
+#include "gtest/gtest.h"
+
+using namespace nornir;
+
+TEST(ModelStoreTest, SaveLoad) {
+    Parameters p = getParameters("repara");
+    p.modelStorePath = "/tmp";
+    p.modelStoreName = "testModelStore";
+    p.requirements.throughput = 100;
+    p.requirements.maxUtilization = NORNIR_REQUIREMENT_MAX;
+
+    KnobsValues a(KNOB_VALUE_REAL), b(KNOB_VALUE_REAL);
+    a[KNOB_VIRTUAL_CORES] = 4;
+    a[KNOB_FREQUENCY] = 2400000;
+    b[KNOB_VIRTUAL_CORES] = 8;
+    b[KNOB_FREQUENCY] = 1200000;
+    MonitoredSample sample;
+    sample.watts = 60.5;
+    sample.throughput = 1 / 3.0;
+    sample.tailLatency = 1234.5;
+
+    ModelStore store(p);
+    remove(store.getFileName().c_str());
+    EXPECT_FALSE(store.load());
+    store.addObservation(b, sample);
+    store.addObservation(a, sample);
+    // Replaces the first observation, without changing the order.
+    sample.watts = 70;
+    store.addObservation(b, sample);
+    store.setConfiguration(a);
+    store.save();
+
+    ModelStore loaded(p);
+    ASSERT_TRUE(loaded.load());
+    ASSERT_EQ(loaded.getObservations().size(), 2u);
+    EXPECT_TRUE(loaded.getObservations()[0].values == b);
+    EXPECT_EQ(loaded.getObservations()[0].sample.watts, 70);
+    EXPECT_TRUE(loaded.getObservations()[1].values == a);
+    EXPECT_EQ(loaded.getObservations()[1].sample.throughput, 1 / 3.0);
+    EXPECT_EQ(loaded.getObservations()[1].sample.tailLatency, 1234.5);
+    KnobsValues kv(KNOB_VALUE_REAL);
+    ASSERT_TRUE(loaded.getConfiguration(kv));
+    EXPECT_TRUE(kv == a);
+
+    // No configuration for different requirements.
+    Parameters q = p;
+    q.requirements.throughput = 50;
+    ModelStore other(q);
+    EXPECT_TRUE(other.load());
+    EXPECT_FALSE(other.getConfiguration(kv));
+
+    // Nothing is loaded on a different architecture.
+    Parameters r = p;
+    r.archData.idlePower += 1;
+    ModelStore otherArch(r);
+    EXPECT_FALSE(otherArch.load());
+
+    remove(store.getFileName().c_str());
+}
@@ -18,11 +18,14 @@ using namespace mammut::task;
 using namespace mammut::topology;
 using namespace mammut::utils;
 
-void runTest(int startloop, int endloop, int step, int chunksize, uint loopDuration = 0){
+void runTest(int startloop, int endloop, int step, int chunksize, uint loopDuration = 0,
+             bool workStealing = false, bool persistentTeam = false){
     int nworkers = 4;
     std::vector<uint> v;
     nornir::Parameters p = getParameters("repara");
     p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    p.pforWorkStealing = workStealing;
+    p.pforPersistentTeam = persistentTeam;
     nornir::ParallelFor pf(nworkers, &p);
     size_t iterations = 10;
     if(loopDuration){
@@ -68,4 +71,106 @@ TEST(ParallelForTest, DynamicChunk3){
 
 TEST(ParallelForTest, LongLoop10Seconds){
     runTest(0, 100, 1, 0, 10);
-}
\ No newline at end of file
+}
+
+TEST(ParallelForTest, WorkStealing){
+    runTest(0, 100, 1, 0, 0, true);
+}
+
+TEST(ParallelForTest, WorkStealingStep3){
+    runTest(0, 100, 3, 0, 0, true);
+}
+
+TEST(ParallelForTest, WorkStealingChunk1){
+    runTest(0, 1000, 1, 1, 0, true);
+}
+
+TEST(ParallelForTest, WorkStealingFewIterations){
+    runTest(0, 3, 1, 0, 0, true);
+}
+
+TEST(ParallelForTest, PersistentTeam){
+    runTest(0, 100, 1, 0, 0, false, true);
+}
+
+TEST(ParallelForTest, PersistentTeamChunk3){
+    runTest(0, 100, 3, 3, 0, false, true);
+}
+
+TEST(ParallelForTest, PersistentTeamWorkStealing){
+    runTest(0, 1000, 1, 1, 0, true, true);
+}
+
+TEST(ParallelForTest, WorkStealingUnbalanced){
+    int nworkers = 4, iterations = 1000;
+    nornir::Parameters p = getParameters("repara");
+    p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    p.pforWorkStealing = true;
+    nornir::ParallelFor pf(nworkers, &p);
+    std::vector<std::atomic<uint>> v(iterations);
+    for(auto& x : v){
+        x = 0;
+    }
+    // All the work is in the block of the first worker.
+    pf.parallel_for(0, iterations, 1, 1,
+    [&](long long int idx, long long int id){
+        if(idx < iterations / nworkers){
+            usleep(1000);
+        }
+        ++v[idx];
+    });
+    for(auto& x : v){
+        EXPECT_EQ(x, (uint) 1);
+    }
+}
+
+void runReduceTest(bool workStealing){
+    nornir::Parameters p = getParameters("repara");
+    p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    p.pforWorkStealing = workStealing;
+    nornir::ParallelFor pf(4, &p);
+    for(size_t i = 0; i < 10; i++){
+        long long int sum = pf.parallel_reduce(0, 1000, 1, 0, (long long int) 0,
+        [](long long int idx, long long int& acc){
+            acc += idx;
+        },
+        [](long long int a, long long int b){
+            return a + b;
+        });
+        EXPECT_EQ(sum, 499500);
+    }
+}
+
+TEST(ParallelForTest, Reduce){
+    runReduceTest(false);
+}
+
+TEST(ParallelForTest, ReduceWorkStealing){
+    runReduceTest(true);
+}
+
+TEST(ParallelForTest, Scan){
+    nornir::Parameters p = getParameters("repara");
+    p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    nornir::ParallelFor pf(4, &p);
+    std::vector<long long int> v(100, 0);
+    pf.parallel_scan(0, 100, 3, (long long int) 0,
+    [](long long int idx){
+        return idx;
+    },
+    [](long long int a, long long int b){
+        return a + b;
+    },
+    [&](long long int idx, long long int prefix){
+        v[idx] = prefix;
+    });
+    long long int expected = 0;
+    for(int j = 0; j < 100; j++){
+        if(j % 3 == 0){
+            expected += j;
+            EXPECT_EQ(v[j], expected);
+        }else{
+            EXPECT_EQ(v[j], 0);
+        }
+    }
+}
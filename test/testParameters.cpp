@@ -79,8 +79,20 @@ TEST(ParametersTest, SimpleTest) {
     // Ok latency
     p.requirements.latency = 100;
     EXPECT_EQ(p.validate(), VALIDATION_OK);
+
+    // Wrong latency percentile
+    p.requirements.latencyPercentile = 101;
+    EXPECT_EQ(p.validate(), VALIDATION_WRONG_REQUIREMENT);
+
+    // Ok latency percentile
+    p.requirements.latencyPercentile = 99;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
     p.requirements.latency = NORNIR_REQUIREMENT_UNDEF;
 
+    // Latency percentile without latency
+    EXPECT_EQ(p.validate(), VALIDATION_WRONG_REQUIREMENT);
+    p.requirements.latencyPercentile = NORNIR_REQUIREMENT_UNDEF;
+
     // Wrong power
     p.requirements.powerConsumption = -1;
     EXPECT_EQ(p.validate(), VALIDATION_WRONG_REQUIREMENT);
@@ -108,4 +120,51 @@ TEST(ParametersTest, SimpleTest) {
     p.requirements.throughput = NORNIR_REQUIREMENT_UNDEF;
     p.requirements.latency = NORNIR_REQUIREMENT_UNDEF;
     p.requirements.powerConsumption = NORNIR_REQUIREMENT_UNDEF;
+
+    // Adaptive sampling interval
+    p.requirements.powerConsumption = NORNIR_REQUIREMENT_MIN;
+    p.samplingIntervalAdaptive = true;
+    p.queueHighWaterMark = 0;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.queueHighWaterMark = 90;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
+    p.samplingIntervalAdaptive = false;
+
+    // Drain-free throttling
+    p.drainFreeThrottling = true;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
+    p.triggerQBlocking = TRIGGER_Q_BLOCKING_YES;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.triggerQBlocking = TRIGGER_Q_BLOCKING_NO;
+    p.drainFreeThrottling = false;
+
+    // Dataflow batching
+    p.dataflow.batchSize = 0;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.dataflow.batchSize = p.dataflow.maxBatchSize + 1;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.dataflow.batchSize = 1;
+    p.knobDataflowBatchEnabled = true;
+    // Not supported by the predictors.
+    EXPECT_EQ(p.validate(), VALIDATION_UNSUPPORTED_KNOBS);
+    p.strategySelection = STRATEGY_SELECTION_FULLSEARCH;
+    p.knobPforChunkEnabled = true;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.knobPforChunkEnabled = false;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
+    // Batch and window can be tuned together.
+    p.knobDataflowWindowEnabled = true;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
+    p.knobDataflowBatchEnabled = false;
+    EXPECT_EQ(p.validate(), VALIDATION_OK);
+    p.knobPforChunkEnabled = true;
+    EXPECT_EQ(p.validate(), VALIDATION_NO);
+    p.knobPforChunkEnabled = false;
+    p.knobDataflowWindowEnabled = false;
+    // The full search doesn't explore the parallel for chunk.
+    p.knobPforChunkEnabled = true;
+    EXPECT_EQ(p.validate(), VALIDATION_UNSUPPORTED_KNOBS);
+    p.knobPforChunkEnabled = false;
+    p.strategySelection = STRATEGY_SELECTION_LEARNING;
+    p.requirements.powerConsumption = NORNIR_REQUIREMENT_UNDEF;
 }
@@ -0,0 +1,200 @@
+/**
+ *  Different tests on predictors.
+ **/
+#include "parametersLoader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <nornir/nornir.hpp>
+#include <nornir/predictors.hpp>
+#include "gtest/gtest.h"
+
+using namespace nornir;
+
+#ifdef ENABLE_MLPACK
+#define PREDICTORS_TEST_TOLERANCE 1e-3
+
+class LinearRegressionTest: public ::testing::Test{
+protected:
+    Parameters _p;
+    ConfigurationExternal* _configuration;
+    MovingAverageSimple<MonitoredSample> _samples;
+    bool _lockMapping;
+    // Observed configurations.
+    std::vector<KnobsValues> _observed;
+
+    LinearRegressionTest():_p(getParameters("repara")), _configuration(NULL),
+                           _samples(1), _lockMapping(true){;}
+
+    void SetUp(){
+        _p.strategyUnusedVirtualCores = STRATEGY_UNUSED_VC_OFF;
+        _configuration = new ConfigurationExternal(_p);
+        dynamic_cast<KnobMappingExternal*>(_configuration->getKnob(KNOB_MAPPING))->setPid(getpid());
+        dynamic_cast<KnobClkModEmulated*>(_configuration->getKnob(KNOB_CLKMOD))->setPid(getpid());
+        if(_lockMapping){
+            _configuration->getKnob(KNOB_MAPPING)->lock(MAPPING_TYPE_LINEAR);
+        }
+        _configuration->getKnob(KNOB_HYPERTHREADING)->lock(_p.knobHyperthreadingFixedValue);
+        for(KnobType t : {KNOB_CLKMOD, KNOB_PFOR_CHUNK, KNOB_DATAFLOW_BATCH, KNOB_DATAFLOW_WINDOW}){
+            _configuration->getKnob(t)->lockToMax();
+        }
+        // One configuration every three, both the number of cores and the
+        // frequency change between the observations.
+        size_t i = 0;
+        for(const KnobsValues& kv : _configuration->getRealCombinations()){
+            if(i++ % 3 == 0){
+                _observed.push_back(kv);
+            }
+        }
+    }
+
+    void TearDown(){
+        delete _configuration;
+    }
+
+    // Service time linear in the predictors of the Amdahl model, with
+    // different coefficients for each mapping.
+    static double getServiceTime(const KnobsValues& kv){
+        double frequency = kv[KNOB_FREQUENCY] / 1000000.0;
+        return (0.001 + 0.01 / frequency +
+                0.05 / (kv[KNOB_VIRTUAL_CORES] * frequency)) *
+               (1 + kv[KNOB_MAPPING]);
+    }
+
+    static MonitoredSample getSample(const KnobsValues& kv){
+        MonitoredSample sample;
+        sample.throughput = 1.0 / getServiceTime(kv);
+        sample.loadPercentage = 100;
+        sample.inconsistent = false;
+        sample.watts = 0;
+        sample.latency = 1;
+        return sample;
+    }
+
+    void fit(Predictor& predictor){
+        for(const KnobsValues& kv : _observed){
+            predictor.refine(kv, getSample(kv));
+        }
+        ASSERT_TRUE(predictor.readyForPredictions());
+        predictor.prepareForPredictions();
+    }
+
+    /**
+     * Checks that the batch predictions match the single ones, also when
+     * the model or the set of configurations change.
+     **/
+    void checkBatch(Predictor& predictor){
+        std::vector<KnobsValues> configurations;
+        for(const KnobsValues& kv : _configuration->getRealCombinations()){
+            configurations.push_back(kv);
+        }
+        std::vector<double> predictions;
+        predictor.predictBatch(configurations, 1, predictions);
+        checkBatch(predictor, configurations, predictions);
+
+        // Same configurations, different model.
+        for(const KnobsValues& kv : configurations){
+            MonitoredSample sample = getSample(kv);
+            sample.throughput *= 2;
+            predictor.refine(kv, sample);
+        }
+        predictor.prepareForPredictions();
+        predictor.predictBatch(configurations, 1, predictions);
+        checkBatch(predictor, configurations, predictions);
+
+        // Different configurations in the same vector.
+        configurations.resize(configurations.size() / 2);
+        std::reverse(configurations.begin(), configurations.end());
+        predictor.predictBatch(configurations, 2, predictions);
+        checkBatch(predictor, configurations, predictions);
+        configurations.pop_back();
+        predictor.predictBatch(configurations, 0, predictions);
+        checkBatch(predictor, configurations, predictions);
+    }
+
+    void checkBatch(Predictor& predictor,
+                    const std::vector<KnobsValues>& configurations,
+                    const std::vector<double>& predictions){
+        ASSERT_EQ(predictions.size(), configurations.size());
+        for(size_t i = 0; i < configurations.size(); i++){
+            double expected = predictor.predict(configurations[i]);
+            EXPECT_NEAR(predictions[i], expected,
+                        std::abs(expected) * PREDICTORS_TEST_TOLERANCE);
+        }
+    }
+};
+
+class RegressionMappingTest: public LinearRegressionTest{
+protected:
+    void SetUp(){
+        _lockMapping = false;
+        LinearRegressionTest::SetUp();
+    }
+};
+
+/**
+ * The recursive least squares must give the same model as the fit over
+ * all the observations.
+ **/
+TEST_F(LinearRegressionTest, Incremental){
+    Parameters batchP = _p, incrementalP = _p;
+    batchP.regressionIncremental = false;
+    incrementalP.regressionIncremental = true;
+    PredictorLinearRegression batch(PREDICTION_THROUGHPUT, batchP, *_configuration, &_samples);
+    PredictorLinearRegression incremental(PREDICTION_THROUGHPUT, incrementalP, *_configuration, &_samples);
+    fit(batch);
+    fit(incremental);
+    for(const KnobsValues& kv : _configuration->getRealCombinations()){
+        double expected = batch.predict(kv);
+        EXPECT_NEAR(incremental.predict(kv), expected,
+                    expected * PREDICTORS_TEST_TOLERANCE);
+        EXPECT_NEAR(expected, 1.0 / getServiceTime(kv),
+                    expected * PREDICTORS_TEST_TOLERANCE);
+    }
+}
+
+/**
+ * The predictions computed with the coefficients must match the ones of
+ * the mlpack model fitted on the same data.
+ **/
+TEST_F(LinearRegressionTest, Mlpack){
+    PredictorLinearRegression predictor(PREDICTION_THROUGHPUT, _p, *_configuration, &_samples);
+    fit(predictor);
+
+    RegressionDataServiceTime data(_p, *_configuration, &_samples);
+    arma::mat dataMl(data.getNumPredictors(), _observed.size());
+    arma::rowvec responsesMl(_observed.size());
+    for(size_t i = 0; i < _observed.size(); i++){
+        data.init(_observed[i]);
+        data.toArmaRow(i, dataMl);
+        responsesMl(i) = getServiceTime(_observed[i]);
+    }
+    mlpack::regression::LinearRegression lr(dataMl, responsesMl);
+
+    arma::mat pointsMl(data.getNumPredictors(), 1);
+    arma::rowvec predictionsMl;
+    for(const KnobsValues& kv : _configuration->getRealCombinations()){
+        data.init(kv);
+        data.toArmaRow(0, pointsMl);
+        lr.Predict(pointsMl, predictionsMl);
+        double expected = 1.0 / predictionsMl(0);
+        EXPECT_NEAR(predictor.predict(kv), expected,
+                    expected * PREDICTORS_TEST_TOLERANCE);
+    }
+}
+
+TEST_F(LinearRegressionTest, Batch){
+    for(bool incremental : {false, true}){
+        Parameters p = _p;
+        p.regressionIncremental = incremental;
+        PredictorLinearRegression predictor(PREDICTION_THROUGHPUT, p, *_configuration, &_samples);
+        fit(predictor);
+        checkBatch(predictor);
+    }
+}
+
+TEST_F(RegressionMappingTest, Batch){
+    PredictorRegressionMapping<PredictorLinearRegression> predictor(PREDICTION_THROUGHPUT, _p, *_configuration, &_samples);
+    fit(predictor);
+    checkBatch(predictor);
+}
+#endif
@@ -218,3 +218,25 @@ TEST(SamplesTest, Operators) {
         EXPECT_EQ(r.watts, std::max(sample.watts, sample2.watts));
     }
 }
+
+TEST(SamplesTest, LatencyHistogram) {
+    nornir::LatencyHistogram h;
+    std::vector<unsigned long long> counts(LATENCY_HISTOGRAM_BUCKETS);
+    h.getCounts(counts);
+    EXPECT_EQ(LatencyHistogram::getPercentile(counts, 99), 0);
+
+    for(unsigned long long v = 1; v <= 1000; v++){
+        h.record(v * 1000);
+    }
+    h.getCounts(counts);
+    double p50 = LatencyHistogram::getPercentile(counts, 50);
+    double p99 = LatencyHistogram::getPercentile(counts, 99);
+    // Relative error bounded by 1/LATENCY_HISTOGRAM_SUB_BUCKETS.
+    EXPECT_GE(p50, 500000);
+    EXPECT_LE(p50, 500000 * (1 + 1.0 / LATENCY_HISTOGRAM_SUB_BUCKETS));
+    EXPECT_GE(p99, 990000);
+    EXPECT_LE(p99, 990000 * (1 + 1.0 / LATENCY_HISTOGRAM_SUB_BUCKETS));
+
+    // Values larger than the maximum are clamped.
+    EXPECT_EQ(LatencyHistogram::getBucket(~0ULL), LATENCY_HISTOGRAM_BUCKETS - 1);
+}
@@ -0,0 +1,331 @@
+/**
+ *  Different tests on selectors.
+ **/
+#include "parametersLoader.hpp"
+#include <cmath>
+#include <limits.h>
+#include <stdlib.h>
+#include <time.h>
+#include <nornir/nornir.hpp>
+#include <nornir/selectors.hpp>
+#include "gtest/gtest.h"
+
+using namespace nornir;
+
+/**
+ * Throughput and power strictly increasing with the number of cores
+ * (and with the frequency), as assumed by the pruned search. The
+ * exponents avoid ties between different configurations.
+ **/
+class MonotonePredictor: public Predictor{
+public:
+    MonotonePredictor(PredictorType type, const Parameters& p,
+                      const Configuration& configuration,
+                      const Smoother<MonitoredSample>* samples):
+        Predictor(type, p, configuration, samples){;}
+
+    bool readyForPredictions(){return true;}
+
+    void clear(){;}
+
+    void refine(const KnobsValues&, const MonitoredSample&){;}
+
+    void prepareForPredictions(){;}
+
+    double predict(const KnobsValues& values){
+        double cores = values[KNOB_VIRTUAL_CORES];
+        double frequency = values[KNOB_FREQUENCY] / 1000000.0;
+        double clkMod = values[KNOB_CLKMOD] / 100.0;
+        double others = 1 + 0.01 * values[KNOB_HYPERTHREADING] +
+                        0.001 * values[KNOB_MAPPING];
+        if(_type == PREDICTION_THROUGHPUT){
+            return pow(cores, 0.9) * pow(frequency, 0.7) * clkMod * others;
+        }else{
+            return 20 + pow(cores, 1.1) * pow(frequency, 2.3) * clkMod * others;
+        }
+    }
+};
+
+class SelectorMonotone: public SelectorPredictive{
+public:
+    SelectorMonotone(const Parameters& p,
+                     const Configuration& configuration,
+                     const Smoother<MonitoredSample>* samples):
+        SelectorPredictive(p, configuration, samples,
+                           std::unique_ptr<Predictor>(new MonotonePredictor(PREDICTION_THROUGHPUT, p, configuration, samples)),
+                           std::unique_ptr<Predictor>(new MonotonePredictor(PREDICTION_POWER, p, configuration, samples))){;}
+
+    KnobsValues getNextKnobsValues(){
+        return getBestKnobsValues();
+    }
+
+    bool isFeasible() const{
+        return isBestSolutionFeasible();
+    }
+};
+
+class PrunedSearchTest: public ::testing::Test{
+protected:
+    Parameters _p;
+    ConfigurationExternal* _configuration;
+    MovingAverageSimple<MonitoredSample> _samples;
+    double _maxThroughput, _maxPower;
+
+    PrunedSearchTest():_p(getParameters("repara")), _configuration(NULL),
+                       _samples(1), _maxThroughput(0), _maxPower(0){;}
+
+    void SetUp(){
+        _p.strategyUnusedVirtualCores = STRATEGY_UNUSED_VC_OFF;
+        _p.knobHyperthreadingEnabled = true;
+        _configuration = new ConfigurationExternal(_p);
+        dynamic_cast<KnobMappingExternal*>(_configuration->getKnob(KNOB_MAPPING))->setPid(getpid());
+        dynamic_cast<KnobClkModEmulated*>(_configuration->getKnob(KNOB_CLKMOD))->setPid(getpid());
+        MonotonePredictor throughput(PREDICTION_THROUGHPUT, _p, *_configuration, &_samples);
+        MonotonePredictor power(PREDICTION_POWER, _p, *_configuration, &_samples);
+        for(const KnobsValues& kv : _configuration->getRealCombinations()){
+            _maxThroughput = std::max(_maxThroughput, throughput.predict(kv));
+            _maxPower = std::max(_maxPower, power.predict(kv));
+        }
+    }
+
+    void TearDown(){
+        delete _configuration;
+    }
+
+    /**
+     * Checks that the pruned and the full search find the same
+     * configuration with the current requirements.
+     **/
+    void check(bool expectFeasible){
+        Parameters full = _p, pruned = _p;
+        full.prunedSearch = false;
+        pruned.prunedSearch = true;
+        SelectorMonotone fullSelector(full, *_configuration, &_samples);
+        SelectorMonotone prunedSelector(pruned, *_configuration, &_samples);
+        KnobsValues expected = fullSelector.getNextKnobsValues();
+        KnobsValues kv = prunedSelector.getNextKnobsValues();
+        EXPECT_EQ(fullSelector.isFeasible(), expectFeasible);
+        EXPECT_EQ(prunedSelector.isFeasible(), expectFeasible);
+        for(size_t i = 0; i < KNOB_NUM; i++){
+            EXPECT_EQ(kv[(KnobType) i], expected[(KnobType) i]);
+        }
+    }
+};
+
+TEST_F(PrunedSearchTest, MinPower){
+    _p.requirements.throughput = _maxThroughput / 2;
+    _p.requirements.powerConsumption = NORNIR_REQUIREMENT_MIN;
+    check(true);
+}
+
+TEST_F(PrunedSearchTest, MaxThroughput){
+    _p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    _p.requirements.powerConsumption = _maxPower / 3;
+    check(true);
+}
+
+TEST_F(PrunedSearchTest, Unfeasible){
+    _p.requirements.throughput = _maxThroughput * 2;
+    _p.requirements.powerConsumption = NORNIR_REQUIREMENT_MIN;
+    check(false);
+}
+
+/**
+ * Throughput increased by a given gain on a single configuration, the
+ * same throughput and power on all the other ones.
+ **/
+class StepPredictor: public Predictor{
+private:
+    KnobsValues _boosted;
+    double _gain;
+public:
+    StepPredictor(PredictorType type, const Parameters& p,
+                  const Configuration& configuration,
+                  const Smoother<MonitoredSample>* samples,
+                  const KnobsValues& boosted, double gain):
+        Predictor(type, p, configuration, samples), _boosted(boosted),
+        _gain(gain){;}
+
+    bool readyForPredictions(){return true;}
+
+    void clear(){;}
+
+    void refine(const KnobsValues&, const MonitoredSample&){;}
+
+    void prepareForPredictions(){;}
+
+    double predict(const KnobsValues& values){
+        if(_type == PREDICTION_POWER){
+            return 10;
+        }
+        for(size_t i = 0; i < KNOB_NUM; i++){
+            if(values[(KnobType) i] != _boosted[(KnobType) i]){
+                return 100;
+            }
+        }
+        return 100 * (1 + _gain);
+    }
+};
+
+class SelectorStep: public SelectorPredictive{
+public:
+    SelectorStep(const Parameters& p,
+                 const Configuration& configuration,
+                 const Smoother<MonitoredSample>* samples,
+                 const KnobsValues& boosted, double gain):
+        SelectorPredictive(p, configuration, samples,
+                           std::unique_ptr<Predictor>(new StepPredictor(PREDICTION_THROUGHPUT, p, configuration, samples, boosted, gain)),
+                           std::unique_ptr<Predictor>(new StepPredictor(PREDICTION_POWER, p, configuration, samples, boosted, gain))){;}
+
+    KnobsValues getNextKnobsValues(){
+        return getBestKnobsValues();
+    }
+};
+
+class ReconfigurationCostTest: public ::testing::Test{
+protected:
+    Parameters _p;
+    ConfigurationExternal* _configuration;
+    MovingAverageSimple<MonitoredSample> _samples;
+    KnobsValues _current, _boosted;
+
+    ReconfigurationCostTest():_p(getParameters("repara")), _configuration(NULL),
+                              _samples(1), _current(KNOB_VALUE_REAL),
+                              _boosted(KNOB_VALUE_REAL){;}
+
+    void SetUp(){
+        _p.strategyUnusedVirtualCores = STRATEGY_UNUSED_VC_OFF;
+        _configuration = new ConfigurationExternal(_p);
+        dynamic_cast<KnobMappingExternal*>(_configuration->getKnob(KNOB_MAPPING))->setPid(getpid());
+        dynamic_cast<KnobClkModEmulated*>(_configuration->getKnob(KNOB_CLKMOD))->setPid(getpid());
+        _configuration->getKnob(KNOB_MAPPING)->lock(MAPPING_TYPE_LINEAR);
+        _configuration->getKnob(KNOB_HYPERTHREADING)->lock(_p.knobHyperthreadingFixedValue);
+        for(KnobType t : {KNOB_CLKMOD, KNOB_PFOR_CHUNK, KNOB_DATAFLOW_BATCH, KNOB_DATAFLOW_WINDOW}){
+            _configuration->getKnob(t)->lockToMax();
+        }
+        _current = _configuration->getRealValues();
+        bool found = false;
+        for(const KnobsValues& kv : _configuration->getRealCombinations()){
+            if(kv[KNOB_VIRTUAL_CORES] != _current[KNOB_VIRTUAL_CORES]){
+                _boosted = kv;
+                found = true;
+                break;
+            }
+        }
+        ASSERT_TRUE(found);
+    }
+
+    void TearDown(){
+        delete _configuration;
+    }
+
+    // As if all the previous reconfigurations lasted ms milliseconds.
+    void setReconfigurationCost(double ms){
+        _configuration->_reconfigurationStats.addSampleTotal(ms);
+    }
+
+    /**
+     * Selects the configuration maximizing the throughput, when moving
+     * from the current one to _boosted increases it by gain.
+     **/
+    void check(double gain, const KnobsValues& expected, uint expectedAvoided){
+        Parameters p = _p;
+        p.prunedSearch = false;
+        p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+        p.reconfigurationResidenceTime = 1000;
+        SelectorStep selector(p, *_configuration, &_samples, _boosted, gain);
+        KnobsValues kv = selector.getNextKnobsValues();
+        for(size_t i = 0; i < KNOB_NUM; i++){
+            EXPECT_EQ(kv[(KnobType) i], expected[(KnobType) i]);
+        }
+        EXPECT_EQ(selector.getAvoidedReconfigurations(), expectedAvoided);
+    }
+};
+
+TEST_F(ReconfigurationCostTest, NoReconfigurations){
+    // The cost is not known yet.
+    check(0.05, _boosted, 0);
+}
+
+TEST_F(ReconfigurationCostTest, MarginalGain){
+    // Amortised over the residence time, the throughput of the best
+    // configuration is 105 * 1000 / 1100 < 100.
+    setReconfigurationCost(100);
+    check(0.05, _current, 1);
+}
+
+TEST_F(ReconfigurationCostTest, LargeGain){
+    // 150 * 1000 / 1100 > 100.
+    setReconfigurationCost(100);
+    check(0.5, _boosted, 0);
+}
+
+#ifdef ENABLE_MLPACK
+class SelectorLearnerTest: public ::testing::Test{
+protected:
+    static bool isFitting(const SelectorLearner& selector){
+        return selector._fitter != NULL;
+    }
+};
+
+/**
+ * Terminating the application while the model is fitted asynchronously
+ * at the end of the calibration.
+ **/
+TEST_F(SelectorLearnerTest, AsyncFittingTermination){
+    Parameters p = getParameters("repara");
+    p.strategyUnusedVirtualCores = STRATEGY_UNUSED_VC_OFF;
+    p.strategyPredictionPerformance = STRATEGY_PREDICTION_PERFORMANCE_AMDAHL;
+    p.strategyPredictionPower = STRATEGY_PREDICTION_POWER_LINEAR;
+    p.knobMappingEnabled = false;
+    p.asyncModelFitting = true;
+    // Any prediction is accurate, the calibration ends as soon as the
+    // predictors are ready.
+    p.maxPerformancePredictionError = 100.0;
+    p.maxPowerPredictionError = 100.0;
+    p.requirements.throughput = NORNIR_REQUIREMENT_MAX;
+    ConfigurationExternal configuration(p);
+    dynamic_cast<KnobMappingExternal*>(configuration.getKnob(KNOB_MAPPING))->setPid(getpid());
+    dynamic_cast<KnobClkModEmulated*>(configuration.getKnob(KNOB_CLKMOD))->setPid(getpid());
+    configuration.getKnob(KNOB_MAPPING)->lock(MAPPING_TYPE_LINEAR);
+    configuration.getKnob(KNOB_HYPERTHREADING)->lock(p.knobHyperthreadingFixedValue);
+    for(KnobType t : {KNOB_CLKMOD, KNOB_PFOR_CHUNK, KNOB_DATAFLOW_BATCH, KNOB_DATAFLOW_WINDOW}){
+        configuration.getKnob(t)->lockToMax();
+    }
+    MovingAverageSimple<MonitoredSample> samples(1);
+    SelectorLearner selector(p, configuration, &samples);
+
+    u_int64_t tasks = 1000;
+    selector.updateTotalTasks(tasks);
+    for(size_t i = 0; i < 100 && !isFitting(selector); i++){
+        KnobsValues kv = selector.getNextKnobsValues();
+        configuration.setValues(kv);
+        // Perfectly scalable application.
+        KnobsValues real = configuration.getRealValues();
+        double speed = real[KNOB_VIRTUAL_CORES] * real[KNOB_FREQUENCY] / 1000000.0;
+        MonitoredSample sample;
+        sample.throughput = 100 * speed;
+        sample.loadPercentage = 100;
+        sample.watts = 20 + speed;
+        sample.latency = 1;
+        samples.reset();
+        samples.add(sample);
+        tasks += 1000;
+        selector.updateBandwidthIn();
+        selector.updateTotalTasks(tasks);
+    }
+    ASSERT_TRUE(isFitting(selector));
+    EXPECT_TRUE(selector.isCalibrating());
+
+    // As done by the manager when the application terminates.
+    tasks += 1000;
+    selector.updateTotalTasks(tasks);
+    selector.terminate();
+    EXPECT_FALSE(isFitting(selector));
+    selector.stopCalibration();
+    std::vector<CalibrationStats> stats = selector.getCalibrationsStats();
+    ASSERT_EQ(stats.size(), (size_t) 1);
+    // The tasks received while fitting are not lost.
+    EXPECT_EQ(stats[0].numTasks, tasks - 1000);
+}
+#endif